@@ -57,16 +57,16 @@ ObjLibrary* createAsciiLibrary() {
     ObjLibrary* library = newLibrary(name);
     push(OBJ_VAL(library));
 
-    defineNative("ascii", asciiLib, &library->values);
-    defineNative("code", codeLib, &library->values);
+    defineLibraryNative("ascii", asciiLib, library);
+    defineLibraryNative("code", codeLib, library);
 
-    defineProperty("upper", OBJ_VAL(copyString("ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26)), &library->values);
-    defineProperty("lower", OBJ_VAL(copyString("abcdefghijklmnopqrstuvwxyz", 26)), &library->values);
-    defineProperty("digits", OBJ_VAL(copyString("0123456789", 10)), &library->values);
-    defineProperty("hex", OBJ_VAL(copyString("0123456789abcdefABCDEF", 22)), &library->values);
-    defineProperty("octal", OBJ_VAL(copyString("01234567", 8)), &library->values);
+    defineLibraryProperty("upper", OBJ_VAL(copyString("ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26)), library);
+    defineLibraryProperty("lower", OBJ_VAL(copyString("abcdefghijklmnopqrstuvwxyz", 26)), library);
+    defineLibraryProperty("digits", OBJ_VAL(copyString("0123456789", 10)), library);
+    defineLibraryProperty("hex", OBJ_VAL(copyString("0123456789abcdefABCDEF", 22)), library);
+    defineLibraryProperty("octal", OBJ_VAL(copyString("01234567", 8)), library);
     // local.
-    defineProperty("punctuation", OBJ_VAL(copyString("!#$%%&'()*+,-./:;<=>?@[\\]^_`{|}~", 32)), &library->values);
+    defineLibraryProperty("punctuation", OBJ_VAL(copyString("!#$%%&'()*+,-./:;<=>?@[\\]^_`{|}~", 32)), library);
     
     pop();
     pop();
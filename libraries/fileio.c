@@ -82,26 +82,24 @@ static Value readLib(int argCount, Value *args) {
     size_t size = ftell(file->file);
     fseek(file->file, curPos, SEEK_SET);
 
-    char* buffer = ALLOCATE(char, size + 1);
-    if (!buffer) {
-        runtimeError("Could not read the file '%s' due to memory issues.", file->path);
-        return NOTCLEAR;
-    }
+    // Read straight into the string, which is garbage if reading fails.
+    ObjString* string = makeString(size);
 
-    size_t read = fread(buffer, sizeof(char), size, file->file);
+    size_t read = fread(string->chars, sizeof(char), size, file->file);
     if (read < size && !feof(file->file)) {
-        FREE_ARRAY(char, buffer, size+1);
         runtimeError("Could not read the file '%s'.", file->path);
         return NOTCLEAR;
     }
 
     if (read != size) {
-        //shrink
-        buffer = GROW_ARRAY(char, buffer, size + 1, read + 1);
+        // Text mode may read fewer characters than there are bytes.
+        push(OBJ_VAL(string));
+        ObjString* shorter = copyRuntimeString(string->chars, read);
+        pop();
+        return OBJ_VAL(shorter);
     }
 
-    buffer[read] = '\0';
-    return OBJ_VAL(takeString(buffer, read));
+    return OBJ_VAL(finishString(string));
 }
 
 static Value isEOFLib(int argCount, Value *args) {
@@ -182,7 +180,7 @@ static Value closeLib(int argCount, Value *args) {
     return CLEAR;
 }
 
-void initIOFiles(Table* table) {
+void initIOFiles(ObjLibrary* library) {
     ObjFile* Stdout = newFile();
     ObjFile* Stdin = newFile();
     ObjFile* Stderr = newFile();
@@ -203,9 +201,9 @@ void initIOFiles(Table* table) {
     Stdin->path = "stdin";
     Stderr->path = "stderr";
     
-    defineProperty("stdout", OBJ_VAL(Stdout), table);
-    defineProperty("stdin", OBJ_VAL(Stdin), table);
-    defineProperty("stderr", OBJ_VAL(Stderr), table);
+    defineLibraryProperty("stdout", OBJ_VAL(Stdout), library);
+    defineLibraryProperty("stdin", OBJ_VAL(Stdin), library);
+    defineLibraryProperty("stderr", OBJ_VAL(Stderr), library);
 
     pop();
     pop();
@@ -218,19 +216,19 @@ ObjLibrary* createFileioLibrary() {
     ObjLibrary* library = newLibrary(name);
     push(OBJ_VAL(library));
 
-    defineNative("open", openLib, &library->values);
-    defineNative("close", closeLib, &library->values);
-    defineNative("write", writeLib, &library->values);
-    defineNative("read", readLib, &library->values);
-    defineNative("seek", seekLib, &library->values);
-    defineNative("exists", existsLib, &library->values);
-    defineNative("isEOF", isEOFLib, &library->values);
+    defineLibraryNative("open", openLib, library);
+    defineLibraryNative("close", closeLib, library);
+    defineLibraryNative("write", writeLib, library);
+    defineLibraryNative("read", readLib, library);
+    defineLibraryNative("seek", seekLib, library);
+    defineLibraryNative("exists", existsLib, library);
+    defineLibraryNative("isEOF", isEOFLib, library);
     
-    defineProperty("SEEK_SET", NUMBER_VAL(SEEK_SET), &library->values);
-    defineProperty("SEEK_CUR", NUMBER_VAL(SEEK_CUR), &library->values);
-    defineProperty("SEEK_END", NUMBER_VAL(SEEK_END), &library->values);
+    defineLibraryProperty("SEEK_SET", NUMBER_VAL(SEEK_SET), library);
+    defineLibraryProperty("SEEK_CUR", NUMBER_VAL(SEEK_CUR), library);
+    defineLibraryProperty("SEEK_END", NUMBER_VAL(SEEK_END), library);
 
-    initIOFiles(&library->values);
+    initIOFiles(library);
 
     pop();
     pop();
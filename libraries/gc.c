@@ -0,0 +1,199 @@
+#include "gc.h"
+
+// The class of what 'stats()' returns, the library keeps it alive.
+static ObjClass* statsClass = NULL;
+
+static const char* typeNames[OBJ_TYPE_COUNT] = {
+    [OBJ_BOUND_METHOD] = "boundMethod",
+    [OBJ_CLASS] = "class",
+    [OBJ_CLOSURE] = "closure",
+    [OBJ_FUNCTION] = "function",
+    [OBJ_INSTANCE] = "instance",
+    [OBJ_NATIVE] = "native",
+    [OBJ_STRING] = "string",
+    [OBJ_UPVALUE] = "upvalue",
+    [OBJ_LIST] = "list",
+    [OBJ_LIBRARY] = "library",
+    [OBJ_FILE] = "file",
+    [OBJ_MAP] = "map",
+    [OBJ_SET] = "set",
+    [OBJ_ARRAY] = "array",
+    [OBJ_STRING_BUILDER] = "stringBuilder",
+};
+
+static const char* phaseNames[] = {
+    [GC_IDLE] = "idle",
+    [GC_MARKING] = "marking",
+    [GC_SWEEPING] = "sweeping",
+};
+
+// The instance must be reachable.
+static void setStat(ObjInstance* instance, const char* name, Value value) {
+    push(value);
+    ObjString* fieldName = copyString(name, strlen(name));
+    push(OBJ_VAL(fieldName));
+
+    instanceSetField(instance, fieldName, false, value);
+    pop();
+    pop();
+}
+
+static ObjInstance* pushStats() {
+    ObjInstance* instance = newInstance(statsClass);
+    push(OBJ_VAL(instance));
+    return instance;
+}
+
+static bool numberArgument(int argCount, Value *args, const char* function, double min, double* number) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from '%s()'.", argCount, function);
+        return false;
+    }
+
+    if (!IS_NUMBER(args[0]) || AS_NUMBER(args[0]) < min) {
+        runtimeError("Argument must be a number no less than %g from '%s()'.", min, function);
+        return false;
+    }
+
+    *number = AS_NUMBER(args[0]);
+    return true;
+}
+
+static Value collectLib(int argCount, Value *args) {
+    (void)args;
+
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'collect()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    collectGarbage();
+    return NUMBER_VAL((double)vm.bytesAllocated);
+}
+
+static Value statsLib(int argCount, Value *args) {
+    (void)args;
+
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'stats()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    // Counted before anything is allocated for the result.
+    size_t counts[OBJ_TYPE_COUNT];
+    size_t bytes[OBJ_TYPE_COUNT];
+    heapCensus(counts, bytes);
+    GCStats gc = vm.gcStats;
+    size_t bytesAllocated = vm.bytesAllocated;
+
+    ObjInstance* stats = pushStats();
+    setStat(stats, "bytes", NUMBER_VAL((double)bytesAllocated));
+    setStat(stats, "nextCollection", NUMBER_VAL((double)vm.nextGC));
+    setStat(stats, "nextMinorCollection", NUMBER_VAL((double)vm.nextMinorGC));
+    setStat(stats, "phase", OBJ_VAL(copyString(phaseNames[vm.gcPhase], strlen(phaseNames[vm.gcPhase]))));
+
+    setStat(stats, "collections", NUMBER_VAL(gc.collections));
+    setStat(stats, "minorCollections", NUMBER_VAL(gc.minorCollections));
+    setStat(stats, "slices", NUMBER_VAL(gc.slices));
+    setStat(stats, "totalPause", NUMBER_VAL(gc.totalPause));
+    setStat(stats, "maxPause", NUMBER_VAL(gc.maxPause));
+
+    ObjList* pauses = newList();
+    push(OBJ_VAL(pauses));
+    for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+        appendToList(pauses, NUMBER_VAL(gc.pauses[i]));
+    }
+    setStat(stats, "pauses", OBJ_VAL(pauses));
+    pop();
+
+    ObjInstance* objects = pushStats();
+    ObjInstance* objectBytes = pushStats();
+    for (int i = 0; i < OBJ_TYPE_COUNT; i++) {
+        setStat(objects, typeNames[i], NUMBER_VAL((double)counts[i]));
+        setStat(objectBytes, typeNames[i], NUMBER_VAL((double)bytes[i]));
+    }
+    setStat(stats, "objectBytes", OBJ_VAL(objectBytes));
+    pop();
+    setStat(stats, "objects", OBJ_VAL(objects));
+    pop();
+
+    setStat(stats, "growFactor", NUMBER_VAL(vm.gcGrowFactor));
+    setStat(stats, "heapLimit", NUMBER_VAL((double)vm.heapLimit));
+    setStat(stats, "sliceBudget", NUMBER_VAL(vm.gcSliceBudget));
+    setStat(stats, "markThreads", NUMBER_VAL(vm.gcMarkThreads));
+
+    pop();
+    return OBJ_VAL(stats);
+}
+
+static Value setGrowFactorLib(int argCount, Value *args) {
+    double factor;
+    if (!numberArgument(argCount, args, "setGrowFactor", 1, &factor)) return NOTCLEAR;
+
+    vm.gcGrowFactor = factor;
+    return CLEAR;
+}
+
+// Where the next major collection starts, the first one's until a
+// collection has run.
+static Value setThresholdLib(int argCount, Value *args) {
+    double bytes;
+    if (!numberArgument(argCount, args, "setThreshold", 0, &bytes)) return NOTCLEAR;
+
+    vm.nextGC = (size_t)bytes;
+    return CLEAR;
+}
+
+static Value setHeapLimitLib(int argCount, Value *args) {
+    double bytes;
+    if (!numberArgument(argCount, args, "setHeapLimit", 0, &bytes)) return NOTCLEAR;
+
+    vm.heapLimit = (size_t)bytes;
+    return CLEAR;
+}
+
+static Value setSliceBudgetLib(int argCount, Value *args) {
+    double budget;
+    if (!numberArgument(argCount, args, "setSliceBudget", 0, &budget)) return NOTCLEAR;
+
+    vm.gcSliceBudget = (int)budget;
+    return CLEAR;
+}
+
+// Builds without PARALLEL_MARK keep the number, and still mark on one.
+static Value setMarkThreadsLib(int argCount, Value *args) {
+    double threads;
+    if (!numberArgument(argCount, args, "setMarkThreads", 1, &threads)) return NOTCLEAR;
+
+    vm.gcMarkThreads = (int)threads;
+    return CLEAR;
+}
+
+//
+ObjLibrary* createGcLibrary() {
+    ObjString* name = copyString("Gc", 2);
+    push(OBJ_VAL(name));
+    ObjLibrary* library = newLibrary(name);
+    push(OBJ_VAL(library));
+
+    defineLibraryNative("collect", collectLib, library);
+    defineLibraryNative("stats", statsLib, library);
+    defineLibraryNative("setGrowFactor", setGrowFactorLib, library);
+    defineLibraryNative("setThreshold", setThresholdLib, library);
+    defineLibraryNative("setHeapLimit", setHeapLimitLib, library);
+    defineLibraryNative("setSliceBudget", setSliceBudgetLib, library);
+    defineLibraryNative("setMarkThreads", setMarkThreadsLib, library);
+
+    ObjString* className = copyString("Stats", 5);
+    push(OBJ_VAL(className));
+    statsClass = newClass(className);
+    defineLibraryProperty("Stats", OBJ_VAL(statsClass), library);
+    pop();
+
+    defineLibraryProperty("PAUSE_BUCKETS", NUMBER_VAL(GC_PAUSE_BUCKETS), library);
+
+    pop();
+    pop();
+
+    return library;
+}
@@ -0,0 +1,14 @@
+#ifndef Pa_gc_h
+#define Pa_gc_h
+
+#include "../src/object.h"
+#include "../src/value.h"
+#include "../src/vm.h"
+
+#include "../src/memory.h"
+
+#include "library.h"
+
+ObjLibrary* createGcLibrary();
+
+#endif
@@ -8,6 +8,7 @@ NativeLibraries libraries[] = {
     {"Path", &createPathLibrary},
     {"Ascii", &createAsciiLibrary},
     {"File",  &createFileioLibrary},
+    {"Gc", &createGcLibrary},
 
     // -1
     {NULL, NULL}
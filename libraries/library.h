@@ -8,6 +8,7 @@
 #include "Pa_path.h"
 #include "Pa_ascii.h"
 #include "fileio.h"
+#include "gc.h"
 
 typedef ObjLibrary *(*NativeLibrary)();
 
@@ -19,7 +20,9 @@ typedef struct {
 ObjLibrary* importLibrary(int index);
 int getNativeModule(char* name, int length);
 
-#define NOTCLEAR NIL_VAL
+// Natives return this once they reported an error. It is the empty
+// value, which no script can hold, so none is an ordinary result.
+#define NOTCLEAR EMPTY_VAL
 #define CLEAR NUMBER_VAL(0)
 #define FAILED NUMBER_VAL(-1)
 
@@ -418,32 +418,32 @@ ObjLibrary* createMathLibrary() {
     ObjLibrary* library = newLibrary(name);
     push(OBJ_VAL(library));
 
-    defineNative("abs", absLib, &library->values);
-    defineNative("floor", floorLib, &library->values);
-    defineNative("round", roundLib, &library->values);
-    defineNative("ceil", ceilLib, &library->values);
-    defineNative("log",  logLib, &library->values);
-    defineNative("exp",  expLib, &library->values);
+    defineLibraryNative("abs", absLib, library);
+    defineLibraryNative("floor", floorLib, library);
+    defineLibraryNative("round", roundLib, library);
+    defineLibraryNative("ceil", ceilLib, library);
+    defineLibraryNative("log",  logLib, library);
+    defineLibraryNative("exp",  expLib, library);
 
-    defineNative("sqrt", sqrtLib, &library->values);
-    defineNative("clamp", clampLib, &library->values);
+    defineLibraryNative("sqrt", sqrtLib, library);
+    defineLibraryNative("clamp", clampLib, library);
 
-    defineNative("sin", sinLib, &library->values);
-    defineNative("cos", cosLib, &library->values);
-    defineNative("tan", tanLib, &library->values);
+    defineLibraryNative("sin", sinLib, library);
+    defineLibraryNative("cos", cosLib, library);
+    defineLibraryNative("tan", tanLib, library);
 
-    defineNative("asin", asinLib, &library->values);
-    defineNative("acos", acosLib, &library->values);
-    defineNative("atan", atanLib, &library->values);
+    defineLibraryNative("asin", asinLib, library);
+    defineLibraryNative("acos", acosLib, library);
+    defineLibraryNative("atan", atanLib, library);
 
-    defineNative("min", minLib, &library->values);
-    defineNative("max", maxLib, &library->values);
+    defineLibraryNative("min", minLib, library);
+    defineLibraryNative("max", maxLib, library);
 
-    defineNative("gcd", gcdLib, &library->values);
-    defineNative("pow", powLib, &library->values);
+    defineLibraryNative("gcd", gcdLib, library);
+    defineLibraryNative("pow", powLib, library);
 
-    defineProperty("pi", NUMBER_VAL(3.14159265358979), &library->values);
-    defineProperty("e", NUMBER_VAL(2.71828182845905), &library->values);
+    defineLibraryProperty("pi", NUMBER_VAL(3.14159265358979), library);
+    defineLibraryProperty("e", NUMBER_VAL(2.71828182845905), library);
 
     pop();
     pop();
@@ -228,31 +228,31 @@ ObjLibrary* createOsLibrary() {
     push(OBJ_VAL(library));
 
 #ifndef __APPLE__
-    defineNative("access", accessLib, &library->values);
+    defineLibraryNative("access", accessLib, library);
 #endif
 
-    defineNative("exit", exitLib, &library->values);
-    defineNative("remove", removeLib, &library->values);
-    defineNative("getCwd", getCwdLib, &library->values);
-    defineNative("setCwd", setCwdLib, &library->values);
-    defineNative("getHome", getHomeLib, &library->values);
-    defineNative("mkdir", mkdirLib, &library->values);
-    defineNative("rmdir", rmdirLib, &library->values);
-    defineNative("makeDirs", makeDirsLib, &library->values);
+    defineLibraryNative("exit", exitLib, library);
+    defineLibraryNative("remove", removeLib, library);
+    defineLibraryNative("getCwd", getCwdLib, library);
+    defineLibraryNative("setCwd", setCwdLib, library);
+    defineLibraryNative("getHome", getHomeLib, library);
+    defineLibraryNative("mkdir", mkdirLib, library);
+    defineLibraryNative("rmdir", rmdirLib, library);
+    defineLibraryNative("makeDirs", makeDirsLib, library);
 
-    defineProperty("EXIT_FAILURE", NUMBER_VAL(EXIT_FAILURE), &library->values);
-    defineProperty("EXIT_SUCCESS", NUMBER_VAL(EXIT_SUCCESS), &library->values);
+    defineLibraryProperty("EXIT_FAILURE", NUMBER_VAL(EXIT_FAILURE), library);
+    defineLibraryProperty("EXIT_SUCCESS", NUMBER_VAL(EXIT_SUCCESS), library);
 
-    defineProperty("F_OK", NUMBER_VAL(F_OK), &library->values);
-    defineProperty("X_OK", NUMBER_VAL(X_OK), &library->values);
-    defineProperty("W_OK", NUMBER_VAL(W_OK), &library->values);
-    defineProperty("R_OK", NUMBER_VAL(R_OK), &library->values);
+    defineLibraryProperty("F_OK", NUMBER_VAL(F_OK), library);
+    defineLibraryProperty("X_OK", NUMBER_VAL(X_OK), library);
+    defineLibraryProperty("W_OK", NUMBER_VAL(W_OK), library);
+    defineLibraryProperty("R_OK", NUMBER_VAL(R_OK), library);
 
 
     char* pChar = getPlatform();
     ObjString* platform = copyString(pChar, strlen(pChar));
     push(OBJ_VAL(platform));
-    defineProperty("name", OBJ_VAL(platform), &library->values);
+    defineLibraryProperty("name", OBJ_VAL(platform), library);
     pop();
 
     pop();
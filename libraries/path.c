@@ -155,7 +155,7 @@ static Value realLib(int argCount, Value *args) {
 
             Value fileValue = OBJ_VAL(copyString(fdFile.cFileName, strlen(fdFile.cFileName)));
             push(fileValue);
-            writeValueArray(&list->items, fileValue);
+            appendToList(list, fileValue);
             pop();
         } while (FindNextFile(dir, &fdFile) != 0);
 
@@ -195,7 +195,7 @@ static Value listDirLib(int argCount, Value* args) {
 
             Value value = OBJ_VAL(copyString(node_name, strlen(node_name)));
             push(value);
-            writeValueArray(&contents->items, value);
+            appendToList(contents, value);
             pop();
         }
         closedir(dir);
@@ -216,18 +216,18 @@ ObjLibrary* createPathLibrary() {
     ObjLibrary* library = newLibrary(name);
     push(OBJ_VAL(library));
 
-    defineNative("basename", basenameLib, &library->values);
-    defineNative("extension", extLib, &library->values);
-    defineNative("dirname", dirLib, &library->values);
-    defineNative("isDir", isDirLib, &library->values);
-    defineNative("listDir", listDirLib, &library->values);
-    defineNative("isFile", isFileLib, &library->values);
-    defineNative("real", realLib, &library->values);
+    defineLibraryNative("basename", basenameLib, library);
+    defineLibraryNative("extension", extLib, library);
+    defineLibraryNative("dirname", dirLib, library);
+    defineLibraryNative("isDir", isDirLib, library);
+    defineLibraryNative("listDir", listDirLib, library);
+    defineLibraryNative("isFile", isFileLib, library);
+    defineLibraryNative("real", realLib, library);
 
 #ifdef _WIN32
-    defineProperty("separator", OBJ_VAL(copyString("\\", 1)), &library->values);
+    defineLibraryProperty("separator", OBJ_VAL(copyString("\\", 1)), library);
 #else
-    defineProperty("separator", OBJ_VAL(copyString("/", 1)), &library->values);
+    defineLibraryProperty("separator", OBJ_VAL(copyString("/", 1)), library);
 #endif
     
     pop();
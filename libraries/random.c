@@ -117,12 +117,12 @@ ObjLibrary* createRandomLibrary() {
     ObjLibrary* library = newLibrary(name);
     push(OBJ_VAL(library));
 
-    defineNative("range", rangeLib, &library->values);
-    defineNative("fastRange", fastRangeLib, &library->values);
-    defineNative("choice", choiceLib, &library->values);
-    defineNative("fill", fillLib, &library->values);
+    defineLibraryNative("range", rangeLib, library);
+    defineLibraryNative("fastRange", fastRangeLib, library);
+    defineLibraryNative("choice", choiceLib, library);
+    defineLibraryNative("fill", fillLib, library);
     
-    defineProperty("RANDOM_MAX", NUMBER_VAL(RAND_MAX), &library->values);
+    defineLibraryProperty("RANDOM_MAX", NUMBER_VAL(RAND_MAX), library);
 
     pop();
     pop();
@@ -71,29 +71,29 @@ ObjLibrary* createTimeLibrary() {
     ObjLibrary* library = newLibrary(name);
     push(OBJ_VAL(library));
 
-    defineNative("time", timeLib, &library->values);
-    defineNative("clock", clockLib, &library->values);
-    defineNative("sleep", sleepLib, &library->values);
+    defineLibraryNative("time", timeLib, library);
+    defineLibraryNative("clock", clockLib, library);
+    defineLibraryNative("sleep", sleepLib, library);
 
-    defineProperty("MINYEAR", NUMBER_VAL(1), &library->values);
-    defineProperty("MAXYEAR", NUMBER_VAL(9999), &library->values);
+    defineLibraryProperty("MINYEAR", NUMBER_VAL(1), library);
+    defineLibraryProperty("MAXYEAR", NUMBER_VAL(9999), library);
 
-    defineProperty("day", NUMBER_VAL(tm.tm_mday), &library->values);
+    defineLibraryProperty("day", NUMBER_VAL(tm.tm_mday), library);
 
     char* dayName = getDayName(tm.tm_wday + 1);
-    defineProperty("weekday", NUMBER_VAL(tm.tm_wday), &library->values);
-    defineProperty("dayName", OBJ_VAL(takeString(dayName, strlen(dayName))), &library->values);
+    defineLibraryProperty("weekday", NUMBER_VAL(tm.tm_wday), library);
+    defineLibraryProperty("dayName", OBJ_VAL(takeString(dayName, strlen(dayName))), library);
 
 
-    defineProperty("month", NUMBER_VAL(tm.tm_mon + 1), &library->values);
+    defineLibraryProperty("month", NUMBER_VAL(tm.tm_mon + 1), library);
     char* monthName = getMonthName(tm.tm_mon);
-    defineProperty("monthName", OBJ_VAL(takeString(monthName, strlen(monthName))), &library->values);
+    defineLibraryProperty("monthName", OBJ_VAL(takeString(monthName, strlen(monthName))), library);
 
-    defineProperty("year", NUMBER_VAL(tm.tm_year + 1900), &library->values);
+    defineLibraryProperty("year", NUMBER_VAL(tm.tm_year + 1900), library);
 
-    defineProperty("hour", NUMBER_VAL(tm.tm_hour), &library->values);
-    defineProperty("minute", NUMBER_VAL(tm.tm_min), &library->values);
-    defineProperty("second", NUMBER_VAL(tm.tm_sec), &library->values);
+    defineLibraryProperty("hour", NUMBER_VAL(tm.tm_hour), library);
+    defineLibraryProperty("minute", NUMBER_VAL(tm.tm_min), library);
+    defineLibraryProperty("second", NUMBER_VAL(tm.tm_sec), library);
 
     pop();
     pop();
@@ -0,0 +1,417 @@
+#include <math.h>
+
+#include "array-kernels.h"
+
+#if !defined(NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && \
+    defined(__x86_64__)
+#define ARRAY_SIMD
+#include <immintrin.h>
+#endif
+
+// Sums run four lanes wide, lane 'j' taking the elements at 'i + j',
+// then fold as (0 + 2) + (1 + 3) before the leftovers are added.
+static double sumScalar(const double* values, int count) {
+    double lanes[4] = {0, 0, 0, 0};
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes[0] += values[i];
+        lanes[1] += values[i + 1];
+        lanes[2] += values[i + 2];
+        lanes[3] += values[i + 3];
+    }
+
+    double total = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+    for (; i < count; i++) total += values[i];
+    return total;
+}
+
+static double dotScalar(const double* a, const double* b, int count) {
+    double lanes[4] = {0, 0, 0, 0};
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes[0] += a[i] * b[i];
+        lanes[1] += a[i + 1] * b[i + 1];
+        lanes[2] += a[i + 2] * b[i + 2];
+        lanes[3] += a[i + 3] * b[i + 3];
+    }
+
+    double total = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+    for (; i < count; i++) total += a[i] * b[i];
+    return total;
+}
+
+// A NaN anywhere is the result, the first one met, on every path. The
+// vector kernels only flag NaNs and leave them to these loops.
+static double minFrom(const double* values, int start, int count, double min) {
+    for (int i = start; i < count; i++) {
+        if (values[i] < min || values[i] != values[i]) min = values[i];
+    }
+    return min;
+}
+
+static double maxFrom(const double* values, int start, int count, double max) {
+    for (int i = start; i < count; i++) {
+        if (values[i] > max || values[i] != values[i]) max = values[i];
+    }
+    return max;
+}
+
+static double minScalar(const double* values, int count) {
+    return minFrom(values, 1, count, values[0]);
+}
+
+static double maxScalar(const double* values, int count) {
+    return maxFrom(values, 1, count, values[0]);
+}
+
+static void scaleScalar(double* values, int count, double factor) {
+    for (int i = 0; i < count; i++) values[i] *= factor;
+}
+
+static void addScalar(double* values, const double* other, int count) {
+    for (int i = 0; i < count; i++) values[i] += other[i];
+}
+
+static void absScalar(double* values, int count) {
+    for (int i = 0; i < count; i++) values[i] = fabs(values[i]);
+}
+
+static void negScalar(double* values, int count) {
+    for (int i = 0; i < count; i++) values[i] = -values[i];
+}
+
+static void sqrtScalar(double* values, int count) {
+    for (int i = 0; i < count; i++) values[i] = sqrt(values[i]);
+}
+
+static void squareScalar(double* values, int count) {
+    for (int i = 0; i < count; i++) values[i] *= values[i];
+}
+
+static void floorScalar(double* values, int count) {
+    for (int i = 0; i < count; i++) values[i] = floor(values[i]);
+}
+
+static void ceilScalar(double* values, int count) {
+    for (int i = 0; i < count; i++) values[i] = ceil(values[i]);
+}
+
+#ifdef ARRAY_SIMD
+// SSE2 is part of x86-64, these need no check.
+static double sumSSE2(const double* values, int count) {
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        low = _mm_add_pd(low, _mm_loadu_pd(values + i));
+        high = _mm_add_pd(high, _mm_loadu_pd(values + i + 2));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+    double total = lanes[0] + lanes[1];
+    for (; i < count; i++) total += values[i];
+    return total;
+}
+
+static double dotSSE2(const double* a, const double* b, int count) {
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        low = _mm_add_pd(low, _mm_mul_pd(_mm_loadu_pd(a + i),
+                                         _mm_loadu_pd(b + i)));
+        high = _mm_add_pd(high, _mm_mul_pd(_mm_loadu_pd(a + i + 2),
+                                           _mm_loadu_pd(b + i + 2)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+    double total = lanes[0] + lanes[1];
+    for (; i < count; i++) total += a[i] * b[i];
+    return total;
+}
+
+static double minSSE2(const double* values, int count) {
+    if (count < 2) return minScalar(values, count);
+
+    __m128d min = _mm_loadu_pd(values);
+    __m128d nan = _mm_cmpunord_pd(min, min);
+    int i = 2;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        min = _mm_min_pd(min, v);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+    }
+
+    if (_mm_movemask_pd(nan)) return minScalar(values, count);
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, min);
+    return minFrom(values, i, count, lanes[0] < lanes[1] ? lanes[0] : lanes[1]);
+}
+
+static double maxSSE2(const double* values, int count) {
+    if (count < 2) return maxScalar(values, count);
+
+    __m128d max = _mm_loadu_pd(values);
+    __m128d nan = _mm_cmpunord_pd(max, max);
+    int i = 2;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        max = _mm_max_pd(max, v);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(v, v));
+    }
+
+    if (_mm_movemask_pd(nan)) return maxScalar(values, count);
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, max);
+    return maxFrom(values, i, count, lanes[0] > lanes[1] ? lanes[0] : lanes[1]);
+}
+
+static void scaleSSE2(double* values, int count, double factor) {
+    __m128d k = _mm_set1_pd(factor);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(values + i, _mm_mul_pd(_mm_loadu_pd(values + i), k));
+    }
+    for (; i < count; i++) values[i] *= factor;
+}
+
+static void addSSE2(double* values, const double* other, int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(values + i, _mm_add_pd(_mm_loadu_pd(values + i),
+                                             _mm_loadu_pd(other + i)));
+    }
+    for (; i < count; i++) values[i] += other[i];
+}
+
+static void absSSE2(double* values, int count) {
+    __m128d sign = _mm_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(values + i, _mm_andnot_pd(sign, _mm_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = fabs(values[i]);
+}
+
+static void negSSE2(double* values, int count) {
+    __m128d sign = _mm_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(values + i, _mm_xor_pd(sign, _mm_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = -values[i];
+}
+
+static void sqrtSSE2(double* values, int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm_storeu_pd(values + i, _mm_sqrt_pd(_mm_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = sqrt(values[i]);
+}
+
+static void squareSSE2(double* values, int count) {
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        _mm_storeu_pd(values + i, _mm_mul_pd(v, v));
+    }
+    for (; i < count; i++) values[i] *= values[i];
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static double sumAVX2(const double* values, int count) {
+    __m256d lanes = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes = _mm256_add_pd(lanes, _mm256_loadu_pd(values + i));
+    }
+
+    double halves[2];
+    _mm_storeu_pd(halves, _mm_add_pd(_mm256_castpd256_pd128(lanes),
+                                     _mm256_extractf128_pd(lanes, 1)));
+    double total = halves[0] + halves[1];
+    for (; i < count; i++) total += values[i];
+    return total;
+}
+
+AVX2 static double dotAVX2(const double* a, const double* b, int count) {
+    __m256d lanes = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        lanes = _mm256_add_pd(lanes, _mm256_mul_pd(_mm256_loadu_pd(a + i),
+                                                   _mm256_loadu_pd(b + i)));
+    }
+
+    double halves[2];
+    _mm_storeu_pd(halves, _mm_add_pd(_mm256_castpd256_pd128(lanes),
+                                     _mm256_extractf128_pd(lanes, 1)));
+    double total = halves[0] + halves[1];
+    for (; i < count; i++) total += a[i] * b[i];
+    return total;
+}
+
+AVX2 static double minAVX2(const double* values, int count) {
+    if (count < 4) return minScalar(values, count);
+
+    __m256d min = _mm256_loadu_pd(values);
+    __m256d nan = _mm256_cmp_pd(min, min, _CMP_UNORD_Q);
+    int i = 4;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        min = _mm256_min_pd(min, v);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+    }
+
+    if (_mm256_movemask_pd(nan)) return minScalar(values, count);
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, min);
+    return minFrom(values, i, count, minFrom(lanes, 1, 4, lanes[0]));
+}
+
+AVX2 static double maxAVX2(const double* values, int count) {
+    if (count < 4) return maxScalar(values, count);
+
+    __m256d max = _mm256_loadu_pd(values);
+    __m256d nan = _mm256_cmp_pd(max, max, _CMP_UNORD_Q);
+    int i = 4;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        max = _mm256_max_pd(max, v);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+    }
+
+    if (_mm256_movemask_pd(nan)) return maxScalar(values, count);
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, max);
+    return maxFrom(values, i, count, maxFrom(lanes, 1, 4, lanes[0]));
+}
+
+AVX2 static void scaleAVX2(double* values, int count, double factor) {
+    __m256d k = _mm256_set1_pd(factor);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i, _mm256_mul_pd(_mm256_loadu_pd(values + i), k));
+    }
+    for (; i < count; i++) values[i] *= factor;
+}
+
+AVX2 static void addAVX2(double* values, const double* other, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i, _mm256_add_pd(_mm256_loadu_pd(values + i),
+                                                   _mm256_loadu_pd(other + i)));
+    }
+    for (; i < count; i++) values[i] += other[i];
+}
+
+AVX2 static void absAVX2(double* values, int count) {
+    __m256d sign = _mm256_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i,
+                         _mm256_andnot_pd(sign, _mm256_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = fabs(values[i]);
+}
+
+AVX2 static void negAVX2(double* values, int count) {
+    __m256d sign = _mm256_set1_pd(-0.0);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i,
+                         _mm256_xor_pd(sign, _mm256_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = -values[i];
+}
+
+AVX2 static void sqrtAVX2(double* values, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i, _mm256_sqrt_pd(_mm256_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = sqrt(values[i]);
+}
+
+AVX2 static void squareAVX2(double* values, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        _mm256_storeu_pd(values + i, _mm256_mul_pd(v, v));
+    }
+    for (; i < count; i++) values[i] *= values[i];
+}
+
+AVX2 static void floorAVX2(double* values, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i, _mm256_floor_pd(_mm256_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = floor(values[i]);
+}
+
+AVX2 static void ceilAVX2(double* values, int count) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(values + i, _mm256_ceil_pd(_mm256_loadu_pd(values + i)));
+    }
+    for (; i < count; i++) values[i] = ceil(values[i]);
+}
+
+#undef AVX2
+#endif
+
+FloatKernels floatKernels = {
+    sumScalar, dotScalar, minScalar, maxScalar, scaleScalar, addScalar,
+    {
+        [FLOAT_OP_ABS] = absScalar,
+        [FLOAT_OP_NEG] = negScalar,
+        [FLOAT_OP_SQRT] = sqrtScalar,
+        [FLOAT_OP_SQUARE] = squareScalar,
+        [FLOAT_OP_FLOOR] = floorScalar,
+        [FLOAT_OP_CEIL] = ceilScalar,
+    },
+};
+
+void initArrayKernels() {
+#ifdef ARRAY_SIMD
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        FloatKernels avx2 = {
+            sumAVX2, dotAVX2, minAVX2, maxAVX2, scaleAVX2, addAVX2,
+            {
+                [FLOAT_OP_ABS] = absAVX2,
+                [FLOAT_OP_NEG] = negAVX2,
+                [FLOAT_OP_SQRT] = sqrtAVX2,
+                [FLOAT_OP_SQUARE] = squareAVX2,
+                [FLOAT_OP_FLOOR] = floorAVX2,
+                [FLOAT_OP_CEIL] = ceilAVX2,
+            },
+        };
+        floatKernels = avx2;
+        return;
+    }
+
+    // Rounding takes SSE4.1, floor and ceil keep the plain loops.
+    FloatKernels sse2 = {
+        sumSSE2, dotSSE2, minSSE2, maxSSE2, scaleSSE2, addSSE2,
+        {
+            [FLOAT_OP_ABS] = absSSE2,
+            [FLOAT_OP_NEG] = negSSE2,
+            [FLOAT_OP_SQRT] = sqrtSSE2,
+            [FLOAT_OP_SQUARE] = squareSSE2,
+            [FLOAT_OP_FLOOR] = floorScalar,
+            [FLOAT_OP_CEIL] = ceilScalar,
+        },
+    };
+    floatKernels = sse2;
+#endif
+}
@@ -0,0 +1,36 @@
+#ifndef Pa_array_kernels_h
+#define Pa_array_kernels_h
+
+#include "../src/common.h"
+
+// The element-wise operations of 'map()'.
+typedef enum {
+    FLOAT_OP_ABS,
+    FLOAT_OP_NEG,
+    FLOAT_OP_SQRT,
+    FLOAT_OP_SQUARE,
+    FLOAT_OP_FLOOR,
+    FLOAT_OP_CEIL,
+    FLOAT_OP_COUNT,
+} FloatOp;
+
+// The float64 loops, picked once for the machine running. Every version
+// adds in the same order, so sums don't depend on which one was picked.
+// 'min' and 'max' need at least one element.
+typedef struct {
+    double (*sum)(const double* values, int count);
+    double (*dot)(const double* a, const double* b, int count);
+    double (*min)(const double* values, int count);
+    double (*max)(const double* values, int count);
+    void (*scale)(double* values, int count, double factor);
+    void (*add)(double* values, const double* other, int count);
+    void (*map[FLOAT_OP_COUNT])(double* values, int count);
+} FloatKernels;
+
+extern FloatKernels floatKernels;
+
+// AVX2, then SSE2, then plain loops. Define NO_SIMD to always take the
+// plain loops.
+void initArrayKernels();
+
+#endif
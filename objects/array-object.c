@@ -0,0 +1,377 @@
+#include <math.h>
+#include <string.h>
+
+#include "objects.h"
+#include "array-kernels.h"
+#include "../src/memory.h"
+
+static const char* floatOpNames[] = {
+    [FLOAT_OP_ABS] = "abs",
+    [FLOAT_OP_NEG] = "neg",
+    [FLOAT_OP_SQRT] = "sqrt",
+    [FLOAT_OP_SQUARE] = "square",
+    [FLOAT_OP_FLOOR] = "floor",
+    [FLOAT_OP_CEIL] = "ceil",
+};
+
+static bool checkOtherArray(int argCount, Value *args, const char* method) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from '%s()'.", argCount, method);
+        return false;
+    }
+
+    if (!IS_ARRAY(args[1])) {
+        runtimeError("Argument must be an array from '%s()'.", method);
+        return false;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    ObjArray* other = AS_ARRAY(args[1]);
+
+    if (array->kind != other->kind) {
+        runtimeError("Can not mix %s and %s arrays from '%s()'.",
+                     arrayKindName(array->kind), arrayKindName(other->kind), method);
+        return false;
+    }
+
+    if (array->count != other->count) {
+        runtimeError("Arrays of length %d and %d from '%s()'.",
+                     array->count, other->count, method);
+        return false;
+    }
+
+    return true;
+}
+
+static double applyOp(FloatOp op, double value) {
+    switch (op) {
+        case FLOAT_OP_ABS: return fabs(value);
+        case FLOAT_OP_NEG: return -value;
+        case FLOAT_OP_SQRT: return sqrt(value);
+        case FLOAT_OP_SQUARE: return value * value;
+        case FLOAT_OP_FLOOR: return floor(value);
+        case FLOAT_OP_CEIL: return ceil(value);
+        default: return value; // Unreachable.
+    }
+}
+
+static Value lengthMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'length()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    return NUMBER_VAL(AS_ARRAY(args[0])->count);
+}
+
+static Value kindMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'kind()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    const char* kind = arrayKindName(AS_ARRAY(args[0])->kind);
+    return OBJ_VAL(copyString(kind, strlen(kind)));
+}
+
+// Integer sums are exact up to 2^53, where numbers stop being.
+static Value sumMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'sum()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    switch (array->kind) {
+        case ARRAY_FLOAT64:
+            return NUMBER_VAL(floatKernels.sum(ARRAY_FLOATS(array), array->count));
+
+        case ARRAY_INT32: {
+            int64_t total = 0;
+            int32_t* ints = ARRAY_INTS(array);
+            for (int i = 0; i < array->count; i++) total += ints[i];
+            return NUMBER_VAL((double)total);
+        }
+
+        case ARRAY_UINT8: {
+            uint64_t total = 0;
+            uint8_t* bytes = ARRAY_BYTES(array);
+            for (int i = 0; i < array->count; i++) total += bytes[i];
+            return NUMBER_VAL((double)total);
+        }
+    }
+
+    return NOTCLEAR; // Unreachable.
+}
+
+static Value dotMethod(int argCount, Value *args) {
+    if (!checkOtherArray(argCount, args, "dot")) return NOTCLEAR;
+
+    ObjArray* a = AS_ARRAY(args[0]);
+    ObjArray* b = AS_ARRAY(args[1]);
+
+    switch (a->kind) {
+        case ARRAY_FLOAT64:
+            return NUMBER_VAL(floatKernels.dot(ARRAY_FLOATS(a), ARRAY_FLOATS(b), a->count));
+
+        case ARRAY_INT32: {
+            // Two products can already overflow 64 bits.
+            double total = 0;
+            for (int i = 0; i < a->count; i++) {
+                total += (double)ARRAY_INTS(a)[i] * ARRAY_INTS(b)[i];
+            }
+            return NUMBER_VAL(total);
+        }
+
+        case ARRAY_UINT8: {
+            uint64_t total = 0;
+            for (int i = 0; i < a->count; i++) {
+                total += (uint32_t)ARRAY_BYTES(a)[i] * ARRAY_BYTES(b)[i];
+            }
+            return NUMBER_VAL((double)total);
+        }
+    }
+
+    return NOTCLEAR; // Unreachable.
+}
+
+static Value extremum(int argCount, Value *args, bool isMax, const char* method) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from '%s()'.", argCount, method);
+        return NOTCLEAR;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    if (array->count == 0) {
+        runtimeError("Can not take '%s()' of an empty array.", method);
+        return NOTCLEAR;
+    }
+
+    if (array->kind == ARRAY_FLOAT64) {
+        double* floats = ARRAY_FLOATS(array);
+        return NUMBER_VAL(isMax ? floatKernels.max(floats, array->count)
+                                : floatKernels.min(floats, array->count));
+    }
+
+    double result = AS_NUMBER(indexFromArray(array, 0));
+    for (int i = 1; i < array->count; i++) {
+        double value = AS_NUMBER(indexFromArray(array, i));
+        if (isMax ? value > result : value < result) result = value;
+    }
+
+    return NUMBER_VAL(result);
+}
+
+static Value minMethod(int argCount, Value *args) {
+    return extremum(argCount, args, false, "min");
+}
+
+static Value maxMethod(int argCount, Value *args) {
+    return extremum(argCount, args, true, "max");
+}
+
+// scale(), add(), map() and fill() work in place and return the array,
+// integer results saturate.
+static Value scaleMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'scale()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!IS_NUMBER(args[1])) {
+        runtimeError("Factor must be a number from 'scale()'.");
+        return NOTCLEAR;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    double factor = AS_NUMBER(args[1]);
+
+    if (array->kind == ARRAY_FLOAT64) {
+        floatKernels.scale(ARRAY_FLOATS(array), array->count, factor);
+    } else {
+        for (int i = 0; i < array->count; i++) {
+            storeToArray(array, i, AS_NUMBER(indexFromArray(array, i)) * factor);
+        }
+    }
+
+    return args[0];
+}
+
+static Value addMethod(int argCount, Value *args) {
+    if (!checkOtherArray(argCount, args, "add")) return NOTCLEAR;
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    ObjArray* other = AS_ARRAY(args[1]);
+
+    switch (array->kind) {
+        case ARRAY_FLOAT64:
+            floatKernels.add(ARRAY_FLOATS(array), ARRAY_FLOATS(other), array->count);
+            break;
+
+        case ARRAY_INT32: {
+            int32_t* ints = ARRAY_INTS(array);
+            for (int i = 0; i < array->count; i++) {
+                ints[i] = clampInt32((double)ints[i] + ARRAY_INTS(other)[i]);
+            }
+            break;
+        }
+
+        case ARRAY_UINT8: {
+            uint8_t* bytes = ARRAY_BYTES(array);
+            for (int i = 0; i < array->count; i++) {
+                int sum = bytes[i] + ARRAY_BYTES(other)[i];
+                bytes[i] = sum > UINT8_MAX ? UINT8_MAX : sum;
+            }
+            break;
+        }
+    }
+
+    return args[0];
+}
+
+static Value mapMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'map()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!IS_STRING(args[1])) {
+        runtimeError("Operation must be a string from 'map()'.");
+        return NOTCLEAR;
+    }
+
+    ObjString* name = AS_STRING(args[1]);
+    int op = 0;
+    while (op < FLOAT_OP_COUNT && strcmp(floatOpNames[op], name->chars) != 0) {
+        op++;
+    }
+
+    if (op == FLOAT_OP_COUNT) {
+        runtimeError("Unknown operation '%s' from 'map()'.", name->chars);
+        return NOTCLEAR;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    if (array->kind == ARRAY_FLOAT64) {
+        floatKernels.map[op](ARRAY_FLOATS(array), array->count);
+    } else {
+        for (int i = 0; i < array->count; i++) {
+            storeToArray(array, i, applyOp(op, AS_NUMBER(indexFromArray(array, i))));
+        }
+    }
+
+    return args[0];
+}
+
+static Value fillMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'fill()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!IS_NUMBER(args[1])) {
+        runtimeError("Value must be a number from 'fill()'.");
+        return NOTCLEAR;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    double value = AS_NUMBER(args[1]);
+
+    switch (array->kind) {
+        case ARRAY_FLOAT64: {
+            double* floats = ARRAY_FLOATS(array);
+            for (int i = 0; i < array->count; i++) floats[i] = value;
+            break;
+        }
+
+        case ARRAY_INT32: {
+            int32_t fill = clampInt32(value);
+            int32_t* ints = ARRAY_INTS(array);
+            for (int i = 0; i < array->count; i++) ints[i] = fill;
+            break;
+        }
+
+        case ARRAY_UINT8: {
+            uint8_t fill = clampUint8(value);
+            uint8_t* bytes = ARRAY_BYTES(array);
+            for (int i = 0; i < array->count; i++) bytes[i] = fill;
+            break;
+        }
+    }
+
+    return args[0];
+}
+
+// The list is sized once and filled in a single pass.
+static Value toListMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'toList()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjArray* array = AS_ARRAY(args[0]);
+    ObjList* list = newListWithCapacity(array->count);
+    push(OBJ_VAL(list));
+
+    Value* values = list->items.values;
+    switch (array->kind) {
+        case ARRAY_FLOAT64:
+            for (int i = 0; i < array->count; i++) {
+                values[i] = NUMBER_VAL(ARRAY_FLOATS(array)[i]);
+            }
+            break;
+
+        case ARRAY_INT32:
+            for (int i = 0; i < array->count; i++) {
+                values[i] = NUMBER_VAL(ARRAY_INTS(array)[i]);
+            }
+            break;
+
+        case ARRAY_UINT8:
+            for (int i = 0; i < array->count; i++) {
+                values[i] = NUMBER_VAL(ARRAY_BYTES(array)[i]);
+            }
+            break;
+    }
+
+    list->items.count = array->count;
+    pop();
+    return OBJ_VAL(list);
+}
+
+//
+void initArrayMethods() {
+    initArrayKernels();
+
+    char* arrayMethodStrings[] = {
+        "length",
+        "kind",
+        "sum",
+        "dot",
+        "min",
+        "max",
+        "scale",
+        "add",
+        "map",
+        "fill",
+        "toList",
+    };
+
+    NativeFn arrayMethods[] = {
+        lengthMethod,
+        kindMethod,
+        sumMethod,
+        dotMethod,
+        minMethod,
+        maxMethod,
+        scaleMethod,
+        addMethod,
+        mapMethod,
+        fillMethod,
+        toListMethod,
+    };
+
+    for (uint8_t i = 0; i < sizeof(arrayMethodStrings) / sizeof(arrayMethodStrings[0]); i++) {
+        defineNative(arrayMethodStrings[i], arrayMethods[i], &vm.arrayNativeMethods);
+    }
+}
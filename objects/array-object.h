@@ -0,0 +1,10 @@
+#ifndef Pa_array_h
+#define Pa_array_h
+
+#include "../src/object.h"
+#include "../src/value.h"
+#include "../src/vm.h"
+
+void initArrayMethods();
+
+#endif
@@ -0,0 +1,71 @@
+#include "objects.h"
+#include "../src/memory.h"
+
+// append(value...) adds each value and returns the builder, so calls
+// can be chained.
+static Value appendMethod(int argCount, Value *args) {
+    if (argCount == 0) {
+        runtimeError("Expected at least 1 argument but got 0 from 'append()'.");
+        return NOTCLEAR;
+    }
+
+    ObjStringBuilder* builder = AS_STRING_BUILDER(args[0]);
+    for (int i = 1; i <= argCount; i++) {
+        builderAppendValue(builder, args[i]);
+    }
+
+    return args[0];
+}
+
+static Value lengthMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'length()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    return NUMBER_VAL(AS_STRING_BUILDER(args[0])->length);
+}
+
+// Long text is made a string as it is, without hashing or interning.
+static Value toStringMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'toString()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjStringBuilder* builder = AS_STRING_BUILDER(args[0]);
+    return OBJ_VAL(copyRuntimeString(builder->chars != NULL ? builder->chars : "",
+                                     builder->length));
+}
+
+// Keeps the buffer for the next round of appends.
+static Value clearMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'clear()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    AS_STRING_BUILDER(args[0])->length = 0;
+    return args[0];
+}
+
+//
+void initBuilderMethods() {
+    char* builderMethodStrings[] = {
+        "append",
+        "length",
+        "toString",
+        "clear",
+    };
+
+    NativeFn builderMethods[] = {
+        appendMethod,
+        lengthMethod,
+        toStringMethod,
+        clearMethod,
+    };
+
+    for (uint8_t i = 0; i < sizeof(builderMethodStrings) / sizeof(builderMethodStrings[0]); i++) {
+        defineNative(builderMethodStrings[i], builderMethods[i], &vm.builderNativeMethods);
+    }
+}
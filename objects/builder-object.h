@@ -0,0 +1,10 @@
+#ifndef Pa_builder_h
+#define Pa_builder_h
+
+#include "../src/object.h"
+#include "../src/value.h"
+#include "../src/vm.h"
+
+void initBuilderMethods();
+
+#endif
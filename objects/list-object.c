@@ -1,4 +1,9 @@
+#include <math.h>
+#include <string.h>
+
 #include "objects.h"
+#include "list-sort.h"
+#include "../src/memory.h"
 
 static Value appendMethod(int argCount, Value *args) {
     if (argCount != 1) {
@@ -69,6 +74,92 @@ static Value removeMethod(int argCount, Value *args) {
     return CLEAR; // Clang
 }
 
+static Value pushFrontMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'pushFront()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    insertIntoList(AS_LIST(args[0]), 0, args[1]);
+    return CLEAR;
+}
+
+static Value popFrontMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'popFront()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+
+    if (list->items.count == 0) {
+        runtimeError("Can not remove from an empty list from 'popFront()'.");
+        return NOTCLEAR;
+    }
+
+    Value first = list->items.values[0];
+    deleteFromList(list, 0);
+    return first;
+}
+
+// Puts the value before the item at 'index', an index equal to the
+// length appends it.
+static Value insertMethod(int argCount, Value *args) {
+    if (argCount != 2) {
+        runtimeError("Expected 2 arguments but got %d from 'insert()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!IS_NUMBER(args[1])) {
+        runtimeError("Index must be a number from 'insert()'.");
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+    int index = AS_NUMBER(args[1]);
+    if (index < 0) {
+        index = list->items.count + index;
+    }
+
+    if (index < 0 || index > list->items.count) {
+        runtimeError("Index out of bounds.");
+        return NOTCLEAR;
+    }
+
+    insertIntoList(list, index, args[2]);
+    return CLEAR;
+}
+
+// Moves the items toward the back by 'steps', 1 by default, the last
+// ones coming around to the front. Negative steps go the other way.
+static Value rotateMethod(int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError("Expected 0 or 1 arguments but got %d from 'rotate()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+
+    int steps = 1;
+    if (argCount == 1) {
+        if (!IS_NUMBER(args[1])) {
+            runtimeError("Argument must be a number from 'rotate()'.");
+            return NOTCLEAR;
+        }
+
+        double by = AS_NUMBER(args[1]);
+        if (!isfinite(by) || by != floor(by)) {
+            runtimeError("Argument must be a whole number from 'rotate()'.");
+            return NOTCLEAR;
+        }
+
+        steps = list->items.count > 0 ? (int)fmod(by, list->items.count) : 0;
+    }
+
+    rotateList(list, steps);
+    return CLEAR;
+}
+
 static Value allMethod(int argCount, Value *args) {
     if (argCount != 0) {
         runtimeError("Expected 0 arguments but got %d from 'length()'.", argCount);
@@ -163,17 +254,15 @@ static Value reverseMethod(int argCount, Value* args) {
 }
 
 static ObjList* copyList(ObjList* list) {
-    ObjList* copy = newList();
     const int length = list->items.count;
+    ObjList* copy = newListWithCapacity(length);
     push(OBJ_VAL(copy));
 
-    for (int i = 0; i < length; i++) {
+    for (int i = 0; i < length && i < list->items.count; i++) {
         Value val = list->items.values[i];
 
-        if (list->items.count != 0) {
-            if (IS_LIST(val)) {
-                val = OBJ_VAL(copyList(AS_LIST(val)));
-            }
+        if (IS_LIST(val)) {
+            val = OBJ_VAL(copyList(AS_LIST(val)));
         }
 
         push(val);
@@ -195,38 +284,73 @@ static Value copyMethod(int argCount, Value* args) {
     return OBJ_VAL(copyList(list));
 }
 
-// O(n^2) time complexity...
-static ObjList* flattenList(ObjList* list) {
-    if (list->items.count <= 1) {
-        return list;
-    }
+// Deeper than this the list most likely holds itself.
+#define FLATTEN_NESTING_MAX 4096
 
-    ObjList* res = newList();
-    push(OBJ_VAL(res));
+// How many items flattening 'depth' levels gives, or -1 if the lists
+// nest deeper than FLATTEN_NESTING_MAX. A negative depth has no limit.
+static int flattenedCount(ObjList* list, int depth, int nesting) {
+    if (nesting > FLATTEN_NESTING_MAX) return -1;
 
+    int count = 0;
     for (int i = 0; i < list->items.count; i++) {
-        if (IS_LIST(list->items.values[i])) {
-            ObjList* temp = flattenList(AS_LIST(list->items.values[i]));
-            for (int j = 0; j < temp->items.count; j++) {
-                appendToList(res, temp->items.values[j]);
-            }
+        Value item = list->items.values[i];
+
+        if (depth != 0 && IS_LIST(item)) {
+            int inner = flattenedCount(AS_LIST(item), depth - 1, nesting + 1);
+            if (inner < 0) return -1;
+
+            count += inner;
         } else {
-            appendToList(res, list->items.values[i]);
+            count++;
         }
     }
 
-    pop();
-    return res;
+    return count;
 }
 
+// Nothing is allocated here, the result was sized beforehand.
+static void flattenInto(ObjList* res, ObjList* list, int depth) {
+    for (int i = 0; i < list->items.count; i++) {
+        Value item = list->items.values[i];
+
+        if (depth != 0 && IS_LIST(item)) {
+            flattenInto(res, AS_LIST(item), depth - 1);
+        } else {
+            res->items.values[res->items.count++] = item;
+            writeBarrier((Obj*)res, item);
+        }
+    }
+}
+
+// Flattens every level, or just 'depth' of them, into a new list.
 static Value flattenMethod(int argCount, Value* args) {
-    if (argCount != 0) {
-        runtimeError("Expected 0 arguments but got %d from 'flatten()'.", argCount);
+    if (argCount > 1) {
+        runtimeError("Expected 0 or 1 arguments but got %d from 'flatten()'.", argCount);
         return NOTCLEAR;
     }
 
+    int depth = -1;
+    if (argCount == 1) {
+        if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 0) {
+            runtimeError("Depth must be a positive number from 'flatten()'.");
+            return NOTCLEAR;
+        }
+
+        depth = AS_NUMBER(args[1]);
+    }
+
     ObjList* list = AS_LIST(args[0]);
-    return OBJ_VAL(flattenList(list));
+    int count = flattenedCount(list, depth, 0);
+    if (count < 0) {
+        runtimeError("Lists nest too deeply, or contain themselves, from 'flatten()'.");
+        info("Max nesting is %d", FLATTEN_NESTING_MAX);
+        return NOTCLEAR;
+    }
+
+    ObjList* res = newListWithCapacity(count);
+    flattenInto(res, list, depth);
+    return OBJ_VAL(res);
 }
 
 static Value sliceMethod(int argCount, Value* args) {
@@ -245,9 +369,6 @@ static Value sliceMethod(int argCount, Value* args) {
 
     ObjList* list = AS_LIST(args[0]);
 
-    ObjList* res = newList();
-    push(OBJ_VAL(res));
-
     if (start < 0) {
         start = 0;
     }
@@ -255,20 +376,422 @@ static Value sliceMethod(int argCount, Value* args) {
         limit = list->items.count;
     }
 
-    for (int i = start; i < limit; i++) {
-        appendToList(res, list->items.values[i]);
+    int count = limit > start ? limit - start : 0;
+    ObjList* res = newListWithCapacity(count);
+    if (count > 0) {
+        appendValuesToList(res, &list->items.values[start], count);
+    }
+
+    return OBJ_VAL(res);
+}
+
+// Makes room for 'n' items in total, so appending up to that many
+// never grows the list.
+static Value reserveMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'reserve()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 0 || AS_NUMBER(args[1]) > INT32_MAX) {
+        runtimeError("Argument must be a positive number from 'reserve()'.");
+        return NOTCLEAR;
+    }
+
+    reserveList(AS_LIST(args[0]), AS_NUMBER(args[1]));
+    return CLEAR;
+}
+
+static Value shrinkMethod(int argCount, Value* args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'shrink()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    shrinkList(AS_LIST(args[0]));
+    return CLEAR;
+}
+
+// Lists of numbers or strings only, the kind is checked in one pass
+// so the comparisons themselves don't look at types.
+static bool sortableKind(ObjList* list, SortKind* kind, const char* method) {
+    *kind = sortKindOf(list->items.values, list->items.count);
+    if (*kind == SORT_MIXED) {
+        runtimeError("List must contain only numbers or only strings from '%s()'.", method);
+        return false;
     }
 
-    pop(res);
+    return true;
+}
+
+static bool checkFunction(Value value, const char* method) {
+    if (!isCallable(value)) {
+        runtimeError("Argument must be a function from '%s()'.", method);
+        return false;
+    }
+
+    return true;
+}
+
+// A new list holding the same values, sized once.
+static ObjList* shallowCopyList(ObjList* list) {
+    ObjList* res = newListWithCapacity(list->items.count);
+    appendValuesToList(res, list->items.values, list->items.count);
+    return res;
+}
+
+// The callbacks below run Pa code through vmCall(), which may change
+// the list. The length is taken once, so items appended meanwhile are
+// not visited, and the loop stops early if the list shrinks.
+static Value eachMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'each()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "each")) return NOTCLEAR;
+
+    ObjList* list = AS_LIST(args[0]);
+    Value action = args[1];
+
+    int count = list->items.count;
+    for (int i = 0; i < count && i < list->items.count; i++) {
+        Value result;
+        if (!vmCall(action, 1, &list->items.values[i], &result)) return NOTCLEAR;
+    }
+
+    return CLEAR;
+}
+
+static Value mapMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'map()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "map")) return NOTCLEAR;
+
+    ObjList* list = AS_LIST(args[0]);
+    Value action = args[1];
+
+    int count = list->items.count;
+    ObjList* res = newListWithCapacity(count);
+    push(OBJ_VAL(res));
+
+    for (int i = 0; i < count && i < list->items.count; i++) {
+        Value item;
+        if (!vmCall(action, 1, &list->items.values[i], &item)) return NOTCLEAR;
+
+        push(item);
+        appendToList(res, item);
+        pop();
+    }
+
+    pop();
     return OBJ_VAL(res);
 }
 
+static Value filterMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'filter()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "filter")) return NOTCLEAR;
+
+    ObjList* list = AS_LIST(args[0]);
+    Value test = args[1];
+
+    int count = list->items.count;
+    ObjList* res = newList();
+    push(OBJ_VAL(res));
+
+    for (int i = 0; i < count && i < list->items.count; i++) {
+        Value item = list->items.values[i];
+        Value keep;
+        if (!vmCall(test, 1, &item, &keep)) return NOTCLEAR;
+
+        if (!isFalsey(keep)) {
+            push(item);
+            appendToList(res, item);
+            pop();
+        }
+    }
+
+    pop();
+    return OBJ_VAL(res);
+}
+
+// Without an initial value the first item starts the reduction.
+static Value reduceMethod(int argCount, Value* args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError("Expected 1 or 2 arguments but got %d from 'reduce()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "reduce")) return NOTCLEAR;
+
+    ObjList* list = AS_LIST(args[0]);
+    Value action = args[1];
+
+    int start = 0;
+    Value callArgs[2];
+    if (argCount == 2) {
+        callArgs[0] = args[2];
+    } else if (list->items.count > 0) {
+        callArgs[0] = list->items.values[0];
+        start = 1;
+    } else {
+        runtimeError("Can't reduce an empty list without an initial value from 'reduce()'.");
+        return NOTCLEAR;
+    }
+
+    // The accumulator stays on the stack between calls.
+    int count = list->items.count;
+    push(callArgs[0]);
+    for (int i = start; i < count && i < list->items.count; i++) {
+        callArgs[1] = list->items.values[i];
+        if (!vmCall(action, 2, callArgs, &callArgs[0])) return NOTCLEAR;
+        vm.stackTop[-1] = callArgs[0];
+    }
+    pop();
+
+    return callArgs[0];
+}
+
+// The first item passing the test, or the default if none does.
+static Value findMethod(int argCount, Value* args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError("Expected 1 or 2 arguments but got %d from 'find()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "find")) return NOTCLEAR;
+
+    ObjList* list = AS_LIST(args[0]);
+    Value test = args[1];
+    Value fallback = argCount == 2 ? args[2] : NIL_VAL;
+
+    int count = list->items.count;
+    for (int i = 0; i < count && i < list->items.count; i++) {
+        Value item = list->items.values[i];
+        Value found;
+        if (!vmCall(test, 1, &item, &found)) return NOTCLEAR;
+
+        if (!isFalsey(found)) {
+            return item;
+        }
+    }
+
+    if (argCount == 2) {
+        return fallback;
+    }
+
+    runtimeError("No item passed the test from 'find()'.");
+    return NOTCLEAR;
+}
+
+// The keys are worked out first, then the items are sorted by them
+// without calling back again.
+static Value sortListBy(ObjList* list, Value key, const char* method) {
+    int count = list->items.count;
+    ObjList* keys = newListWithCapacity(count);
+    push(OBJ_VAL(keys));
+
+    for (int i = 0; i < count && i < list->items.count; i++) {
+        Value item;
+        if (!vmCall(key, 1, &list->items.values[i], &item)) return NOTCLEAR;
+
+        push(item);
+        appendToList(keys, item);
+        pop();
+    }
+
+    if (list->items.count != count) {
+        runtimeError("List changed while sorting from '%s()'.", method);
+        return NOTCLEAR;
+    }
+
+    SortKind kind;
+    if (!sortableKind(keys, &kind, method)) {
+        return NOTCLEAR;
+    }
+
+    sortValuesByKeys(list->items.values, keys->items.values, count, kind);
+
+    pop();
+    return CLEAR;
+}
+
+// Bottom-up merge sort, stable, 'compare' returns a negative number
+// when its first argument goes first. The values move between two
+// lists of their own so the comparator can't pull them from under
+// the sort.
+static Value sortListWith(ObjList* list, Value compare, const char* method) {
+    int count = list->items.count;
+    if (count < 2) return CLEAR;
+
+    ObjList* from = shallowCopyList(list);
+    push(OBJ_VAL(from));
+    ObjList* to = shallowCopyList(list);
+    push(OBJ_VAL(to));
+
+    Value callArgs[2];
+    for (int width = 1; width < count; width *= 2) {
+        for (int low = 0; low < count; low += width * 2) {
+            int mid = low + width < count ? low + width : count;
+            int high = mid + width < count ? mid + width : count;
+
+            int i = low;
+            int j = mid;
+            for (int k = low; k < high; k++) {
+                bool takeLeft = i < mid;
+                if (takeLeft && j < high) {
+                    Value order;
+                    callArgs[0] = from->items.values[j];
+                    callArgs[1] = from->items.values[i];
+                    if (!vmCall(compare, 2, callArgs, &order)) return NOTCLEAR;
+
+                    if (!IS_NUMBER(order)) {
+                        runtimeError("Comparator must return a number from '%s()'.", method);
+                        return NOTCLEAR;
+                    }
+
+                    takeLeft = AS_NUMBER(order) >= 0;
+                }
+
+                Value item = takeLeft ? from->items.values[i++] : from->items.values[j++];
+                to->items.values[k] = item;
+                writeBarrier((Obj*)to, item);
+            }
+        }
+
+        ObjList* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (list->items.count != count) {
+        runtimeError("List changed while sorting from '%s()'.", method);
+        return NOTCLEAR;
+    }
+
+    for (int i = 0; i < count; i++) {
+        list->items.values[i] = from->items.values[i];
+        writeBarrier((Obj*)list, from->items.values[i]);
+    }
+
+    pop();
+    pop();
+    return CLEAR;
+}
+
+// Functions taking two arguments are comparators, the rest give keys.
+static bool isComparator(Value function) {
+    if (IS_CLOSURE(function)) {
+        return AS_CLOSURE(function)->function->arity == 2;
+    }
+
+    if (IS_BOUND_METHOD(function)) {
+        return AS_BOUND_METHOD(function)->method->function->arity == 2;
+    }
+
+    return false;
+}
+
+static Value sortMethod(int argCount, Value* args) {
+    if (argCount > 1) {
+        runtimeError("Expected 0 or 1 arguments but got %d from 'sort()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+
+    if (argCount == 1) {
+        if (!checkFunction(args[1], "sort")) return NOTCLEAR;
+
+        Value function = args[1];
+        if (isComparator(function)) {
+            return sortListWith(list, function, "sort");
+        }
+
+        return sortListBy(list, function, "sort");
+    }
+
+    SortKind kind;
+    if (!sortableKind(list, &kind, "sort")) {
+        return NOTCLEAR;
+    }
+
+    sortValues(list->items.values, list->items.count, kind);
+    return CLEAR;
+}
+
+static Value sortStableMethod(int argCount, Value* args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'sortStable()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+    SortKind kind;
+    if (!sortableKind(list, &kind, "sortStable")) {
+        return NOTCLEAR;
+    }
+
+    sortValuesStable(list->items.values, list->items.count, kind);
+    return CLEAR;
+}
+
+static Value sortedMethod(int argCount, Value* args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'sorted()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+    SortKind kind;
+    if (!sortableKind(list, &kind, "sorted")) {
+        return NOTCLEAR;
+    }
+
+    ObjList* res = shallowCopyList(list);
+    sortValues(res->items.values, res->items.count, kind);
+    return OBJ_VAL(res);
+}
+
+static Value sortByMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'sortBy()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "sortBy")) return NOTCLEAR;
+
+    return sortListBy(AS_LIST(args[0]), args[1], "sortBy");
+}
+
+static Value sortWithMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'sortWith()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "sortWith")) return NOTCLEAR;
+
+    return sortListWith(AS_LIST(args[0]), args[1], "sortWith");
+}
+
 //
 void initListMethods() {
     char* listMethodStrings[] = {
         "append",
         "length",
         "remove",
+        "pushFront",
+        "popFront",
+        "insert",
+        "rotate",
         "contains",
         "index",
         "clear",
@@ -278,12 +801,28 @@ void initListMethods() {
         "copy",
         "flatten",
         "slice",
+        "sort",
+        "sortStable",
+        "sorted",
+        "reserve",
+        "shrink",
+        "sortBy",
+        "sortWith",
+        "each",
+        "map",
+        "filter",
+        "reduce",
+        "find",
     };
 
     NativeFn listMethods[] = {
         appendMethod,
         lengthMethod,
         removeMethod,
+        pushFrontMethod,
+        popFrontMethod,
+        insertMethod,
+        rotateMethod,
         containMethod,
         indexMethod,
         clearMethod,
@@ -293,19 +832,21 @@ void initListMethods() {
         copyMethod,
         flattenMethod,
         sliceMethod,
+        sortMethod,
+        sortStableMethod,
+        sortedMethod,
+        reserveMethod,
+        shrinkMethod,
+        sortByMethod,
+        sortWithMethod,
+        eachMethod,
+        mapMethod,
+        filterMethod,
+        reduceMethod,
+        findMethod,
     };
 
     for (uint8_t i = 0; i < sizeof(listMethodStrings) / sizeof(listMethodStrings[0]); i++) {
         defineNative(listMethodStrings[i], listMethods[i], &vm.listNativeMethods);
     }
-
-    interpret(LIST_EXTRA, "List");
-
-    Value val;
-    tableGet(&vm.libraries, copyString("List", 4), &val);
-
-    ObjLibrary* library = AS_LIBRARY(val);
-    push(val);
-    tableAddAll(&library->values, &vm.listNativeMethods);
-    pop();
-}
\ No newline at end of file
+}
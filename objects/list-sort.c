@@ -0,0 +1,311 @@
+#include <string.h>
+
+#include "list-sort.h"
+#include "../src/memory.h"
+#include "../src/object.h"
+
+// Below this many, partitions and runs are insertion sorted.
+#define INSERTION_MAX 16
+#define MIN_RUN 32
+
+// Deep enough for runs that at least grow like Fibonacci numbers.
+#define RUN_STACK_MAX 64
+
+typedef struct {
+    Value key;
+    Value value;
+} SortPair;
+
+SortKind sortKindOf(Value* values, int count) {
+    if (count == 0) return SORT_NUMBERS;
+
+    if (IS_NUMBER(values[0])) {
+        for (int i = 1; i < count; i++) {
+            if (!IS_NUMBER(values[i])) return SORT_MIXED;
+        }
+        return SORT_NUMBERS;
+    }
+
+    if (IS_STRING(values[0])) {
+        for (int i = 1; i < count; i++) {
+            if (!IS_STRING(values[i])) return SORT_MIXED;
+        }
+        return SORT_STRINGS;
+    }
+
+    return SORT_MIXED;
+}
+
+// NaN goes after everything else, so the order stays total.
+static inline bool numberLess(Value a, Value b) {
+    double x = AS_NUMBER(a);
+    double y = AS_NUMBER(b);
+    return x < y || (y != y && x == x);
+}
+
+static inline bool stringLess(Value a, Value b) {
+    ObjString* x = AS_STRING(a);
+    ObjString* y = AS_STRING(b);
+    int length = x->length < y->length ? x->length : y->length;
+
+    int order = memcmp(x->chars, y->chars, length);
+    return order < 0 || (order == 0 && x->length < y->length);
+}
+
+#define PAIR_NUMBER_LESS(a, b) numberLess((a).key, (b).key)
+#define PAIR_STRING_LESS(a, b) stringLess((a).key, (b).key)
+
+// Quicksort on the median of three, falling back to heapsort once it
+// goes too deep. Each comparison gets its own copy so it is inlined.
+#define DEFINE_INTROSORT(name, LESS)                                        \
+    static void name##Insertion(Value* items, int count) {                 \
+        for (int i = 1; i < count; i++) {                                   \
+            Value item = items[i];                                          \
+            int j = i;                                                      \
+            while (j > 0 && LESS(item, items[j - 1])) {                     \
+                items[j] = items[j - 1];                                    \
+                j--;                                                        \
+            }                                                               \
+            items[j] = item;                                                \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    static void name##SiftDown(Value* items, int root, int count) {        \
+        Value item = items[root];                                           \
+        for (;;) {                                                          \
+            int child = root * 2 + 1;                                       \
+            if (child >= count) break;                                      \
+            if (child + 1 < count && LESS(items[child], items[child + 1])) {\
+                child++;                                                    \
+            }                                                               \
+            if (!LESS(item, items[child])) break;                           \
+            items[root] = items[child];                                     \
+            root = child;                                                   \
+        }                                                                   \
+        items[root] = item;                                                 \
+    }                                                                       \
+                                                                            \
+    static void name##Heapsort(Value* items, int count) {                  \
+        for (int i = count / 2 - 1; i >= 0; i--) {                          \
+            name##SiftDown(items, i, count);                                \
+        }                                                                   \
+        for (int end = count - 1; end > 0; end--) {                         \
+            Value top = items[0];                                           \
+            items[0] = items[end];                                          \
+            items[end] = top;                                               \
+            name##SiftDown(items, 0, end);                                  \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    static void name(Value* items, int count, int depth) {                 \
+        while (count > INSERTION_MAX) {                                     \
+            if (depth-- == 0) {                                             \
+                name##Heapsort(items, count);                               \
+                return;                                                     \
+            }                                                               \
+                                                                            \
+            int mid = count / 2;                                            \
+            Value swap;                                                     \
+            if (LESS(items[mid], items[0])) {                               \
+                swap = items[0]; items[0] = items[mid]; items[mid] = swap;  \
+            }                                                               \
+            if (LESS(items[count - 1], items[mid])) {                       \
+                swap = items[mid]; items[mid] = items[count - 1];           \
+                items[count - 1] = swap;                                    \
+                if (LESS(items[mid], items[0])) {                           \
+                    swap = items[0]; items[0] = items[mid];                 \
+                    items[mid] = swap;                                      \
+                }                                                           \
+            }                                                               \
+                                                                            \
+            /* Hoare's partition, the pivot stops both scans. */            \
+            Value pivot = items[mid];                                       \
+            int i = -1;                                                     \
+            int j = count;                                                  \
+            for (;;) {                                                      \
+                do i++; while (LESS(items[i], pivot));                      \
+                do j--; while (LESS(pivot, items[j]));                      \
+                if (i >= j) break;                                          \
+                swap = items[i]; items[i] = items[j]; items[j] = swap;      \
+            }                                                               \
+                                                                            \
+            /* Recurses into the smaller side, so the stack stays small. */ \
+            int left = j + 1;                                               \
+            if (left < count - left) {                                      \
+                name(items, left, depth);                                   \
+                items += left;                                              \
+                count -= left;                                              \
+            } else {                                                        \
+                name(items + left, count - left, depth);                    \
+                count = left;                                               \
+            }                                                               \
+        }                                                                   \
+                                                                            \
+        name##Insertion(items, count);                                      \
+    }
+
+// Finds the natural runs, reversing the strictly descending ones, and
+// extends the short ones by binary insertion. Runs are merged keeping
+// the stack lengths growing like timsort, without galloping.
+#define DEFINE_STABLE_SORT(name, Type, LESS)                                \
+    static void name##Insertion(Type* items, int start, int sorted,        \
+                                int end) {                                  \
+        for (int i = sorted; i < end; i++) {                                \
+            Type item = items[i];                                           \
+            int low = start;                                                \
+            int high = i;                                                   \
+            while (low < high) {                                            \
+                int mid = low + (high - low) / 2;                           \
+                if (LESS(item, items[mid])) high = mid;                     \
+                else low = mid + 1;                                         \
+            }                                                               \
+            memmove(&items[low + 1], &items[low],                           \
+                    sizeof(Type) * (i - low));                              \
+            items[low] = item;                                              \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    static int name##Run(Type* items, int start, int count) {              \
+        int end = start + 1;                                                \
+        if (end == count) return end;                                       \
+                                                                            \
+        if (LESS(items[end], items[start])) {                               \
+            while (end + 1 < count && LESS(items[end + 1], items[end])) {   \
+                end++;                                                      \
+            }                                                               \
+            end++;                                                          \
+            for (int i = start, j = end - 1; i < j; i++, j--) {             \
+                Type swap = items[i];                                       \
+                items[i] = items[j];                                        \
+                items[j] = swap;                                            \
+            }                                                               \
+        } else {                                                            \
+            while (end + 1 < count && !LESS(items[end + 1], items[end])) {  \
+                end++;                                                      \
+            }                                                               \
+            end++;                                                          \
+        }                                                                   \
+                                                                            \
+        return end;                                                         \
+    }                                                                       \
+                                                                            \
+    static void name##Merge(Type* items, Type* buffer, int low, int mid,   \
+                            int high) {                                     \
+        if (!LESS(items[mid], items[mid - 1])) return;                      \
+                                                                            \
+        int leftCount = mid - low;                                          \
+        memcpy(buffer, &items[low], sizeof(Type) * leftCount);              \
+                                                                            \
+        int i = 0;                                                          \
+        int j = mid;                                                        \
+        int k = low;                                                        \
+        while (i < leftCount && j < high) {                                 \
+            if (LESS(items[j], buffer[i])) items[k++] = items[j++];         \
+            else items[k++] = buffer[i++];                                  \
+        }                                                                   \
+        memcpy(&items[k], &buffer[i], sizeof(Type) * (leftCount - i));      \
+    }                                                                       \
+                                                                            \
+    static void name(Type* items, Type* buffer, int count) {               \
+        int runStart[RUN_STACK_MAX];                                        \
+        int runLength[RUN_STACK_MAX];                                       \
+        int runCount = 0;                                                   \
+                                                                            \
+        int start = 0;                                                      \
+        while (start < count) {                                             \
+            int end = name##Run(items, start, count);                       \
+            if (end - start < MIN_RUN) {                                    \
+                int forced = start + MIN_RUN < count ? start + MIN_RUN      \
+                                                     : count;               \
+                name##Insertion(items, start, end, forced);                 \
+                end = forced;                                               \
+            }                                                               \
+                                                                            \
+            runStart[runCount] = start;                                     \
+            runLength[runCount] = end - start;                              \
+            runCount++;                                                     \
+            start = end;                                                    \
+                                                                            \
+            while (runCount > 1) {                                          \
+                int n = runCount - 2;                                       \
+                bool isFinal = start == count;                              \
+                if ((n > 0 &&                                               \
+                     runLength[n - 1] <= runLength[n] + runLength[n + 1]) ||\
+                    (n > 1 &&                                               \
+                     runLength[n - 2] <= runLength[n - 1] + runLength[n])) {\
+                    if (runLength[n - 1] < runLength[n + 1]) n--;           \
+                } else if (!isFinal && runLength[n] > runLength[n + 1]) {   \
+                    break;                                                  \
+                } else if (isFinal && n > 0 &&                              \
+                           runLength[n - 1] < runLength[n + 1]) {           \
+                    n--;                                                    \
+                }                                                           \
+                                                                            \
+                name##Merge(items, buffer, runStart[n], runStart[n + 1],    \
+                            runStart[n + 1] + runLength[n + 1]);            \
+                runLength[n] += runLength[n + 1];                           \
+                for (int r = n + 1; r < runCount - 1; r++) {                \
+                    runStart[r] = runStart[r + 1];                          \
+                    runLength[r] = runLength[r + 1];                        \
+                }                                                           \
+                runCount--;                                                 \
+            }                                                               \
+        }                                                                   \
+    }
+
+DEFINE_INTROSORT(introsortNumbers, numberLess)
+DEFINE_INTROSORT(introsortStrings, stringLess)
+DEFINE_STABLE_SORT(stableSortNumbers, Value, numberLess)
+DEFINE_STABLE_SORT(stableSortStrings, Value, stringLess)
+DEFINE_STABLE_SORT(stableSortNumberPairs, SortPair, PAIR_NUMBER_LESS)
+DEFINE_STABLE_SORT(stableSortStringPairs, SortPair, PAIR_STRING_LESS)
+
+void sortValues(Value* values, int count, SortKind kind) {
+    int depth = 0;
+    for (int n = count; n > 1; n >>= 1) depth += 2;
+
+    if (kind == SORT_NUMBERS) {
+        introsortNumbers(values, count, depth);
+    } else {
+        introsortStrings(values, count, depth);
+    }
+}
+
+void sortValuesStable(Value* values, int count, SortKind kind) {
+    if (count < 2) return;
+
+    Value* buffer = ALLOCATE(Value, count);
+    if (kind == SORT_NUMBERS) {
+        stableSortNumbers(values, buffer, count);
+    } else {
+        stableSortStrings(values, buffer, count);
+    }
+    FREE_ARRAY(Value, buffer, count);
+}
+
+void sortValuesByKeys(Value* values, Value* keys, int count, SortKind kind) {
+    if (count < 2) return;
+
+    // Both arrays are allocated before the values leave the list, a
+    // collection can't run while they are only held here.
+    SortPair* pairs = ALLOCATE(SortPair, count);
+    SortPair* buffer = ALLOCATE(SortPair, count);
+
+    for (int i = 0; i < count; i++) {
+        pairs[i].key = keys[i];
+        pairs[i].value = values[i];
+    }
+
+    if (kind == SORT_NUMBERS) {
+        stableSortNumberPairs(pairs, buffer, count);
+    } else {
+        stableSortStringPairs(pairs, buffer, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        values[i] = pairs[i].value;
+    }
+
+    FREE_ARRAY(SortPair, buffer, count);
+    FREE_ARRAY(SortPair, pairs, count);
+}
@@ -0,0 +1,25 @@
+#ifndef Pa_list_sort_h
+#define Pa_list_sort_h
+
+#include "../src/value.h"
+
+// Only lists of all numbers or all strings have an order, numbers
+// compare by value with NaN last and strings byte by byte.
+typedef enum {
+    SORT_NUMBERS,
+    SORT_STRINGS,
+    SORT_MIXED,
+} SortKind;
+
+SortKind sortKindOf(Value* values, int count);
+
+// Introsort, the order of equal values is not kept.
+void sortValues(Value* values, int count, SortKind kind);
+
+// Merges natural runs like timsort, equal values keep their order.
+void sortValuesStable(Value* values, int count, SortKind kind);
+
+// Stable, 'values' are ordered by the matching 'keys' of 'kind'.
+void sortValuesByKeys(Value* values, Value* keys, int count, SortKind kind);
+
+#endif
@@ -0,0 +1,142 @@
+#include "objects.h"
+
+static bool checkKey(Value key, const char* method) {
+    if (!isHashable(key)) {
+        runtimeError("Type '%s' can not be a map key from '%s()'.", typeValue(key), method);
+        return false;
+    }
+
+    return true;
+}
+
+static Value keysMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'keys()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjMap* map = AS_MAP(args[0]);
+    ObjList* keys = newList();
+    push(OBJ_VAL(keys));
+
+    for (int i = 0; i < map->items.capacity; i++) {
+        ValueEntry* entry = &map->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        appendToList(keys, entry->key);
+    }
+
+    pop();
+    return OBJ_VAL(keys);
+}
+
+static Value valuesMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'values()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjMap* map = AS_MAP(args[0]);
+    ObjList* values = newList();
+    push(OBJ_VAL(values));
+
+    for (int i = 0; i < map->items.capacity; i++) {
+        ValueEntry* entry = &map->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        appendToList(values, entry->value);
+    }
+
+    pop();
+    return OBJ_VAL(values);
+}
+
+static Value hasMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'has()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkKey(args[1], "has")) return NOTCLEAR;
+
+    Value value;
+    return BOOL_VAL(mapGet(AS_MAP(args[0]), args[1], &value));
+}
+
+// The value for the key, or the default if it has none.
+static Value getMethod(int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError("Expected 1 or 2 arguments but got %d from 'get()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkKey(args[1], "get")) return NOTCLEAR;
+
+    Value value;
+    if (mapGet(AS_MAP(args[0]), args[1], &value)) {
+        return value;
+    }
+
+    if (argCount == 2) {
+        return args[2];
+    }
+
+    runtimeError("Key not found in map from 'get()'.");
+    return NOTCLEAR;
+}
+
+static Value removeMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'remove()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkKey(args[1], "remove")) return NOTCLEAR;
+
+    ObjMap* map = AS_MAP(args[0]);
+    Value value;
+
+    if (!mapGet(map, args[1], &value)) {
+        runtimeError("Key not found in map from 'remove()'.");
+        return NOTCLEAR;
+    }
+
+    mapDelete(map, args[1]);
+    return value;
+}
+
+static Value lengthMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'length()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjMap* map = AS_MAP(args[0]);
+
+    return NUMBER_VAL(map->items.count);
+}
+
+//
+void initMapMethods() {
+    char* mapMethodStrings[] = {
+        "keys",
+        "values",
+        "has",
+        "get",
+        "remove",
+        "length",
+    };
+
+    NativeFn mapMethods[] = {
+        keysMethod,
+        valuesMethod,
+        hasMethod,
+        getMethod,
+        removeMethod,
+        lengthMethod,
+    };
+
+    for (uint8_t i = 0; i < sizeof(mapMethodStrings) / sizeof(mapMethodStrings[0]); i++) {
+        defineNative(mapMethodStrings[i], mapMethods[i], &vm.mapNativeMethods);
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef Pa_map_h
+#define Pa_map_h
+
+#include "../src/object.h"
+#include "../src/value.h"
+#include "../src/vm.h"
+
+void initMapMethods();
+
+#endif
@@ -17,27 +17,43 @@ static Value boolMethod(int argCount, Value* args) {
     return FALSE_VAL;
 }
 
+// Calls 'action' with 0 up to the number, not included.
+static Value repeatMethod(int argCount, Value* args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'repeat()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!isCallable(args[1])) {
+        runtimeError("Argument must be a function from 'repeat()'.");
+        return NOTCLEAR;
+    }
+
+    double num = AS_NUMBER(args[0]);
+    Value action = args[1];
+
+    for (double i = 0; i < num; i++) {
+        Value index = NUMBER_VAL(i);
+        Value result;
+        if (!vmCall(action, 1, &index, &result)) return NOTCLEAR;
+    }
+
+    return CLEAR;
+}
+
 //
 void initNumberMethods() {
     char* numberMethodStrings[] = {
         "bool",
+        "repeat",
     };
 
     NativeFn numberMethods[] = {
-        boolMethod
+        boolMethod,
+        repeatMethod,
     };
 
     for (uint8_t i = 0; i < sizeof(numberMethodStrings) / sizeof(numberMethodStrings[0]); i++) {
         defineNative(numberMethodStrings[i], numberMethods[i], &vm.numberNativeMethods);
     }
-
-    interpret(NUMBER_EXTRA, "Number");
-
-    Value val;
-    tableGet(&vm.libraries, copyString("Number", 6), &val);
-
-    ObjLibrary* library = AS_LIBRARY(val);
-    push(val);
-    tableAddAll(&library->values, &vm.numberNativeMethods);
-    pop();
 }
\ No newline at end of file
@@ -7,18 +7,4 @@
 
 void initNumberMethods();
 
-//VM re-enterability issues.
-//Written in Pa instead for the sake of simplicity too.
-#define NUMBER_EXTRA "//\n" \
-"define repeat(num, action) {\n" \
-"   assert type(action) == \"function\", \"Argument must be a function from 'repeat'.\";\n" \
-"\n"\
-"   for let i = 0; i < num; i++ {\n" \
-"       action(i);\n" \
-"   }\n" \
-"\n" \
-"   return 0;\n" \
-"}\n" \
-"\n"\
-
 #endif
\ No newline at end of file
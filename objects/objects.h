@@ -2,11 +2,17 @@
 #define Pa_objects_h
 
 #include "list-object.h"
+#include "map-object.h"
+#include "set-object.h"
+#include "array-object.h"
+#include "builder-object.h"
 #include "number-object.h"
 #include "string-object.h"
 
 
-#define NOTCLEAR NIL_VAL
+// Natives return this once they reported an error. It is the empty
+// value, which no script can hold, so none is an ordinary result.
+#define NOTCLEAR EMPTY_VAL
 #define CLEAR NUMBER_VAL(0)
 
 #endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "objects.h"
+
+static bool checkMember(Value value, const char* method) {
+    if (!isHashable(value)) {
+        runtimeError("Type '%s' can not be in a set from '%s()'.", typeValue(value), method);
+        return false;
+    }
+
+    return true;
+}
+
+static bool checkOtherSet(int argCount, Value *args, const char* method) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from '%s()'.", argCount, method);
+        return false;
+    }
+
+    if (!IS_SET(args[1])) {
+        runtimeError("Argument must be a set from '%s()'.", method);
+        return false;
+    }
+
+    return true;
+}
+
+static Value addMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'add()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkMember(args[1], "add")) return NOTCLEAR;
+
+    setAdd(AS_SET(args[0]), args[1]);
+    return CLEAR;
+}
+
+static Value hasMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'has()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    // Nothing unhashable can be in a set.
+    if (!isHashable(args[1])) return FALSE_VAL;
+
+    return BOOL_VAL(setHas(AS_SET(args[0]), args[1]));
+}
+
+static Value removeMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'remove()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!isHashable(args[1])) return FALSE_VAL;
+
+    return BOOL_VAL(setRemove(AS_SET(args[0]), args[1]));
+}
+
+static Value lengthMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'length()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    return NUMBER_VAL(AS_SET(args[0])->items.count);
+}
+
+static Value toListMethod(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d from 'toList()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    ObjSet* set = AS_SET(args[0]);
+    ObjList* list = newList();
+    push(OBJ_VAL(list));
+
+    for (int i = 0; i < set->items.capacity; i++) {
+        ValueEntry* entry = &set->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        appendToList(list, entry->key);
+    }
+
+    pop();
+    return OBJ_VAL(list);
+}
+
+// The results are sized once for the most they can hold, so filling
+// them never grows the table.
+static void addAll(ObjSet* to, ObjSet* from) {
+    for (int i = 0; i < from->items.capacity; i++) {
+        ValueEntry* entry = &from->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        setAdd(to, entry->key);
+    }
+}
+
+static Value unionMethod(int argCount, Value *args) {
+    if (!checkOtherSet(argCount, args, "union")) return NOTCLEAR;
+
+    ObjSet* a = AS_SET(args[0]);
+    ObjSet* b = AS_SET(args[1]);
+
+    ObjSet* result = newSet();
+    push(OBJ_VAL(result));
+    valueTableReserve(&result->items, a->items.count + b->items.count);
+
+    addAll(result, a);
+    addAll(result, b);
+
+    pop();
+    return OBJ_VAL(result);
+}
+
+static Value intersectionMethod(int argCount, Value *args) {
+    if (!checkOtherSet(argCount, args, "intersection")) return NOTCLEAR;
+
+    ObjSet* a = AS_SET(args[0]);
+    ObjSet* b = AS_SET(args[1]);
+
+    // Walks the smaller one, probing the larger.
+    if (a->items.count > b->items.count) {
+        ObjSet* swap = a;
+        a = b;
+        b = swap;
+    }
+
+    ObjSet* result = newSet();
+    push(OBJ_VAL(result));
+    valueTableReserve(&result->items, a->items.count);
+
+    for (int i = 0; i < a->items.capacity; i++) {
+        ValueEntry* entry = &a->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        if (setHas(b, entry->key)) setAdd(result, entry->key);
+    }
+
+    pop();
+    return OBJ_VAL(result);
+}
+
+static Value differenceMethod(int argCount, Value *args) {
+    if (!checkOtherSet(argCount, args, "difference")) return NOTCLEAR;
+
+    ObjSet* a = AS_SET(args[0]);
+    ObjSet* b = AS_SET(args[1]);
+
+    ObjSet* result = newSet();
+    push(OBJ_VAL(result));
+    valueTableReserve(&result->items, a->items.count);
+
+    for (int i = 0; i < a->items.capacity; i++) {
+        ValueEntry* entry = &a->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        if (!setHas(b, entry->key)) setAdd(result, entry->key);
+    }
+
+    pop();
+    return OBJ_VAL(result);
+}
+
+//
+void initSetMethods() {
+    char* setMethodStrings[] = {
+        "add",
+        "has",
+        "remove",
+        "length",
+        "toList",
+        "union",
+        "intersection",
+        "difference",
+    };
+
+    NativeFn setMethods[] = {
+        addMethod,
+        hasMethod,
+        removeMethod,
+        lengthMethod,
+        toListMethod,
+        unionMethod,
+        intersectionMethod,
+        differenceMethod,
+    };
+
+    for (uint8_t i = 0; i < sizeof(setMethodStrings) / sizeof(setMethodStrings[0]); i++) {
+        defineNative(setMethodStrings[i], setMethods[i], &vm.setNativeMethods);
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef Pa_set_h
+#define Pa_set_h
+
+#include "../src/object.h"
+#include "../src/value.h"
+#include "../src/vm.h"
+
+void initSetMethods();
+
+#endif
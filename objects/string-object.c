@@ -63,7 +63,7 @@ static Value splitMethod(int argCount, Value *args) {
 
             if (final) *final = '\0';
 
-            Value objStr = OBJ_VAL(copyString(alloc, strlen(alloc)));
+            Value objStr = OBJ_VAL(copyRuntimeString(alloc, strlen(alloc)));
 
             push(objStr);
             appendToList(l, objStr);
@@ -85,15 +85,13 @@ static Value lowerMethod(int argCount, Value *args) {
     } 
 
     ObjString* string = AS_STRING(args[0]);
-    char* alloc = ALLOCATE(char, string->length + 1);
+    ObjString* result = makeString(string->length);
 
-    for (int i = 0; i < string->chars[i]; i++) {
-        alloc[i] = tolower(string->chars[i]);
+    for (int i = 0; i < string->length; i++) {
+        result->chars[i] = tolower(string->chars[i]);
     }
 
-    alloc[string->length] = '\0';
-
-    return OBJ_VAL(takeString(alloc, string->length));
+    return OBJ_VAL(finishString(result));
 }
 
 static Value upperMethod(int argCount, Value *args) {
@@ -103,15 +101,13 @@ static Value upperMethod(int argCount, Value *args) {
     } 
 
     ObjString* string = AS_STRING(args[0]);
-    char* alloc = ALLOCATE(char, string->length + 1);
+    ObjString* result = makeString(string->length);
 
-    for (int i = 0; i < string->chars[i]; i++) {
-        alloc[i] = toupper(string->chars[i]);
+    for (int i = 0; i < string->length; i++) {
+        result->chars[i] = toupper(string->chars[i]);
     }
 
-    alloc[string->length] = '\0';
-
-    return OBJ_VAL(takeString(alloc, string->length));
+    return OBJ_VAL(finishString(result));
 }
 
 static Value capitalizeMethod(int argCount, Value *args) {
@@ -121,13 +117,12 @@ static Value capitalizeMethod(int argCount, Value *args) {
     } 
 
     ObjString* string = AS_STRING(args[0]);
-    char* alloc = ALLOCATE(char, string->length + 1);
+    ObjString* result = makeString(string->length);
 
-    memcpy(alloc, string->chars, string->length + 1);
+    memcpy(result->chars, string->chars, string->length);
+    if (string->length > 0) result->chars[0] = toupper(string->chars[0]);
 
-    alloc[0] = toupper(string->chars[0]);
-    alloc[string->length] = '\0';
-    return OBJ_VAL(takeString(alloc, string->length));
+    return OBJ_VAL(finishString(result));
 }
 
 static Value startsWithMethod(int argCount, Value *args) {
@@ -190,7 +185,7 @@ static Value isAlphaMethod(int argCount, Value *args) {
         return FALSE_VAL;
     }
 
-    for (int i = 0; i < string->chars[i]; i++) {
+    for (int i = 0; i < string->length; i++) {
         if (!isalpha(string->chars[i])) {
             return FALSE_VAL;
         }
@@ -211,7 +206,7 @@ static Value isDigitMethod(int argCount, Value *args) {
         return FALSE_VAL;
     }
 
-    for (int i = 0; i < string->chars[i]; i++) {
+    for (int i = 0; i < string->length; i++) {
         if (!isdigit(string->chars[i])) {
             return FALSE_VAL;
         }
@@ -232,7 +227,7 @@ static Value isSpaceMethod(int argCount, Value *args) {
         return FALSE_VAL;
     }
 
-    for (int i = 0; i < string->chars[i]; i++) {
+    for (int i = 0; i < string->length; i++) {
         if (!isspace(string->chars[i])) {
             return FALSE_VAL;
         }
@@ -249,27 +244,17 @@ static Value trimSpaceMethod(int argCount, Value *args) {
 
     ObjString* string = AS_STRING(args[0]);
 
-    char* alloc = ALLOCATE(char, string->length + 1);
-    memcpy(alloc, string->chars, string->length + 1);
-
-    int i = 0;
-    int j = 0;
-
-    for (; i < string->length; i++, j++) {
-        if (alloc[i] != ' ') {
-            alloc[j] = string->chars[i];
-        } else {
-            j--;
-        }
+    int length = 0;
+    for (int i = 0; i < string->length; i++) {
+        if (string->chars[i] != ' ') length++;
     }
 
-    if (j != 0) {
-        alloc = GROW_ARRAY(char, alloc, string->length + 1, j + 1); // shrink.
-        string->length = j;
+    ObjString* result = makeString(length);
+    for (int i = 0, j = 0; i < string->length; i++) {
+        if (string->chars[i] != ' ') result->chars[j++] = string->chars[i];
     }
 
-    alloc[j] = '\0';
-    return OBJ_VAL(takeString(alloc, string->length));
+    return OBJ_VAL(finishString(result));
 }
 
 static Value formatMethod (int argCount, Value *args) {
@@ -332,7 +317,8 @@ static Value formatMethod (int argCount, Value *args) {
     int fLength = string->length - count * 2 + varLength + 1;
     //
     char* tmpPos;
-    char* new = ALLOCATE(char, fLength);
+    ObjString* result = makeString(fLength - 1);
+    char* new = result->chars;
     int stringLength = 0;
 
     for (int i = 0; i < argCount; ++i) {
@@ -352,10 +338,9 @@ static Value formatMethod (int argCount, Value *args) {
 
     FREE_ARRAY(char*, variableStrings, argCount);
     memmove(new + stringLength, tmp, strlen(tmp));
-    new[fLength - 1] = '\0';
     FREE_ARRAY(char, ref, sLen);
 
-    return OBJ_VAL(takeString(new, fLength - 1));
+    return OBJ_VAL(finishString(result));
 }
 
 static Value replaceMethod (int argCount, Value *args) {
@@ -405,7 +390,8 @@ static Value replaceMethod (int argCount, Value *args) {
 
     int length = strlen(tmp) - count * (len - rlen) + 1;
     char* tmpPos;
-    char* new = ALLOCATE(char, length);
+    ObjString* result = makeString(length - 1);
+    char* new = result->chars;
     int stringLength = 0;
 
     for (int i = 0; i < count; ++i) {
@@ -422,12 +408,165 @@ static Value replaceMethod (int argCount, Value *args) {
 
     memmove(new + stringLength, tmp, strlen(tmp));
     FREE_ARRAY(char, ref, sLen + 1);
-    new[length - 1] = '\0';
 
-    return OBJ_VAL(takeString(new, length - 1));
+    return OBJ_VAL(finishString(result));
 }
 
 //
+static bool checkFunction(Value value, const char* method) {
+    if (!isCallable(value)) {
+        runtimeError("Argument must be a function from '%s()'.", method);
+        return false;
+    }
+
+    return true;
+}
+
+// The callbacks below get each character as a string of its own.
+static Value eachMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'each()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "each")) return NOTCLEAR;
+
+    ObjString* string = AS_STRING(args[0]);
+    Value action = args[1];
+
+    for (int i = 0; i < string->length; i++) {
+        Value character = OBJ_VAL(copyString(&string->chars[i], 1));
+        Value result;
+        if (!vmCall(action, 1, &character, &result)) return NOTCLEAR;
+    }
+
+    return CLEAR;
+}
+
+static Value mapMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'map()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "map")) return NOTCLEAR;
+
+    ObjString* string = AS_STRING(args[0]);
+    Value action = args[1];
+
+    ObjList* res = newListWithCapacity(string->length);
+    push(OBJ_VAL(res));
+
+    for (int i = 0; i < string->length; i++) {
+        Value character = OBJ_VAL(copyString(&string->chars[i], 1));
+        Value item;
+        if (!vmCall(action, 1, &character, &item)) return NOTCLEAR;
+
+        push(item);
+        appendToList(res, item);
+        pop();
+    }
+
+    pop();
+    return OBJ_VAL(res);
+}
+
+// The characters passing the test, as a string.
+static Value filterMethod(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from 'filter()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "filter")) return NOTCLEAR;
+
+    ObjString* string = AS_STRING(args[0]);
+    Value test = args[1];
+
+    ObjStringBuilder* builder = newStringBuilder();
+    push(OBJ_VAL(builder));
+
+    for (int i = 0; i < string->length; i++) {
+        Value character = OBJ_VAL(copyString(&string->chars[i], 1));
+        Value keep;
+        if (!vmCall(test, 1, &character, &keep)) return NOTCLEAR;
+
+        if (!isFalsey(keep)) {
+            builderAppend(builder, &string->chars[i], 1);
+        }
+    }
+
+    ObjString* res = copyRuntimeString(builder->chars, builder->length);
+    pop();
+    return OBJ_VAL(res);
+}
+
+static Value reduceMethod(int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError("Expected 1 or 2 arguments but got %d from 'reduce()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "reduce")) return NOTCLEAR;
+
+    ObjString* string = AS_STRING(args[0]);
+    Value action = args[1];
+
+    int start = 0;
+    Value callArgs[2];
+    if (argCount == 2) {
+        callArgs[0] = args[2];
+    } else if (string->length > 0) {
+        callArgs[0] = OBJ_VAL(copyString(string->chars, 1));
+        start = 1;
+    } else {
+        runtimeError("Can't reduce an empty string without an initial value from 'reduce()'.");
+        return NOTCLEAR;
+    }
+
+    // The accumulator stays on the stack between calls.
+    push(callArgs[0]);
+    for (int i = start; i < string->length; i++) {
+        callArgs[1] = OBJ_VAL(copyString(&string->chars[i], 1));
+        if (!vmCall(action, 2, callArgs, &callArgs[0])) return NOTCLEAR;
+        vm.stackTop[-1] = callArgs[0];
+    }
+    pop();
+
+    return callArgs[0];
+}
+
+// The first character passing the test, or the default if none does.
+static Value findMethod(int argCount, Value *args) {
+    if (argCount != 1 && argCount != 2) {
+        runtimeError("Expected 1 or 2 arguments but got %d from 'find()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (!checkFunction(args[1], "find")) return NOTCLEAR;
+
+    ObjString* string = AS_STRING(args[0]);
+    Value test = args[1];
+    Value fallback = argCount == 2 ? args[2] : NIL_VAL;
+
+    for (int i = 0; i < string->length; i++) {
+        Value character = OBJ_VAL(copyString(&string->chars[i], 1));
+        Value found;
+        if (!vmCall(test, 1, &character, &found)) return NOTCLEAR;
+
+        if (!isFalsey(found)) {
+            return OBJ_VAL(copyString(&string->chars[i], 1));
+        }
+    }
+
+    if (argCount == 2) {
+        return fallback;
+    }
+
+    runtimeError("No character passed the test from 'find()'.");
+    return NOTCLEAR;
+}
+
 void initStringMethods() {
     char* stringMethodStrings[] = {
         "toNumber",
@@ -448,7 +587,13 @@ void initStringMethods() {
 
         "trimSpace",
         "replace",
-        "format"
+        "format",
+
+        "each",
+        "map",
+        "filter",
+        "reduce",
+        "find",
     };
 
     NativeFn stringMethods[] = {
@@ -471,6 +616,12 @@ void initStringMethods() {
         trimSpaceMethod,
         replaceMethod,
         formatMethod,
+
+        eachMethod,
+        mapMethod,
+        filterMethod,
+        reduceMethod,
+        findMethod,
     };
 
     for (uint8_t i = 0; i < sizeof(stringMethodStrings) / sizeof(stringMethodStrings[0]); i++) {
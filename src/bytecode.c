@@ -0,0 +1,541 @@
+// st_mtim and mmap() are POSIX, a strict -std=c99 build hides them
+// otherwise. macOS names the field st_mtimespec only outside of this.
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "bytecode.h"
+#include "compiler.h"
+#include "memory.h"
+#include "tools.h"
+#include "vm.h"
+
+#define BYTECODE_MAGIC "PaBC"
+
+// Deepest function nesting a cache file may describe.
+#define MAX_NESTING UINT8_COUNT
+
+typedef enum {
+  CONST_NIL,
+  CONST_FALSE,
+  CONST_TRUE,
+  CONST_NUMBER,
+  CONST_STRING,
+  CONST_FUNCTION,
+} ConstantTag;
+
+// Written as is in host byte order, a file from a machine with another
+// layout fails the version check and is recompiled.
+typedef struct {
+  char magic[4];
+  uint32_t version;
+
+  // NaN boxed and tagged union builds can't share caches, and native
+  // globals are addressed by index.
+  uint32_t valueSize;
+  uint32_t globalCount;
+
+  // The source the cache was compiled from.
+  int64_t mtime;
+  int64_t mtimeNsec;
+  int64_t sourceSize;
+
+  uint32_t payloadSize;
+  uint32_t checksum;
+} BytecodeHeader;
+
+typedef struct {
+  uint8_t* bytes;
+  size_t count;
+  size_t capacity;
+} Writer;
+
+typedef struct {
+  const uint8_t* current;
+  const uint8_t* end;
+  bool failed;
+} Reader;
+
+static bool stampHeader(const char* path, BytecodeHeader* header) {
+  struct stat info;
+  if (stat(path, &info) != 0) return false;
+
+  memset(header, 0, sizeof(BytecodeHeader));
+  memcpy(header->magic, BYTECODE_MAGIC, 4);
+  header->version = BYTECODE_VERSION;
+  header->valueSize = sizeof(Value);
+  header->globalCount = vm.globalValues.count;
+
+  header->mtime = (int64_t)info.st_mtime;
+#if defined(__linux__)
+  header->mtimeNsec = (int64_t)info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+  header->mtimeNsec = (int64_t)info.st_mtimespec.tv_nsec;
+#endif
+  header->sourceSize = (int64_t)info.st_size;
+  return true;
+}
+
+static char* bytecodePath(const char* path) {
+  size_t length = strlen(path);
+  char* cachePath = (char*)malloc(length + 5);
+  if (cachePath == NULL) exit(1);
+
+  memcpy(cachePath, path, length + 1);
+  if (length > 3 && strcmp(path + length - 3, ".pc") == 0) {
+    strcat(cachePath, "b");
+  } else {
+    strcat(cachePath, ".pcb");
+  }
+
+  return cachePath;
+}
+
+// FNV-1a, catches truncated and partly written files.
+static uint32_t checksum(const uint8_t* bytes, size_t count) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < count; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619;
+  }
+
+  return hash;
+}
+
+//> writer
+// The writer's buffer lives outside the GC heap, serializing never
+// allocates objects.
+static void writeBytes(Writer* writer, const void* data, size_t size) {
+  if (writer->count + size > writer->capacity) {
+    while (writer->count + size > writer->capacity) {
+      writer->capacity = GROW_CAPACITY(writer->capacity);
+    }
+
+    writer->bytes = (uint8_t*)realloc(writer->bytes, writer->capacity);
+    if (writer->bytes == NULL) exit(1);
+  }
+
+  memcpy(writer->bytes + writer->count, data, size);
+  writer->count += size;
+}
+
+static void writeU8(Writer* writer, uint8_t value) {
+  writeBytes(writer, &value, sizeof(value));
+}
+
+static void writeU32(Writer* writer, uint32_t value) {
+  writeBytes(writer, &value, sizeof(value));
+}
+
+static void writeString(Writer* writer, ObjString* string) {
+  writeU32(writer, (uint32_t)string->length);
+  writeBytes(writer, string->chars, string->length);
+}
+
+// Module slots are written in index order, replaying them into a fresh
+// library hands out the same indexes the bytecode was compiled against.
+// Names newLibrary() predefines, like '__name__', come back unchanged.
+static bool writeSlots(Writer* writer, ObjLibrary* library) {
+  int count = library->slots.count;
+  Entry** slots = (Entry**)calloc(count > 0 ? count : 1, sizeof(Entry*));
+  bool* isPrivate = (bool*)calloc(count > 0 ? count : 1, sizeof(bool));
+  if (slots == NULL || isPrivate == NULL) exit(1);
+
+  Table* tables[] = {&library->values, &library->privateValues};
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < tables[i]->capacity; j++) {
+      Entry* entry = &tables[i]->entries[j];
+      if (entry->key == NULL) continue;
+
+      int slot = (int)AS_NUMBER(entry->value);
+      slots[slot] = entry;
+      isPrivate[slot] = i == 1;
+    }
+  }
+
+  bool complete = true;
+  writeU32(writer, (uint32_t)count);
+  for (int i = 0; i < count; i++) {
+    if (slots[i] == NULL) {
+      complete = false;
+      break;
+    }
+
+    writeU8(writer, isPrivate[i]);
+    writeString(writer, slots[i]->key);
+  }
+
+  free(slots);
+  free(isPrivate);
+  return complete;
+}
+
+static bool writeFunction(Writer* writer, ObjFunction* function) {
+  writeU32(writer, (uint32_t)function->arity);
+  writeU32(writer, (uint32_t)function->upvalueCount);
+  writeU32(writer, (uint32_t)function->maxStack);
+  writeU8(writer, (uint8_t)function->type);
+  writeU8(writer, (uint8_t)function->accessLevel);
+
+  writeU8(writer, function->name != NULL);
+  if (function->name != NULL) writeString(writer, function->name);
+
+  Chunk* chunk = &function->chunk;
+  writeU32(writer, (uint32_t)chunk->count);
+  writeBytes(writer, chunk->code, chunk->count);
+  writeU32(writer, (uint32_t)chunk->lines.count);
+  writeBytes(writer, chunk->lines.bytes, chunk->lines.count);
+  writeU32(writer, (uint32_t)chunk->cacheCount);
+
+  writeU32(writer, (uint32_t)chunk->constants.count);
+  for (int i = 0; i < chunk->constants.count; i++) {
+    Value value = chunk->constants.values[i];
+
+    if (IS_NIL(value)) {
+      writeU8(writer, CONST_NIL);
+    } else if (IS_BOOL(value)) {
+      writeU8(writer, AS_BOOL(value) ? CONST_TRUE : CONST_FALSE);
+    } else if (IS_NUMBER(value)) {
+      double number = AS_NUMBER(value);
+      writeU8(writer, CONST_NUMBER);
+      writeBytes(writer, &number, sizeof(number));
+    } else if (IS_STRING(value)) {
+      writeU8(writer, CONST_STRING);
+      writeString(writer, AS_STRING(value));
+    } else if (IS_FUNCTION(value)) {
+      writeU8(writer, CONST_FUNCTION);
+      if (!writeFunction(writer, AS_FUNCTION(value))) return false;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void saveBytecode(const char* cachePath, BytecodeHeader* header,
+                         ObjFunction* function, ObjLibrary* library) {
+  Writer writer = {NULL, 0, 0};
+
+  if (writeSlots(&writer, library) && writeFunction(&writer, function)) {
+    header->payloadSize = (uint32_t)writer.count;
+    header->checksum = checksum(writer.bytes, writer.count);
+
+    // Written aside and renamed over, a reader never sees half a file.
+    size_t length = strlen(cachePath);
+    char* tempPath = (char*)malloc(length + 5);
+    if (tempPath == NULL) exit(1);
+    memcpy(tempPath, cachePath, length);
+    memcpy(tempPath + length, ".tmp", 5);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (file != NULL) {
+      bool written = fwrite(header, sizeof(BytecodeHeader), 1, file) == 1 &&
+                     fwrite(writer.bytes, 1, writer.count, file) == writer.count;
+      written = fclose(file) == 0 && written;
+
+#ifdef _WIN32
+      if (written) remove(cachePath);
+#endif
+      if (!written || rename(tempPath, cachePath) != 0) {
+        remove(tempPath);
+      }
+    }
+
+    free(tempPath);
+  }
+
+  free(writer.bytes);
+}
+//< writer
+
+//> reader
+static void readBytes(Reader* reader, void* out, size_t size) {
+  if (reader->failed || (size_t)(reader->end - reader->current) < size) {
+    reader->failed = true;
+    memset(out, 0, size);
+    return;
+  }
+
+  memcpy(out, reader->current, size);
+  reader->current += size;
+}
+
+static uint8_t readU8(Reader* reader) {
+  uint8_t value;
+  readBytes(reader, &value, sizeof(value));
+  return value;
+}
+
+static uint32_t readU32(Reader* reader) {
+  uint32_t value;
+  readBytes(reader, &value, sizeof(value));
+  return value;
+}
+
+static ObjString* readString(Reader* reader) {
+  uint32_t length = readU32(reader);
+  if (reader->failed || (size_t)(reader->end - reader->current) < length) {
+    reader->failed = true;
+    return NULL;
+  }
+
+  ObjString* string = copyString((const char*)reader->current, (int)length);
+  reader->current += length;
+  return string;
+}
+
+static bool readSlots(Reader* reader, ObjLibrary* library) {
+  uint32_t count = readU32(reader);
+
+  for (uint32_t i = 0; i < count && !reader->failed; i++) {
+    bool isPrivate = readU8(reader) != 0;
+    ObjString* name = readString(reader);
+    if (name == NULL) return false;
+
+    push(OBJ_VAL(name));
+    int slot = librarySlot(library, name, isPrivate);
+    pop();
+
+    if (slot != (int)i) return false;
+  }
+
+  return !reader->failed && library->slots.count == (int)count;
+}
+
+// Returns NULL and sets 'failed' on anything malformed. Every object is
+// rooted on the VM stack while the ones it owns are being allocated.
+static ObjFunction* readFunction(Reader* reader, ObjLibrary* library, int depth) {
+  if (depth > MAX_NESTING) {
+    reader->failed = true;
+    return NULL;
+  }
+
+  ObjFunction* function = newFunction(library, TYPE_SCRIPT);
+  push(OBJ_VAL(function));
+
+  function->arity = (int)readU32(reader);
+  function->upvalueCount = (int)readU32(reader);
+  uint32_t maxStack = readU32(reader);
+  uint8_t type = readU8(reader);
+  uint8_t accessLevel = readU8(reader);
+  if (type > TYPE_UNKNOWN || accessLevel > PUBLIC_METHOD ||
+      function->upvalueCount > UINT8_COUNT) {
+    reader->failed = true;
+  }
+  function->maxStack = (int)maxStack;
+  function->type = (FunctionType)type;
+  function->accessLevel = (AccessLevel)accessLevel;
+
+  if (readU8(reader)) {
+    function->name = readString(reader);
+    if (function->name != NULL) {
+      writeBarrier((Obj*)function, OBJ_VAL(function->name));
+    }
+  }
+
+  uint32_t count = readU32(reader);
+  size_t remaining = (size_t)(reader->end - reader->current);
+  if (count == 0 || count > remaining) reader->failed = true;
+
+  // No instruction adds more than one value, so a call holds at most
+  // its arguments and one value per byte of code.
+  uint32_t frameStart = (uint32_t)function->arity + 1;
+  if (maxStack < frameStart || maxStack > frameStart + count) {
+    reader->failed = true;
+  }
+
+  Chunk* chunk = &function->chunk;
+  if (!reader->failed) {
+    uint8_t* code = ALLOCATE(uint8_t, count);
+    chunk->code = code;
+    chunk->capacity = (int)count;
+    chunk->count = (int)count;
+
+    readBytes(reader, chunk->code, count);
+    if (chunk->code[count - 1] != OP_RETURN) reader->failed = true;
+  }
+
+  uint32_t lineCount = readU32(reader);
+  remaining = (size_t)(reader->end - reader->current);
+  if (lineCount == 0 || lineCount > remaining) reader->failed = true;
+
+  if (!reader->failed) {
+    uint8_t* lines = ALLOCATE(uint8_t, lineCount);
+    chunk->lines.bytes = lines;
+    chunk->lines.capacity = (int)lineCount;
+    chunk->lines.count = (int)lineCount;
+
+    readBytes(reader, chunk->lines.bytes, lineCount);
+  }
+
+  uint32_t cacheCount = readU32(reader);
+  if (cacheCount > UINT16_MAX + 1) reader->failed = true;
+  if (!reader->failed) {
+    chunk->cacheCount = (int)cacheCount;
+    allocateInlineCaches(chunk);
+  }
+
+  uint32_t constantCount = readU32(reader);
+  for (uint32_t i = 0; i < constantCount && !reader->failed; i++) {
+    Value value = NIL_VAL;
+
+    switch (readU8(reader)) {
+      case CONST_NIL: value = NIL_VAL; break;
+      case CONST_FALSE: value = BOOL_VAL(false); break;
+      case CONST_TRUE: value = BOOL_VAL(true); break;
+      case CONST_NUMBER: {
+        double number;
+        readBytes(reader, &number, sizeof(number));
+        value = NUMBER_VAL(number);
+        break;
+      }
+      case CONST_STRING: {
+        ObjString* string = readString(reader);
+        if (string != NULL) value = OBJ_VAL(string);
+        break;
+      }
+      case CONST_FUNCTION: {
+        ObjFunction* nested = readFunction(reader, library, depth + 1);
+        if (nested != NULL) value = OBJ_VAL(nested);
+        break;
+      }
+      default:
+        reader->failed = true;
+        break;
+    }
+
+    if (!reader->failed) {
+      addConstant(chunk, value);
+      writeBarrier((Obj*)function, value);
+    }
+  }
+
+  pop();
+  return reader->failed ? NULL : function;
+}
+
+#ifndef _WIN32
+static const uint8_t* mapFile(const char* path, size_t* size) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) return NULL;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+
+  void* bytes = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (bytes == MAP_FAILED) return NULL;
+
+  *size = (size_t)info.st_size;
+  return (const uint8_t*)bytes;
+}
+
+static void unmapFile(const uint8_t* bytes, size_t size) {
+  munmap((void*)bytes, size);
+}
+#else
+static const uint8_t* mapFile(const char* path, size_t* size) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+
+  fseek(file, 0L, SEEK_END);
+  long fileSize = ftell(file);
+  rewind(file);
+
+  uint8_t* bytes = fileSize > 0 ? (uint8_t*)malloc(fileSize) : NULL;
+  if (bytes == NULL || fread(bytes, 1, fileSize, file) < (size_t)fileSize) {
+    free(bytes);
+    fclose(file);
+    return NULL;
+  }
+
+  fclose(file);
+  *size = (size_t)fileSize;
+  return bytes;
+}
+
+static void unmapFile(const uint8_t* bytes, size_t size) {
+  free((void*)bytes);
+}
+#endif
+
+static bool verifyHeader(const uint8_t* bytes, size_t size,
+                         BytecodeHeader* expected) {
+  if (size < sizeof(BytecodeHeader)) return false;
+
+  BytecodeHeader header;
+  memcpy(&header, bytes, sizeof(BytecodeHeader));
+
+  return memcmp(header.magic, expected->magic, 4) == 0 &&
+         header.version == expected->version &&
+         header.valueSize == expected->valueSize &&
+         header.globalCount == expected->globalCount &&
+         header.mtime == expected->mtime &&
+         header.mtimeNsec == expected->mtimeNsec &&
+         header.sourceSize == expected->sourceSize &&
+         header.payloadSize == size - sizeof(BytecodeHeader) &&
+         header.checksum == checksum(bytes + sizeof(BytecodeHeader),
+                                     header.payloadSize);
+}
+
+static ObjFunction* loadBytecode(const char* cachePath, BytecodeHeader* expected,
+                                 ObjLibrary* library) {
+  size_t size;
+  const uint8_t* bytes = mapFile(cachePath, &size);
+  if (bytes == NULL) return NULL;
+
+  ObjFunction* function = NULL;
+  if (verifyHeader(bytes, size, expected)) {
+    Reader reader = {bytes + sizeof(BytecodeHeader), bytes + size, false};
+
+    if (readSlots(&reader, library)) {
+      function = readFunction(&reader, library, 0);
+      if (reader.failed || reader.current != reader.end) function = NULL;
+    }
+  }
+
+  unmapFile(bytes, size);
+  return function;
+}
+//< reader
+
+ObjFunction* compileFile(char* path, ObjLibrary* library) {
+  BytecodeHeader header;
+  bool cacheable = stampHeader(path, &header);
+  char* cachePath = cacheable ? bytecodePath(path) : NULL;
+
+  if (cacheable) {
+    ObjFunction* function = loadBytecode(cachePath, &header, library);
+    if (function != NULL) {
+      free(cachePath);
+      return function;
+    }
+  }
+
+  char* source = readFile(path);
+  ObjFunction* function = compile(source, library);
+  free(source);
+
+  if (function != NULL && cacheable) {
+    push(OBJ_VAL(function));
+    saveBytecode(cachePath, &header, function, library);
+    pop();
+  }
+
+  free(cachePath);
+  return function;
+}
@@ -0,0 +1,16 @@
+#ifndef Pa_bytecode_h
+#define Pa_bytecode_h
+
+#include "object.h"
+
+// Bump whenever the opcodes, their operands or the file layout change,
+// older cache files are then ignored and rewritten.
+#define BYTECODE_VERSION 4
+
+// Compiles the script at 'path' into 'library'. A bytecode cache is kept
+// next to the source ("script.pc" -> "script.pcb") and reused for as long
+// as the source's mtime and size and the VM's bytecode version match.
+// Returns NULL on a compile error. 'library' must be reachable.
+ObjFunction* compileFile(char* path, ObjLibrary* library);
+
+#endif
@@ -1,6 +1,8 @@
 #include "memory.h"
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include "chunk.h"
 #include "vm.h"
 
@@ -8,30 +10,34 @@ void initChunk(Chunk* chunk) {
   chunk->count = 0;
   chunk->capacity = 0;
   chunk->code = NULL;
-  chunk->lines = NULL;
+  initLineTable(&chunk->lines);
   initValueArray(&chunk->constants);
 
+  chunk->caches = NULL;
+  chunk->cacheCount = 0;
+
 }
 
 void freeChunk(Chunk* chunk) {
   FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
-  FREE_ARRAY(int, chunk->lines, chunk->capacity);
+  freeLineTable(&chunk->lines);
   freeValueArray(&chunk->constants);
+  if (chunk->caches != NULL) {
+    FREE_ARRAY(InlineCache, chunk->caches, chunk->cacheCount);
+  }
   initChunk(chunk);
 }
 
-void writeChunk(Chunk* chunk, uint8_t byte, int line) {
+void writeChunk(Chunk* chunk, uint8_t byte, int line, int column) {
   if (chunk->capacity < chunk->count + 1) {
     int oldCapacity = chunk->capacity;
     chunk->capacity = GROW_CAPACITY(oldCapacity);
     chunk->code = GROW_ARRAY(uint8_t, chunk->code,
         oldCapacity, chunk->capacity);
-    chunk->lines = GROW_ARRAY(int, chunk->lines,
-        oldCapacity, chunk->capacity);
   }
 
+  addLine(&chunk->lines, chunk->count, line, column);
   chunk->code[chunk->count] = byte;
-  chunk->lines[chunk->count] = line;
   chunk->count++;
 }
 
@@ -42,3 +48,111 @@ int addConstant(Chunk* chunk, Value value) {
   return chunk->constants.count - 1;
 }
 //< add-constant
+
+// Inline caches are only counted while compiling, the array is
+// allocated once the chunk is finished.
+int addInlineCache(Chunk* chunk) {
+  return chunk->cacheCount++;
+}
+
+void allocateInlineCaches(Chunk* chunk) {
+  if (chunk->cacheCount == 0) return;
+
+  chunk->caches = ALLOCATE(InlineCache, chunk->cacheCount);
+  memset(chunk->caches, 0, sizeof(InlineCache) * chunk->cacheCount);
+}
+
+//> line-table
+void initLineTable(LineTable* table) {
+  table->count = 0;
+  table->capacity = 0;
+  table->bytes = NULL;
+  table->lastOffset = 0;
+  table->last.line = 0;
+  table->last.column = 0;
+}
+
+void freeLineTable(LineTable* table) {
+  FREE_ARRAY(uint8_t, table->bytes, table->capacity);
+  initLineTable(table);
+}
+
+static void writeVarint(LineTable* table, uint32_t value) {
+  // A 32 bit varint takes at most five bytes.
+  if (table->capacity < table->count + 5) {
+    int oldCapacity = table->capacity;
+    table->capacity = GROW_CAPACITY(oldCapacity);
+    table->bytes = GROW_ARRAY(uint8_t, table->bytes,
+        oldCapacity, table->capacity);
+  }
+
+  while (value >= 0x80) {
+    table->bytes[table->count++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  table->bytes[table->count++] = (uint8_t)value;
+}
+
+// Stops at 'end' so a damaged table can't be read past.
+static uint32_t readVarint(const uint8_t** bytes, const uint8_t* end) {
+  uint32_t value = 0;
+  int shift = 0;
+
+  while (*bytes < end && shift < 32) {
+    uint8_t byte = *(*bytes)++;
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) break;
+    shift += 7;
+  }
+
+  return value;
+}
+
+void addLine(LineTable* table, int offset, int line, int column) {
+  if (table->count > 0 &&
+      table->last.line == line && table->last.column == column) {
+    return;
+  }
+
+  int32_t delta = line - table->last.line;
+  writeVarint(table, (uint32_t)(offset - table->lastOffset));
+  writeVarint(table, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+  writeVarint(table, (uint32_t)column);
+
+  table->lastOffset = offset;
+  table->last.line = line;
+  table->last.column = column;
+}
+
+void initLineCursor(LineCursor* cursor, LineTable* table) {
+  cursor->next = table->bytes;
+  cursor->end = table->bytes + table->count;
+  cursor->location.line = 0;
+  cursor->location.column = 0;
+
+  cursor->nextOffset = cursor->next < cursor->end
+      ? (int)readVarint(&cursor->next, cursor->end)
+      : INT_MAX;
+}
+
+SourceLocation seekLine(LineCursor* cursor, int offset) {
+  while (offset >= cursor->nextOffset) {
+    uint32_t delta = readVarint(&cursor->next, cursor->end);
+    cursor->location.line += (int32_t)(delta >> 1) ^ -(int32_t)(delta & 1);
+    cursor->location.column = (int)readVarint(&cursor->next, cursor->end);
+
+    cursor->nextOffset = cursor->next < cursor->end
+        ? cursor->nextOffset + (int)readVarint(&cursor->next, cursor->end)
+        : INT_MAX;
+  }
+
+  return cursor->location;
+}
+
+// Decodes from the start, only meant for error reporting and debugging.
+SourceLocation getSourceLocation(Chunk* chunk, int offset) {
+  LineCursor cursor;
+  initLineCursor(&cursor, &chunk->lines);
+  return seekLine(&cursor, offset);
+}
+//< line-table
@@ -77,6 +77,9 @@ typedef enum {
   OP_PRIVATE_METHOD,
 
   OP_BUILD_LIST, 
+  OP_EXTEND_LIST,
+  OP_BUILD_MAP,
+  OP_EXTEND_MAP,
   OP_INDEX_SUBSCR,
   OP_STORE_SUBSCR,
 
@@ -105,8 +108,97 @@ typedef enum {
   OP_PRIVATE_GET,
   OP_PRIVATE_SET,
 
+  // Superinstructions, only emitted by the peephole pass.
+  OP_ADD_LOCALS,
+  OP_SUBTRACT_LOCALS,
+  OP_ADD_LOCAL_CONSTANT,
+  OP_SUBTRACT_LOCAL_CONSTANT,
+
+  OP_EQUAL_JUMP,
+  OP_GREATER_JUMP,
+  OP_LESS_JUMP,
+  OP_LESS_LOCAL_CONSTANT_JUMP,
+
+  OP_INCREMENT_LOCAL,
+  OP_DECREMENT_LOCAL,
+
+  // Long forms, a 24-bit constant or slot index in place of the byte.
+  OP_CONSTANT_LONG,
+  OP_GET_GLOBAL_LONG,
+  OP_DEFINE_LIBRARY_LONG,
+  OP_GET_LIBRARY_LONG,
+  OP_SET_LIBRARY_LONG,
+  OP_PRIVATE_DEFINE_LONG,
+  OP_PRIVATE_GET_LONG,
+  OP_PRIVATE_SET_LONG,
+  OP_GET_PROPERTY_LONG,
+  OP_SET_PROPERTY_LONG,
+  OP_GET_PROPERTY_NO_POP_LONG,
+  OP_PRIVATE_PROPERTY_GET_LONG,
+  OP_PRIVATE_PROPERTY_SET_LONG,
+  OP_PRIVATE_GET_PROPERTY_NO_POP_LONG,
+  OP_INVOKE_LONG,
+  OP_INVOKE1_LONG,
+  OP_CLOSURE_LONG,
+  OP_CLASS_LONG,
+  OP_METHOD_LONG,
+  OP_PRIVATE_METHOD_LONG,
+  OP_USE_LONG,
+  OP_USE_BUILTIN_LONG,
+  OP_ASSERT_LONG,
+
 } OpCode;
 
+// Largest constant or slot index, the long forms encode it in 24 bits.
+#define LONG_OPERAND_MAX 0xffffff
+
+#define INLINE_CACHE_WAYS 4
+
+struct Shape;
+
+typedef struct {
+  uint32_t shapeId;
+  int slot;
+
+  // Set when storing adds the field, the shape the instance moves to.
+  struct Shape* transition;
+} CacheEntry;
+
+// Per call site cache for the property instructions, keyed on the
+// receiver's shape.
+typedef struct {
+  CacheEntry entries[INLINE_CACHE_WAYS];
+  int next;
+} InlineCache;
+
+typedef struct {
+  int line;
+  int column;
+} SourceLocation;
+
+// Source positions for the code, one record per run of bytes that share
+// a line and column. Each record is three varints: the bytes since the
+// previous record started, the zigzag encoded line delta and the column.
+typedef struct {
+  int count;
+  int capacity;
+  uint8_t* bytes;
+
+  // Start and position of the last record, a new one is only appended
+  // when the position changes.
+  int lastOffset;
+  SourceLocation last;
+} LineTable;
+
+// Walks a LineTable forwards, offsets passed to seekLine() must not
+// decrease.
+typedef struct {
+  const uint8_t* next;
+  const uint8_t* end;
+  int nextOffset;
+  SourceLocation location;
+} LineCursor;
+
 typedef struct {
 
   int count;
@@ -114,16 +206,28 @@ typedef struct {
 
   uint8_t* code;
 
-  int* lines;
+  LineTable lines;
 
   ValueArray constants;
 
+  InlineCache* caches;
+  int cacheCount;
+
 } Chunk;
 
 void initChunk(Chunk* chunk);
 void freeChunk(Chunk* chunk);
-void writeChunk(Chunk* chunk, uint8_t byte, int line);
+void writeChunk(Chunk* chunk, uint8_t byte, int line, int column);
 int addConstant(Chunk* chunk, Value value);
+int addInlineCache(Chunk* chunk);
+void allocateInlineCaches(Chunk* chunk);
+
+void initLineTable(LineTable* table);
+void freeLineTable(LineTable* table);
+void addLine(LineTable* table, int offset, int line, int column);
+void initLineCursor(LineCursor* cursor, LineTable* table);
+SourceLocation seekLine(LineCursor* cursor, int offset);
+SourceLocation getSourceLocation(Chunk* chunk, int offset);
 
 
 #endif
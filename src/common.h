@@ -17,6 +17,12 @@
 
 #define UINT8_COUNT (UINT8_MAX + 1)
 
+// Threaded dispatch through a label table ("labels as values").
+// Define NO_COMPUTED_GOTO to fall back to the plain switch.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(NO_COMPUTED_GOTO)
+#define COMPUTED_GOTO
+#endif
+
 #endif
 
 #undef DEBUG_PRINT_CODE
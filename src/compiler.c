@@ -87,7 +87,7 @@ static bool match(TokenType type) {
 }
 
 static void emitByte(uint8_t byte) {
-  writeChunk(currentChunk(), byte, parser.previous.line);
+  writeChunk(currentChunk(), byte, parser.previous.line, parser.previous.column);
 }
 
 static void emitBytes(uint8_t byte1, uint8_t byte2) {
@@ -95,6 +95,61 @@ static void emitBytes(uint8_t byte1, uint8_t byte2) {
   emitByte(byte2);
 }
 
+static uint8_t longOpcode(uint8_t instruction) {
+  switch (instruction) {
+    case OP_CONSTANT:                    return OP_CONSTANT_LONG;
+    case OP_GET_GLOBAL:                  return OP_GET_GLOBAL_LONG;
+    case OP_DEFINE_LIBRARY:              return OP_DEFINE_LIBRARY_LONG;
+    case OP_GET_LIBRARY:                 return OP_GET_LIBRARY_LONG;
+    case OP_SET_LIBRARY:                 return OP_SET_LIBRARY_LONG;
+    case OP_PRIVATE_DEFINE:              return OP_PRIVATE_DEFINE_LONG;
+    case OP_PRIVATE_GET:                 return OP_PRIVATE_GET_LONG;
+    case OP_PRIVATE_SET:                 return OP_PRIVATE_SET_LONG;
+    case OP_GET_PROPERTY:                return OP_GET_PROPERTY_LONG;
+    case OP_SET_PROPERTY:                return OP_SET_PROPERTY_LONG;
+    case OP_GET_PROPERTY_NO_POP:         return OP_GET_PROPERTY_NO_POP_LONG;
+    case OP_PRIVATE_PROPERTY_GET:        return OP_PRIVATE_PROPERTY_GET_LONG;
+    case OP_PRIVATE_PROPERTY_SET:        return OP_PRIVATE_PROPERTY_SET_LONG;
+    case OP_PRIVATE_GET_PROPERTY_NO_POP: return OP_PRIVATE_GET_PROPERTY_NO_POP_LONG;
+    case OP_INVOKE:                      return OP_INVOKE_LONG;
+    case OP_INVOKE1:                     return OP_INVOKE1_LONG;
+    case OP_CLOSURE:                     return OP_CLOSURE_LONG;
+    case OP_CLASS:                       return OP_CLASS_LONG;
+    case OP_METHOD:                      return OP_METHOD_LONG;
+    case OP_PRIVATE_METHOD:              return OP_PRIVATE_METHOD_LONG;
+    case OP_USE:                         return OP_USE_LONG;
+    case OP_USE_BUILTIN:                 return OP_USE_BUILTIN_LONG;
+    case OP_ASSERT:                      return OP_ASSERT_LONG;
+    default:
+      error("Operand too large for this instruction.");
+      return instruction;
+  }
+}
+
+// Emits an instruction with a constant or slot index operand. Indexes
+// that fit a byte keep the short form, larger ones switch to the long
+// form and take three bytes.
+static void emitIndexed(uint8_t instruction, int index) {
+  if (index <= UINT8_MAX) {
+    emitBytes(instruction, (uint8_t)index);
+    return;
+  }
+
+  emitByte(longOpcode(instruction));
+  emitByte((index >> 16) & 0xff);
+  emitBytes((index >> 8) & 0xff, index & 0xff);
+}
+
+static void emitProperty(uint8_t instruction, int name) {
+  int cache = addInlineCache(currentChunk());
+  if (cache > UINT16_MAX) {
+    error("Too many property accesses in one chunk.");
+  }
+
+  emitIndexed(instruction, name);
+  emitBytes((cache >> 8) & 0xff, cache & 0xff);
+}
+
 static void emitSlotZero() {
   emitBytes(OP_GET_LOCAL, (uint8_t)0);
 }
@@ -127,18 +182,19 @@ static void emitReturn() {
 }
 
 
-static uint8_t makeConstant(Value value) {
+static int makeConstant(Value value) {
   int constant = addConstant(currentChunk(), value);
-  if (constant > UINT8_MAX) {
+  writeBarrier((Obj*)current->function, value);
+  if (constant > LONG_OPERAND_MAX) {
     error("Too many constants in one chunk.");
     return 0;
   }
 
-  return (uint8_t)constant;
+  return constant;
 }
 
 static void emitConstant(Value value) {
-  emitBytes(OP_CONSTANT, makeConstant(value));
+  emitIndexed(OP_CONSTANT, makeConstant(value));
 }
 
 
@@ -163,7 +219,7 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
   compiler->function = NULL;
 
   compiler->localCount = 0;
-  compiler->lastCall = false;
+  compiler->lastCall = -1;
   compiler->scopeDepth = 0;
 
   initTable(&compiler->cacheConstants);
@@ -177,10 +233,12 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
     case TYPE_METHOD:
     case TYPE_INITIALIZER:
       current->function->name = copyString(parser.previous.start,parser.previous.length);
+      writeBarrier((Obj*)current->function, OBJ_VAL(current->function->name));
       break;
 
     case TYPE_UNKNOWN:
       current->function->name = copyString("unknown", 7);
+      writeBarrier((Obj*)current->function, OBJ_VAL(current->function->name));
       break;
 
     case TYPE_SCRIPT:
@@ -203,10 +261,19 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 
 }
 
+static void optimizeChunk(Chunk* chunk);
+static int maxStackDepth(Chunk* chunk, int arity);
+
 static ObjFunction* endCompiler() {
   emitReturn();
   ObjFunction* function = current->function;
 
+  if (!parser.hadError) {
+    optimizeChunk(currentChunk());
+    function->maxStack = maxStackDepth(currentChunk(), function->arity);
+  }
+  allocateInlineCaches(currentChunk());
+
 #ifdef DEBUG_PRINT_CODE
   if (!parser.hadError) {
     disassembleChunk(currentChunk(), function->name != NULL ? function->name->chars : function->library->name->chars);
@@ -245,7 +312,7 @@ static int getArgCount(uint8_t *code, const ValueArray constants, int ip);
 
 static void expression();
 static void block();
-static void body();
+static void body(Compiler* compiler);
 static void statement();
 static void declaration();
 static ParseRule* getRule(TokenType type);
@@ -256,28 +323,28 @@ static void setPrivateProperty(Token name) {
 }
 
 
-static uint8_t identifierConstant(Token* name) {
+static int identifierConstant(Token* name) {
   ObjString* nameStr = copyString(name->start, name->length);
   Value indexVal;
 
   if (tableGet(&current->cacheConstants, nameStr, &indexVal)) {
-    return (uint8_t)AS_NUMBER(indexVal);
+    return (int)AS_NUMBER(indexVal);
   }
 
-  uint8_t index = makeConstant(OBJ_VAL(nameStr));
+  int index = makeConstant(OBJ_VAL(nameStr));
   tableSet(&current->cacheConstants, nameStr, NUMBER_VAL((double)index));
   return index;
 }
 
 static void parsePrivate() {
   Token nameTok = parser.previous;
-  uint8_t name = identifierConstant(&parser.previous);
+  int name = identifierConstant(&parser.previous);
   setPrivateProperty(nameTok);
 
   consume(TOKEN_EQUAL, "Expected an '=' after identifier");
   expression();
   consume(TOKEN_SEMICOLON, "Expected a ';' after the property value.");
-  emitBytes(OP_PRIVATE_PROPERTY_SET,  name);
+  emitProperty(OP_PRIVATE_PROPERTY_SET, name);
 }
 
 static bool identifiersEqual(Token* a, Token* b) {
@@ -381,7 +448,7 @@ static void declareVariable() {
   addLocal(*name);
 }
 
-static uint8_t parseVariable(const char* errorMessage) {
+static int parseVariable(const char* errorMessage) {
   consume(TOKEN_IDENTIFIER, errorMessage);
   declareVariable();
   if (current->scopeDepth > 0) return 0;
@@ -395,21 +462,37 @@ static void markInitialized() {
   current->locals[current->localCount - 1].depth = current->scopeDepth;
 }
 
+static int librarySlotOperand(ObjString* name, bool isPrivate) {
+  push(OBJ_VAL(name));
+  int slot = librarySlot(parser.library, name, isPrivate);
+  pop();
+
+  if (slot > LONG_OPERAND_MAX) {
+    error("Too many module variables.");
+    return 0;
+  }
+
+  return slot;
+}
+
 static void setPrivateVariable(Token name) {
-  tableSet(&parser.library->privateValues, copyString(name.start, name.length), NIL_VAL);
+  librarySlotOperand(copyString(name.start, name.length), true);
 }
 
 
-static void defineVariable(uint8_t global, bool isPrivate) {
+static void defineVariable(int global, bool isPrivate) {
   if (current->scopeDepth > 0) {
     markInitialized();
     return;
   }
 
+  ObjString* name = AS_STRING(currentChunk()->constants.values[global]);
+  int slot = librarySlotOperand(name, isPrivate);
+
   if (!isPrivate) {
-    emitBytes(OP_DEFINE_LIBRARY, global);
+    emitIndexed(OP_DEFINE_LIBRARY, slot);
   } else {
-    emitBytes(OP_PRIVATE_DEFINE, global);
+    emitIndexed(OP_PRIVATE_DEFINE, slot);
   }
 }
 
@@ -437,8 +520,6 @@ static void and_(bool canAssign, Token previous) {
   parsePrecedence(PREC_AND);
 
   patchJump(endJump);
-
-  current->lastCall = false;
 }
 
 static void binary(bool canAssign, Token previous) {
@@ -469,15 +550,13 @@ static void binary(bool canAssign, Token previous) {
     case TOKEN_BIT_XOR:       emitByte(OP_BIT_XOR); break;
     default: return; // Unreachable.
   }
-
-  current->lastCall = false;
 }
 
 static void call(bool canAssign, Token previous) {
   uint8_t argCount = argumentList();
 
   emitBytes(OP_CALL, argCount);
-  current->lastCall = true;
+  current->lastCall = currentChunk()->count - 2;
 }
 
 static bool privateDoesExist(Token nameTok) {
@@ -487,18 +566,18 @@ static bool privateDoesExist(Token nameTok) {
 
 static void dot(bool canAssign, Token previous) {
   consume(TOKEN_IDENTIFIER, "Expected a property name after '.'");
-  uint8_t name = identifierConstant(&parser.previous);
+  int name = identifierConstant(&parser.previous);
   Token nameTok = parser.previous;
 
   if (match(TOKEN_LEFT_PAREN)) {
     uint8_t argCount = argumentList();
     if (currentClass != NULL && ( (previous.type == TOKEN_THIS) && privateDoesExist(nameTok) )) {
-      emitBytes(OP_INVOKE1, argCount);
+      emitIndexed(OP_INVOKE1, name);
     } else {
-      emitBytes(OP_INVOKE, argCount);
+      emitIndexed(OP_INVOKE, name);
     }
 
-    emitByte(name);
+    emitByte(argCount);
     return;
   }
 
@@ -507,40 +586,39 @@ static void dot(bool canAssign, Token previous) {
   if (currentClass != NULL && (previous.type == TOKEN_THIS && privateDoesExist(nameTok)) ) {
     if (canAssign && match(TOKEN_EQUAL)) {
       expression();
-      emitBytes(OP_PRIVATE_PROPERTY_SET, name);
+      emitProperty(OP_PRIVATE_PROPERTY_SET, name);
     } else if (canAssign && match(TOKEN_PLUS_PLUS)) {
-      emitBytes(OP_PRIVATE_GET_PROPERTY_NO_POP, name);
+      emitProperty(OP_PRIVATE_GET_PROPERTY_NO_POP, name);
       emitByte(OP_INCREMENT);
-      emitBytes(OP_PRIVATE_PROPERTY_SET, name);
+      emitProperty(OP_PRIVATE_PROPERTY_SET, name);
 
     } else if (canAssign && match(TOKEN_MINUS_MINUS)) {
-      emitBytes(OP_PRIVATE_GET_PROPERTY_NO_POP, name);
+      emitProperty(OP_PRIVATE_GET_PROPERTY_NO_POP, name);
       emitByte(OP_DECREMENT);
-      emitBytes(OP_PRIVATE_PROPERTY_SET, name);
+      emitProperty(OP_PRIVATE_PROPERTY_SET, name);
     } else {
-      emitBytes(OP_PRIVATE_PROPERTY_GET, name);
+      emitProperty(OP_PRIVATE_PROPERTY_GET, name);
     }
   } else {
 
     if (canAssign && match(TOKEN_EQUAL)) {
       expression();
-      emitBytes(OP_SET_PROPERTY, name);
+      emitProperty(OP_SET_PROPERTY, name);
 
     } else if (canAssign && match(TOKEN_PLUS_PLUS)) {
-      emitBytes(OP_GET_PROPERTY_NO_POP, name);
+      emitProperty(OP_GET_PROPERTY_NO_POP, name);
       emitByte(OP_INCREMENT);
-      emitBytes(OP_SET_PROPERTY, name);
+      emitProperty(OP_SET_PROPERTY, name);
 
     } else if (canAssign && match(TOKEN_MINUS_MINUS)) {
-      emitBytes(OP_GET_PROPERTY_NO_POP, name);
+      emitProperty(OP_GET_PROPERTY_NO_POP, name);
       emitByte(OP_DECREMENT);
-      emitBytes(OP_SET_PROPERTY, name);
+      emitProperty(OP_SET_PROPERTY, name);
     } else {
-      emitBytes(OP_GET_PROPERTY, name);
+      emitProperty(OP_GET_PROPERTY, name);
     }
   }
 
-  current->lastCall = false;
   
 }
 
@@ -599,14 +677,12 @@ static void literal(bool canAssign) {
     default: return;
   }
 
-  current->lastCall = false;
   
 }
 
 static void grouping(bool canAssign) {
   expression();
   consume(TOKEN_RIGHT_PAREN, "Expected a ')' after the expression.");
-  current->lastCall = false;
 }
 
 static void number(bool canAssign) {
@@ -636,7 +712,6 @@ static void or_(bool canAssign, Token previous) {
   parsePrecedence(PREC_OR);
   patchJump(endJump);
 
-  current->lastCall = false;
   
 }
 
@@ -697,16 +772,20 @@ static void namedVariable(Token name, bool canAssign) {
     getOp = OP_GET_UPVALUE;
     setOp = OP_SET_UPVALUE;
   } else {
-    arg = identifierConstant(&name);
+    // Module level names are resolved to their slot here, a name
+    // first seen before its definition gets an unassigned slot.
     ObjString* string = copyString(name.start, name.length);
     Value val;
     if (tableGet(&vm.globals, string, &val)) {
+      arg = (int)AS_NUMBER(val);
       getOp = OP_GET_GLOBAL;
       canAssign = false;
     } else if (tableGet(&parser.library->privateValues, string, &val)) {
+      arg = (int)AS_NUMBER(val);
       getOp = OP_PRIVATE_GET;
       setOp = OP_PRIVATE_SET;
     } else {
+      arg = librarySlotOperand(string, false);
       getOp = OP_GET_LIBRARY;
       setOp = OP_SET_LIBRARY;
     }
@@ -714,19 +793,19 @@ static void namedVariable(Token name, bool canAssign) {
 
   if (canAssign && match(TOKEN_EQUAL)) {
     expression();
-    emitBytes(setOp, (uint8_t)arg);
+    emitIndexed(setOp, arg);
   } else if (canAssign && match(TOKEN_PLUS_PLUS)) {
     namedVariable(name, false);
     emitByte(OP_INCREMENT);
-    emitBytes(setOp, (uint8_t)arg);
+    emitIndexed(setOp, arg);
 
   } else if (canAssign && match(TOKEN_MINUS_MINUS)) {
     namedVariable(name, false);
     emitByte(OP_DECREMENT);
-    emitBytes(setOp, (uint8_t)arg);
+    emitIndexed(setOp, arg);
 
   } else {
-    emitBytes(getOp, (uint8_t)arg);
+    emitIndexed(getOp, arg);
   }
 
   
@@ -734,7 +813,6 @@ static void namedVariable(Token name, bool canAssign) {
 
 static void variable(bool canAssign) {
   namedVariable(parser.previous, canAssign);
-  current->lastCall = false;
 }
 
 static Token syntheticToken(const char* text) {
@@ -764,7 +842,6 @@ static void unary(bool canAssign) {
     default: return; // Unreachable.
   }
 
-  current->lastCall = false;
   
 }
 
@@ -778,6 +855,7 @@ static void decrement(bool canAssign, Token previous) {
 
 static void list(bool canAssign) {
   int count = 0;
+  bool built = false;
 
   if (!check(TOKEN_RIGHT_BRACK)) {
     do {
@@ -787,18 +865,60 @@ static void list(bool canAssign) {
 
       parsePrecedence(PREC_OR);
 
-      count++;
+      // Long literals are stored in batches so the items never pile up
+      // past a frame's worth of stack.
+      if (++count == UINT8_MAX) {
+        emitBytes(built ? OP_EXTEND_LIST : OP_BUILD_LIST, count);
+        built = true;
+        count = 0;
+      }
     } while(match(TOKEN_COMMA));
   }
 
   consume(TOKEN_RIGHT_BRACK, "Expected a closing ']' at the list's end.");
-  emitBytes(OP_BUILD_LIST, count);
-  current->lastCall = false;
+  if (!built) {
+    emitBytes(OP_BUILD_LIST, count);
+  } else if (count > 0) {
+    emitBytes(OP_EXTEND_LIST, count);
+  }
   
   
   return;
 }
 
+// Only where an expression is expected, a '{' that starts a statement
+// is a block.
+static void map(bool canAssign) {
+  int count = 0;
+  bool built = false;
+
+  if (!check(TOKEN_RIGHT_BRACE)) {
+    do {
+      if (check(TOKEN_RIGHT_BRACE)) {
+        break;
+      }
+
+      parsePrecedence(PREC_OR);
+      consume(TOKEN_COLON, "Expected a ':' after the map key.");
+      parsePrecedence(PREC_OR);
+
+      // Batched like list literals, two slots a pair.
+      if (++count == UINT8_MAX / 2) {
+        emitBytes(built ? OP_EXTEND_MAP : OP_BUILD_MAP, count);
+        built = true;
+        count = 0;
+      }
+    } while (match(TOKEN_COMMA));
+  }
+
+  consume(TOKEN_RIGHT_BRACE, "Expected a closing '}' at the map's end.");
+  if (!built) {
+    emitBytes(OP_BUILD_MAP, count);
+  } else if (count > 0) {
+    emitBytes(OP_EXTEND_MAP, count);
+  }
+}
+
 static void functionArguments() {
   if (!check(TOKEN_RIGHT_PAREN)) {
     do {
@@ -806,7 +926,7 @@ static void functionArguments() {
       if (current->function->arity > 30) {
         errorAtCurrent("Can't have more than 30 parameters.");
       }
-      uint8_t constant = parseVariable("Expected a parameter name or ')'.");
+      int constant = parseVariable("Expected a parameter name or ')'.");
       defineVariable(constant, false);
     } while (match(TOKEN_COMMA));
   }
@@ -832,7 +952,6 @@ static void subscript(bool canAssign, Token previous) {
     emitByte(OP_INDEX_SUBSCR);
   }
 
-  current->lastCall = false;
   
   return;
 }
@@ -857,16 +976,15 @@ static void arrow(bool canAssign) {
 
   ObjFunction* function = endCompiler();
 
-  uint8_t constant = makeConstant(OBJ_VAL(function));
-  emitBytes(OP_CLOSURE, constant);
+  emitIndexed(OP_CLOSURE, makeConstant(OBJ_VAL(function)));
 
   for (int i = 0; i < function->upvalueCount; i++) {
-    emitByte(current->upvalues[i].isLocal ? 1 : 0);
-    emitByte(current->upvalues[i].index);
+    emitByte(compiler.upvalues[i].isLocal ? 1 : 0);
+    emitByte(compiler.upvalues[i].index);
   }
 }
 
-static void body() {
+static void body(Compiler* compiler) {
   functionArguments();
 
   consume(TOKEN_RIGHT_PAREN, "Expected a closing ')'.");
@@ -875,19 +993,18 @@ static void body() {
   block();
 
   ObjFunction* function = endCompiler();
-  uint8_t constant = makeConstant(OBJ_VAL(function));
-  emitBytes(OP_CLOSURE, constant);
+  emitIndexed(OP_CLOSURE, makeConstant(OBJ_VAL(function)));
 
   for (int i = 0; i < function->upvalueCount; i++) {
-    emitByte(current->upvalues[i].isLocal ? 1 : 0);
-    emitByte(current->upvalues[i].index);
+    emitByte(compiler->upvalues[i].isLocal ? 1 : 0);
+    emitByte(compiler->upvalues[i].index);
   }
 }
 
 ParseRule rules[] = {
   [TOKEN_LEFT_PAREN]    = {grouping, call,   PREC_CALL},
   [TOKEN_RIGHT_PAREN]   = NONE,
-  [TOKEN_LEFT_BRACE]    = NONE, 
+  [TOKEN_LEFT_BRACE]    = {map,      NULL,   PREC_NONE},
   [TOKEN_RIGHT_BRACE]   = NONE,
   [TOKEN_COMMA]         = NONE,
   [TOKEN_DOT]           = {NULL,     dot,    PREC_CALL},
@@ -991,13 +1108,13 @@ static void function(FunctionType type) {
   initCompiler(&compiler, type);
   consume(TOKEN_LEFT_PAREN, "Expected a '(' after function name.");
   beginScope();
-  body();
+  body(&compiler);
 }
 
 static void method(bool isPrivate) {
   consume(TOKEN_IDENTIFIER, "Expected a method name.");
   Token methodName = parser.previous;
-  uint8_t constant = identifierConstant(&methodName);
+  int constant = identifierConstant(&methodName);
 
   FunctionType type = TYPE_METHOD;
 
@@ -1007,17 +1124,17 @@ static void method(bool isPrivate) {
   
   function(type);
   if (!isPrivate) {
-    emitBytes(OP_METHOD, constant);
+    emitIndexed(OP_METHOD, constant);
   } else {
     setPrivateProperty(methodName);
-    emitBytes(OP_PRIVATE_METHOD, constant);
+    emitIndexed(OP_PRIVATE_METHOD, constant);
   }
 }
 
 static void classDeclaration(bool isPrivate) {
   consume(TOKEN_IDENTIFIER, "Expected a class name.");
   Token className = parser.previous;
-  uint8_t nameConstant = identifierConstant(&className);
+  int nameConstant = identifierConstant(&className);
   declareVariable();
 
   ClassCompiler classCompiler;
@@ -1025,7 +1142,7 @@ static void classDeclaration(bool isPrivate) {
   currentClass = &classCompiler;
   initTable(&currentClass->privateVariables);
 
-  emitBytes(OP_CLASS, nameConstant);
+  emitIndexed(OP_CLASS, nameConstant);
   if (isPrivate) {
     setPrivateVariable(className);
   }
@@ -1049,7 +1166,7 @@ static void classDeclaration(bool isPrivate) {
 }
 
 static void funDeclaration(bool isPrivate) {
-  uint8_t global = parseVariable("Expected a function name.");
+  int global = parseVariable("Expected a function name.");
   Token name = parser.previous;
 
   if (isPrivate) {
@@ -1061,7 +1178,7 @@ static void funDeclaration(bool isPrivate) {
 }
 
 static void varDeclaration(bool isPrivate) {
-  uint8_t global = parseVariable("Expected a variable name.");
+  int global = parseVariable("Expected a variable name.");
   Token name = parser.previous;
 
   consume(TOKEN_EQUAL, "Expected an '=' after the variable name.");
@@ -1178,9 +1295,7 @@ static void forStatement() {
 }
 
 static void assertStatement() {
-  int constant = addConstant(
-    currentChunk(), OBJ_VAL(copyString("No Source.", 10))
-  );
+  int constant = makeConstant(OBJ_VAL(copyString("No Source.", 10)));
 
   expression();
   if (match(TOKEN_COMMA)) {
@@ -1188,29 +1303,29 @@ static void assertStatement() {
     //this way its faster & will omit few checks at runtime.
     //It doesnt need to be flexible because it should be only used for debugging.
     consume(TOKEN_STRING, "Expected an assert error string after the ','.");
-    constant = addConstant(currentChunk(), OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2)));
+    constant = makeConstant(OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2)));
   }
 
   consume(TOKEN_SEMICOLON, "Expected a ';' after assert's error string.");
-  emitBytes(OP_ASSERT, (uint8_t)constant);
+  emitIndexed(OP_ASSERT, constant);
 }
 
 static void useStatement() {
   if (match(TOKEN_STRING)) {
-    int constant = addConstant(currentChunk(), OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2)));
+    int constant = makeConstant(OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2)));
 
 
-    emitBytes(OP_USE, constant);
+    emitIndexed(OP_USE, constant);
     emitByte(OP_POP);
     
     if (match(TOKEN_FOR)) {
-      uint8_t library = parseVariable("Expected an identifier after library's path.");
+      int library = parseVariable("Expected an identifier after library's path.");
       emitByte(OP_USE_NAME);
       defineVariable(library, false);
     }
   } else {
     consume(TOKEN_IDENTIFIER, "Expected a library's name identifier.");
-    uint8_t libName = identifierConstant(&parser.previous);
+    int libName = identifierConstant(&parser.previous);
     declareVariable();
 
     int index = getNativeModule( (char*)parser.previous.start, parser.previous.length - parser.current.length );
@@ -1219,8 +1334,8 @@ static void useStatement() {
       error("Native library does not exist."); 
     }
 
-    emitBytes(OP_USE_BUILTIN, index);
-    emitByte(libName);
+    emitIndexed(OP_USE_BUILTIN, libName);
+    emitByte(index);
 
     defineVariable(libName, false);
   }
@@ -1277,9 +1392,11 @@ static void returnStatement() {
   consume(TOKEN_SEMICOLON, "Expected a ';' after the return value.");
 
 
-  if (current->lastCall) {
-    current->function->chunk.code[current->function->chunk.count - 2] = OP_TAIL_CALL;
-    current->lastCall = false;
+  // Only a call that is the very last thing the expression emitted is
+  // in tail position.
+  if (current->lastCall != -1 &&
+      current->lastCall == currentChunk()->count - 2) {
+    currentChunk()->code[current->lastCall] = OP_TAIL_CALL;
   }
 
   emitByte(OP_RETURN);
@@ -1357,7 +1474,6 @@ static int getArgCount(uint8_t *code, const ValueArray constants, int ip) {
     case OP_NIL:
     case OP_TRUE:
     case OP_FALSE:
-    case OP_BUILD_LIST:
 
     case OP_INDEX_SUBSCR:
     case OP_STORE_SUBSCR:
@@ -1375,6 +1491,8 @@ static int getArgCount(uint8_t *code, const ValueArray constants, int ip) {
     case OP_BIT_AND:
     case OP_BIT_XOR:
     case OP_BIT_OR:
+    case OP_BIT_LEFT:
+    case OP_BIT_RIGHT:
     case OP_MOD:
     case OP_NOT:
     case OP_NEGATE:
@@ -1402,18 +1520,20 @@ static int getArgCount(uint8_t *code, const ValueArray constants, int ip) {
     case OP_GET_UPVALUE:
     case OP_SET_UPVALUE:
 
-    case OP_GET_PROPERTY:
-    case OP_SET_PROPERTY:
-    case OP_GET_PROPERTY_NO_POP:
-    case OP_PRIVATE_GET_PROPERTY_NO_POP:
-    case OP_PRIVATE_PROPERTY_GET:
-    case OP_PRIVATE_PROPERTY_SET:
-
     case OP_CALL:
     case OP_TAIL_CALL:
     case OP_USE:
+    case OP_CLASS:
     case OP_METHOD:
+    case OP_PRIVATE_METHOD:
     case OP_ASSERT:
+    case OP_BUILD_LIST:
+    case OP_EXTEND_LIST:
+    case OP_BUILD_MAP:
+    case OP_EXTEND_MAP:
+
+    case OP_INCREMENT_LOCAL:
+    case OP_DECREMENT_LOCAL:
       return 1;
 
     case OP_JUMP:
@@ -1422,10 +1542,56 @@ static int getArgCount(uint8_t *code, const ValueArray constants, int ip) {
 
     case OP_INVOKE:
     case OP_INVOKE1:
-    case OP_CLASS:
     case OP_USE_BUILTIN:
+
+    case OP_ADD_LOCALS:
+    case OP_SUBTRACT_LOCALS:
+    case OP_ADD_LOCAL_CONSTANT:
+    case OP_SUBTRACT_LOCAL_CONSTANT:
+    case OP_EQUAL_JUMP:
+    case OP_GREATER_JUMP:
+    case OP_LESS_JUMP:
       return 2;
 
+    case OP_GET_PROPERTY:
+    case OP_SET_PROPERTY:
+    case OP_GET_PROPERTY_NO_POP:
+    case OP_PRIVATE_GET_PROPERTY_NO_POP:
+    case OP_PRIVATE_PROPERTY_GET:
+    case OP_PRIVATE_PROPERTY_SET:
+      return 3;
+
+    case OP_LESS_LOCAL_CONSTANT_JUMP:
+      return 4;
+
+    case OP_CONSTANT_LONG:
+    case OP_GET_GLOBAL_LONG:
+    case OP_DEFINE_LIBRARY_LONG:
+    case OP_GET_LIBRARY_LONG:
+    case OP_SET_LIBRARY_LONG:
+    case OP_PRIVATE_DEFINE_LONG:
+    case OP_PRIVATE_GET_LONG:
+    case OP_PRIVATE_SET_LONG:
+    case OP_CLASS_LONG:
+    case OP_METHOD_LONG:
+    case OP_PRIVATE_METHOD_LONG:
+    case OP_USE_LONG:
+    case OP_ASSERT_LONG:
+      return 3;
+
+    case OP_INVOKE_LONG:
+    case OP_INVOKE1_LONG:
+    case OP_USE_BUILTIN_LONG:
+      return 4;
+
+    case OP_GET_PROPERTY_LONG:
+    case OP_SET_PROPERTY_LONG:
+    case OP_GET_PROPERTY_NO_POP_LONG:
+    case OP_PRIVATE_GET_PROPERTY_NO_POP_LONG:
+    case OP_PRIVATE_PROPERTY_GET_LONG:
+    case OP_PRIVATE_PROPERTY_SET_LONG:
+      return 5;
+
 
     case OP_CLOSURE: {
       int constant = code[ip + 1];
@@ -1433,16 +1599,373 @@ static int getArgCount(uint8_t *code, const ValueArray constants, int ip) {
 
       return 1 + (loadedFn->upvalueCount * 2);
     }
+
+    case OP_CLOSURE_LONG: {
+      int constant = (code[ip + 1] << 16) | (code[ip + 2] << 8) | code[ip + 3];
+      ObjFunction* loadedFn = AS_FUNCTION(constants.values[constant]);
+
+      return 3 + (loadedFn->upvalueCount * 2);
+    }
   }
 
   return 0;
 }
 
+// How many values the instruction at 'ip' leaves on the stack, less the
+// ones it takes, when it falls through to the next instruction.
+static int stackEffect(uint8_t* code, int ip) {
+  switch (code[ip]) {
+    case OP_CONSTANT:
+    case OP_CONSTANT_LONG:
+    case OP_NIL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_GET_LOCAL:
+    case OP_GET_GLOBAL:
+    case OP_GET_GLOBAL_LONG:
+    case OP_GET_UPVALUE:
+    case OP_GET_LIBRARY:
+    case OP_GET_LIBRARY_LONG:
+    case OP_PRIVATE_GET:
+    case OP_PRIVATE_GET_LONG:
+    case OP_GET_PROPERTY_NO_POP:
+    case OP_GET_PROPERTY_NO_POP_LONG:
+    case OP_PRIVATE_GET_PROPERTY_NO_POP:
+    case OP_PRIVATE_GET_PROPERTY_NO_POP_LONG:
+    case OP_INDEX_SUBSCR_NO_POP:
+    case OP_CLOSURE:
+    case OP_CLOSURE_LONG:
+    case OP_CLASS:
+    case OP_CLASS_LONG:
+    case OP_USE:
+    case OP_USE_LONG:
+    case OP_USE_BUILTIN:
+    case OP_USE_BUILTIN_LONG:
+    case OP_USE_NAME:
+    case OP_ADD_LOCALS:
+    case OP_SUBTRACT_LOCALS:
+    case OP_ADD_LOCAL_CONSTANT:
+    case OP_SUBTRACT_LOCAL_CONSTANT:
+      return 1;
 
-static void statement() {
-  current->lastCall = false;
-  
+    case OP_POP:
+    case OP_CLOSE_UPVALUE:
+    case OP_SET_PROPERTY:
+    case OP_SET_PROPERTY_LONG:
+    case OP_PRIVATE_PROPERTY_SET:
+    case OP_PRIVATE_PROPERTY_SET_LONG:
+    case OP_EQUAL:
+    case OP_GREATER:
+    case OP_LESS:
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_MOD:
+    case OP_POW:
+    case OP_BIT_AND:
+    case OP_BIT_OR:
+    case OP_BIT_XOR:
+    case OP_BIT_LEFT:
+    case OP_BIT_RIGHT:
+    case OP_INDEX_SUBSCR:
+    case OP_METHOD:
+    case OP_METHOD_LONG:
+    case OP_PRIVATE_METHOD:
+    case OP_PRIVATE_METHOD_LONG:
+    case OP_ASSERT:
+    case OP_ASSERT_LONG:
+    case OP_DEFINE_LIBRARY:
+    case OP_DEFINE_LIBRARY_LONG:
+    case OP_PRIVATE_DEFINE:
+    case OP_PRIVATE_DEFINE_LONG:
+      return -1;
+
+    case OP_STORE_SUBSCR:
+    case OP_EQUAL_JUMP:
+    case OP_GREATER_JUMP:
+    case OP_LESS_JUMP:
+      return -2;
+
+    // The callee and arguments are replaced by the result.
+    case OP_CALL:
+    case OP_TAIL_CALL:
+      return -code[ip + 1];
+
+    case OP_INVOKE:
+    case OP_INVOKE1:
+      return -code[ip + 2];
+
+    case OP_INVOKE_LONG:
+    case OP_INVOKE1_LONG:
+      return -code[ip + 4];
+
+    case OP_BUILD_LIST:
+      return 1 - code[ip + 1];
+
+    case OP_EXTEND_LIST:
+      return -code[ip + 1];
+
+    case OP_BUILD_MAP:
+      return 1 - code[ip + 1] * 2;
+
+    case OP_EXTEND_MAP:
+      return -code[ip + 1] * 2;
+
+    default:
+      return 0;
+  }
+}
+
+//> peephole
+#define MAX_FUSED 5
+
+typedef struct {
+  int end;
+  int target;
+  bool backward;
+} PendingJump;
+
+static bool isJump(uint8_t instruction) {
+  switch (instruction) {
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_LOOP:
+    case OP_EQUAL_JUMP:
+    case OP_GREATER_JUMP:
+    case OP_LESS_JUMP:
+    case OP_LESS_LOCAL_CONSTANT_JUMP:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// The jump offset is always the last two bytes of the instruction.
+static int jumpTarget(uint8_t* code, int offset, int end) {
+  uint16_t jump = (uint16_t)((code[end - 2] << 8) | code[end - 1]);
+  return code[offset] == OP_LOOP ? end - jump : end + jump;
+}
+
+// Rewrites common instruction sequences into superinstructions.
+// Only the first instruction of a fused sequence may be a jump target,
+// every jump is re-patched against the new offsets once the code is
+// rewritten. A fused instruction takes the line of the instruction
+// that could fail at runtime.
+static void optimizeChunk(Chunk* chunk) {
+  uint8_t* code = chunk->code;
+  int count = chunk->count;
+
+  bool* isTarget = ALLOCATE(bool, count + 1);
+  memset(isTarget, 0, sizeof(bool) * (count + 1));
+
+  for (int i = 0; i < count;) {
+    int end = i + 1 + getArgCount(code, chunk->constants, i);
+
+    if (code[i] == OP_BREAK || end > count) {
+      // Unpatched 'break', leave the chunk alone.
+      FREE_ARRAY(bool, isTarget, count + 1);
+      return;
+    }
+
+    if (isJump(code[i])) {
+      int target = jumpTarget(code, i, end);
+      if (target >= 0 && target <= count) isTarget[target] = true;
+    }
+
+    i = end;
+  }
+
+  uint8_t* newCode = ALLOCATE(uint8_t, chunk->capacity);
+  LineTable newLines;
+  initLineTable(&newLines);
+  LineCursor lines;
+  initLineCursor(&lines, &chunk->lines);
+  int* newOffsets = ALLOCATE(int, count + 1);
+  PendingJump* jumps = ALLOCATE(PendingJump, count);
+  int jumpCount = 0;
+
+  int length = 0;
+  int i = 0;
+  while (i < count) {
+    int at[MAX_FUSED + 1];
+    uint8_t op[MAX_FUSED];
+    int window = 0;
 
+    at[0] = i;
+    while (window < MAX_FUSED && at[window] < count) {
+      if (window > 0 && isTarget[at[window]]) break;
+
+      op[window] = code[at[window]];
+      at[window + 1] = at[window] + 1 + getArgCount(code, chunk->constants, at[window]);
+      window++;
+    }
+
+    int start = length;
+    int fused = 1;
+    int lineFrom = 0;
+    int target = -1;
+
+    if (window >= 5 && op[0] == OP_GET_LOCAL && op[1] == OP_CONSTANT &&
+        op[2] == OP_LESS && op[3] == OP_JUMP_IF_FALSE && op[4] == OP_POP) {
+      // 'for' and 'while' conditions such as 'i < 10'.
+      newCode[length++] = OP_LESS_LOCAL_CONSTANT_JUMP;
+      newCode[length++] = code[at[0] + 1];
+      newCode[length++] = code[at[1] + 1];
+      length += 2;
+
+      target = jumpTarget(code, at[3], at[4]);
+      fused = 5;
+      lineFrom = 2;
+    } else if (window >= 4 && op[0] == OP_GET_LOCAL &&
+        (op[1] == OP_INCREMENT || op[1] == OP_DECREMENT) &&
+        op[2] == OP_SET_LOCAL && op[3] == OP_POP &&
+        code[at[0] + 1] == code[at[2] + 1]) {
+      // 'i++;' and 'i--;' as statements.
+      newCode[length++] = op[1] == OP_INCREMENT ? OP_INCREMENT_LOCAL : OP_DECREMENT_LOCAL;
+      newCode[length++] = code[at[0] + 1];
+
+      fused = 4;
+      lineFrom = 1;
+    } else if (window >= 3 &&
+        (op[0] == OP_EQUAL || op[0] == OP_GREATER || op[0] == OP_LESS) &&
+        op[1] == OP_JUMP_IF_FALSE && op[2] == OP_POP) {
+      switch (op[0]) {
+        case OP_EQUAL: newCode[length++] = OP_EQUAL_JUMP; break;
+        case OP_GREATER: newCode[length++] = OP_GREATER_JUMP; break;
+        default: newCode[length++] = OP_LESS_JUMP; break;
+      }
+      length += 2;
+
+      target = jumpTarget(code, at[1], at[2]);
+      fused = 3;
+    } else if (window >= 3 && op[0] == OP_GET_LOCAL &&
+        (op[1] == OP_GET_LOCAL || op[1] == OP_CONSTANT) &&
+        (op[2] == OP_ADD || op[2] == OP_SUBTRACT)) {
+      if (op[1] == OP_GET_LOCAL) {
+        newCode[length++] = op[2] == OP_ADD ? OP_ADD_LOCALS : OP_SUBTRACT_LOCALS;
+      } else {
+        newCode[length++] = op[2] == OP_ADD ? OP_ADD_LOCAL_CONSTANT : OP_SUBTRACT_LOCAL_CONSTANT;
+      }
+      newCode[length++] = code[at[0] + 1];
+      newCode[length++] = code[at[1] + 1];
+
+      fused = 3;
+      lineFrom = 2;
+    } else {
+      memcpy(newCode + length, code + at[0], at[1] - at[0]);
+      length += at[1] - at[0];
+
+      if (isJump(op[0])) target = jumpTarget(code, at[0], at[1]);
+    }
+
+    if (target != -1) {
+      jumps[jumpCount].end = length;
+      jumps[jumpCount].target = target;
+      jumps[jumpCount].backward = fused == 1 && op[0] == OP_LOOP;
+      jumpCount++;
+    }
+
+    for (int k = 0; k < fused; k++) {
+      newOffsets[at[k]] = start;
+    }
+
+    SourceLocation location = seekLine(&lines, at[lineFrom]);
+    addLine(&newLines, start, location.line, location.column);
+
+    i = at[fused];
+  }
+
+  newOffsets[count] = length;
+
+  for (int j = 0; j < jumpCount; j++) {
+    int end = jumps[j].end;
+    int target = newOffsets[jumps[j].target];
+    int jump = jumps[j].backward ? end - target : target - end;
+
+    newCode[end - 2] = (jump >> 8) & 0xff;
+    newCode[end - 1] = jump & 0xff;
+  }
+
+  FREE_ARRAY(bool, isTarget, count + 1);
+  FREE_ARRAY(int, newOffsets, count + 1);
+  FREE_ARRAY(PendingJump, jumps, count);
+
+  FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
+  freeLineTable(&chunk->lines);
+
+  chunk->code = newCode;
+  chunk->lines = newLines;
+  chunk->count = length;
+}
+
+#undef MAX_FUSED
+//< peephole
+
+// The fused compare and jumps leave their false result behind when they
+// jump and take it along when they fall through.
+static int jumpStackEffect(uint8_t instruction) {
+  switch (instruction) {
+    case OP_EQUAL_JUMP:
+    case OP_GREATER_JUMP:
+    case OP_LESS_JUMP:
+      return -1;
+
+    case OP_LESS_LOCAL_CONSTANT_JUMP:
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+// The most values a call of the function holds at once, counting slot
+// zero and the parameters. Every path into an instruction agrees on the
+// depth there, so one pass in code order does, with forward jumps
+// handing their depth to the target. Code after a jump or return that
+// nothing jumps to keeps the depth it follows.
+static int maxStackDepth(Chunk* chunk, int arity) {
+  uint8_t* code = chunk->code;
+  int count = chunk->count;
+
+  int* depths = ALLOCATE(int, count + 1);
+  for (int i = 0; i <= count; i++) depths[i] = -1;
+
+  int depth = arity + 1;
+  int max = depth;
+  bool reachable = true;
+
+  for (int i = 0; i < count;) {
+    uint8_t instruction = code[i];
+    int end = i + 1 + getArgCount(code, chunk->constants, i);
+
+    if (depths[i] != -1 && (!reachable || depths[i] > depth)) {
+      depth = depths[i];
+    }
+
+    if (isJump(instruction)) {
+      int target = jumpTarget(code, i, end);
+      int taken = depth + jumpStackEffect(instruction);
+      if (target > i && target <= count && taken > depths[target]) {
+        depths[target] = taken;
+      }
+      if (taken > max) max = taken;
+    }
+
+    depth += stackEffect(code, i);
+    if (depth > max) max = depth;
+
+    reachable = instruction != OP_JUMP && instruction != OP_LOOP &&
+                instruction != OP_RETURN;
+    i = end;
+  }
+
+  FREE_ARRAY(int, depths, count + 1);
+  return max;
+}
+
+static void statement() {
   if (match(TOKEN_FOR)) {
     forStatement();
   } else if (match(TOKEN_USE)) {
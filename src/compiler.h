@@ -71,7 +71,8 @@ typedef struct Compiler {
   ObjFunction* function;
   FunctionType type;
 
-  bool lastCall;
+  // Offset of the most recent OP_CALL, or -1.
+  int lastCall;
 
   Local locals[UINT8_COUNT];
   int localCount;
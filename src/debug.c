@@ -38,6 +38,85 @@ static int invokeInstruction(const char* name, Chunk* chunk,
   return offset + 3;
 }
 
+static int propertyInstruction(const char* name, Chunk* chunk,
+                               int offset) {
+  uint8_t constant = chunk->code[offset + 1];
+  uint16_t cache = (uint16_t)(chunk->code[offset + 2] << 8);
+  cache |= chunk->code[offset + 3];
+  printf("%-16s %4d '", name, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("' (cache %d)\n", cache);
+  return offset + 4;
+}
+
+static int readLong(Chunk* chunk, int offset) {
+  return (chunk->code[offset] << 16) | (chunk->code[offset + 1] << 8) |
+         chunk->code[offset + 2];
+}
+
+static int longConstantInstruction(const char* name, Chunk* chunk,
+                                   int offset) {
+  int constant = readLong(chunk, offset + 1);
+  printf("%-16s %4d '", name, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("'\n");
+  return offset + 4;
+}
+
+static int longInvokeInstruction(const char* name, Chunk* chunk,
+                                 int offset) {
+  int constant = readLong(chunk, offset + 1);
+  uint8_t argCount = chunk->code[offset + 4];
+  printf("%-16s (%d args) %4d '", name, argCount, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("'\n");
+  return offset + 5;
+}
+
+static int longPropertyInstruction(const char* name, Chunk* chunk,
+                                   int offset) {
+  int constant = readLong(chunk, offset + 1);
+  uint16_t cache = (uint16_t)(chunk->code[offset + 4] << 8);
+  cache |= chunk->code[offset + 5];
+  printf("%-16s %4d '", name, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("' (cache %d)\n", cache);
+  return offset + 6;
+}
+
+static int longSlotInstruction(const char* name, Chunk* chunk,
+                               int offset) {
+  printf("%-16s %4d\n", name, readLong(chunk, offset + 1));
+  return offset + 4;
+}
+
+static int closureInstruction(const char* name, Chunk* chunk,
+                              int offset, bool isLong) {
+  offset++;
+  int constant;
+  if (isLong) {
+    constant = readLong(chunk, offset);
+    offset += 3;
+  } else {
+    constant = chunk->code[offset++];
+  }
+
+  printf("%-16s %4d ", name, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("\n");
+
+  ObjFunction* function = AS_FUNCTION(
+      chunk->constants.values[constant]);
+  for (int j = 0; j < function->upvalueCount; j++) {
+    int isLocal = chunk->code[offset++];
+    int index = chunk->code[offset++];
+    printf("%04d      |                     %s %d\n",
+           offset - 2, isLocal ? "local" : "upvalue", index);
+  }
+
+  return offset;
+}
+
 static int simpleInstruction(const char* name, int offset) {
   printf("%s\n", name);
   return offset + 1;
@@ -59,14 +138,45 @@ static int jumpInstruction(const char* name, int sign,
   return offset + 3;
 }
 
+static int twoByteInstruction(const char* name, Chunk* chunk,
+                              int offset) {
+  uint8_t first = chunk->code[offset + 1];
+  uint8_t second = chunk->code[offset + 2];
+  printf("%-16s %4d %4d\n", name, first, second);
+  return offset + 3;
+}
+
+static int localConstantInstruction(const char* name, Chunk* chunk,
+                                    int offset) {
+  uint8_t slot = chunk->code[offset + 1];
+  uint8_t constant = chunk->code[offset + 2];
+  printf("%-16s %4d %4d '", name, slot, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("'\n");
+  return offset + 3;
+}
+
+static int localConstantJumpInstruction(const char* name, Chunk* chunk,
+                                        int offset) {
+  uint8_t slot = chunk->code[offset + 1];
+  uint8_t constant = chunk->code[offset + 2];
+  uint16_t jump = (uint16_t)(chunk->code[offset + 3] << 8);
+  jump |= chunk->code[offset + 4];
+  printf("%-16s %4d %4d '", name, slot, constant);
+  printValue(chunk->constants.values[constant]);
+  printf("' %4d -> %d\n", offset, offset + 5 + jump);
+  return offset + 5;
+}
+
 int disassembleInstruction(Chunk* chunk, int offset) {
   printf("%04d ", offset);
 //> show-location
+  SourceLocation location = getSourceLocation(chunk, offset);
   if (offset > 0 &&
-      chunk->lines[offset] == chunk->lines[offset - 1]) {
+      location.line == getSourceLocation(chunk, offset - 1).line) {
     printf("   | ");
   } else {
-    printf("%4d ", chunk->lines[offset]);
+    printf("%4d ", location.line);
   }
 //< show-location
   
@@ -101,6 +211,12 @@ int disassembleInstruction(Chunk* chunk, int offset) {
 
     case OP_BUILD_LIST:
       return byteInstruction("OP_BUILD_LIST", chunk, offset);
+    case OP_EXTEND_LIST:
+      return byteInstruction("OP_EXTEND_LIST", chunk, offset);
+    case OP_BUILD_MAP:
+      return byteInstruction("OP_BUILD_MAP", chunk, offset);
+    case OP_EXTEND_MAP:
+      return byteInstruction("OP_EXTEND_MAP", chunk, offset);
 
     case OP_GET_LOCAL:
       return byteInstruction("OP_GET_LOCAL", chunk, offset);
@@ -108,17 +224,17 @@ int disassembleInstruction(Chunk* chunk, int offset) {
       return byteInstruction("OP_SET_LOCAL", chunk, offset);
 
     case OP_GET_LIBRARY:
-      return constantInstruction("OP_GET_LIBRARY", chunk, offset);
+      return byteInstruction("OP_GET_LIBRARY", chunk, offset);
     case OP_PRIVATE_GET:
-      return constantInstruction("OP_PRIVATE_GET", chunk, offset);
+      return byteInstruction("OP_PRIVATE_GET", chunk, offset);
 
     case OP_GET_GLOBAL:
-      return constantInstruction("OP_GET_GLOBAL", chunk, offset);
+      return byteInstruction("OP_GET_GLOBAL", chunk, offset);
 
     case OP_DEFINE_LIBRARY:
-      return constantInstruction("OP_DEFINE_LIBRARY", chunk, offset);
+      return byteInstruction("OP_DEFINE_LIBRARY", chunk, offset);
     case OP_PRIVATE_DEFINE:
-      return constantInstruction("OP_PRIVATE_DEFINE", chunk, offset);
+      return byteInstruction("OP_PRIVATE_DEFINE", chunk, offset);
 
     case OP_USE:
       return constantInstruction("OP_USE", chunk, offset);
@@ -127,9 +243,9 @@ int disassembleInstruction(Chunk* chunk, int offset) {
       return simpleInstruction("OP_RECENT_USE", offset);
 
     case OP_SET_LIBRARY:
-      return constantInstruction("OP_SET_LIBRARY", chunk, offset);
+      return byteInstruction("OP_SET_LIBRARY", chunk, offset);
     case OP_PRIVATE_SET:
-      return constantInstruction("OP_PRIVATE_SET", chunk, offset);
+      return byteInstruction("OP_PRIVATE_SET", chunk, offset);
 
     case OP_ASSERT:
       return constantInstruction("OP_ASSERT", chunk, offset);
@@ -140,21 +256,22 @@ int disassembleInstruction(Chunk* chunk, int offset) {
       return byteInstruction("OP_SET_UPVALUE", chunk, offset);
 
     case OP_GET_PROPERTY:
-      return constantInstruction("OP_GET_PROPERTY", chunk, offset);
+      return propertyInstruction("OP_GET_PROPERTY", chunk, offset);
     case OP_GET_PROPERTY_NO_POP:
-      return constantInstruction("OP_GET_PROPERTY_NO_POP", chunk, offset);
+      return propertyInstruction("OP_GET_PROPERTY_NO_POP", chunk, offset);
     case OP_PRIVATE_GET_PROPERTY_NO_POP:
-      return constantInstruction("OP_PRIVATE_GET_PROPERTY_NO_POP", chunk, offset);
+      return propertyInstruction("OP_PRIVATE_GET_PROPERTY_NO_POP", chunk, offset);
     case OP_SET_PROPERTY:
-      return constantInstruction("OP_SET_PROPERTY", chunk, offset);
+      return propertyInstruction("OP_SET_PROPERTY", chunk, offset);
 
     case OP_PRIVATE_PROPERTY_GET:
-      return constantInstruction("OP_PRIVATE_PROPERTY_GET", chunk, offset);
+      return propertyInstruction("OP_PRIVATE_PROPERTY_GET", chunk, offset);
     case OP_PRIVATE_PROPERTY_SET:
-      return constantInstruction("OP_PRIVATE_PROPERTY_SET", chunk, offset);
+      return propertyInstruction("OP_PRIVATE_PROPERTY_SET", chunk, offset);
 
     case OP_USE_BUILTIN:
-      return simpleInstruction("OP_USE_BUILTIN", offset);
+      // The native module's index follows the name.
+      return constantInstruction("OP_USE_BUILTIN", chunk, offset) + 1;
 
     case OP_EQUAL:
       return simpleInstruction("OP_EQUAL", offset);
@@ -212,25 +329,8 @@ int disassembleInstruction(Chunk* chunk, int offset) {
       return invokeInstruction("OP_INVOKE1", chunk, offset);  
 
 
-    case OP_CLOSURE: {
-      offset++;
-      uint8_t constant = chunk->code[offset++];
-      printf("%-16s %4d ", "OP_CLOSURE", constant);
-      printValue(chunk->constants.values[constant]);
-      printf("\n");
-
-
-      ObjFunction* function = AS_FUNCTION(
-          chunk->constants.values[constant]);
-      for (int j = 0; j < function->upvalueCount; j++) {
-        int isLocal = chunk->code[offset++];
-        int index = chunk->code[offset++];
-        printf("%04d      |                     %s %d\n",
-               offset - 2, isLocal ? "local" : "upvalue", index);
-      }
-      
-      return offset;
-    }
+    case OP_CLOSURE:
+      return closureInstruction("OP_CLOSURE", chunk, offset, false);
 
     case OP_CLOSE_UPVALUE:
       return simpleInstruction("OP_CLOSE_UPVALUE", offset);
@@ -247,6 +347,80 @@ int disassembleInstruction(Chunk* chunk, int offset) {
     case OP_PRIVATE_METHOD:
       return constantInstruction("OP_PRIVATE_METHOD", chunk, offset);
 
+    case OP_ADD_LOCALS:
+      return twoByteInstruction("OP_ADD_LOCALS", chunk, offset);
+    case OP_SUBTRACT_LOCALS:
+      return twoByteInstruction("OP_SUBTRACT_LOCALS", chunk, offset);
+    case OP_ADD_LOCAL_CONSTANT:
+      return localConstantInstruction("OP_ADD_LOCAL_CONSTANT", chunk, offset);
+    case OP_SUBTRACT_LOCAL_CONSTANT:
+      return localConstantInstruction("OP_SUBTRACT_LOCAL_CONSTANT", chunk, offset);
+
+    case OP_EQUAL_JUMP:
+      return jumpInstruction("OP_EQUAL_JUMP", 1, chunk, offset);
+    case OP_GREATER_JUMP:
+      return jumpInstruction("OP_GREATER_JUMP", 1, chunk, offset);
+    case OP_LESS_JUMP:
+      return jumpInstruction("OP_LESS_JUMP", 1, chunk, offset);
+    case OP_LESS_LOCAL_CONSTANT_JUMP:
+      return localConstantJumpInstruction("OP_LESS_LOCAL_CONSTANT_JUMP", chunk, offset);
+
+    case OP_INCREMENT_LOCAL:
+      return byteInstruction("OP_INCREMENT_LOCAL", chunk, offset);
+    case OP_DECREMENT_LOCAL:
+      return byteInstruction("OP_DECREMENT_LOCAL", chunk, offset);
+
+    case OP_CONSTANT_LONG:
+      return longConstantInstruction("OP_CONSTANT_LONG", chunk, offset);
+    case OP_CLASS_LONG:
+      return longConstantInstruction("OP_CLASS_LONG", chunk, offset);
+    case OP_METHOD_LONG:
+      return longConstantInstruction("OP_METHOD_LONG", chunk, offset);
+    case OP_PRIVATE_METHOD_LONG:
+      return longConstantInstruction("OP_PRIVATE_METHOD_LONG", chunk, offset);
+    case OP_USE_LONG:
+      return longConstantInstruction("OP_USE_LONG", chunk, offset);
+    case OP_ASSERT_LONG:
+      return longConstantInstruction("OP_ASSERT_LONG", chunk, offset);
+
+    case OP_GET_GLOBAL_LONG:
+      return longSlotInstruction("OP_GET_GLOBAL_LONG", chunk, offset);
+    case OP_DEFINE_LIBRARY_LONG:
+      return longSlotInstruction("OP_DEFINE_LIBRARY_LONG", chunk, offset);
+    case OP_GET_LIBRARY_LONG:
+      return longSlotInstruction("OP_GET_LIBRARY_LONG", chunk, offset);
+    case OP_SET_LIBRARY_LONG:
+      return longSlotInstruction("OP_SET_LIBRARY_LONG", chunk, offset);
+    case OP_PRIVATE_DEFINE_LONG:
+      return longSlotInstruction("OP_PRIVATE_DEFINE_LONG", chunk, offset);
+    case OP_PRIVATE_GET_LONG:
+      return longSlotInstruction("OP_PRIVATE_GET_LONG", chunk, offset);
+    case OP_PRIVATE_SET_LONG:
+      return longSlotInstruction("OP_PRIVATE_SET_LONG", chunk, offset);
+
+    case OP_GET_PROPERTY_LONG:
+      return longPropertyInstruction("OP_GET_PROPERTY_LONG", chunk, offset);
+    case OP_SET_PROPERTY_LONG:
+      return longPropertyInstruction("OP_SET_PROPERTY_LONG", chunk, offset);
+    case OP_GET_PROPERTY_NO_POP_LONG:
+      return longPropertyInstruction("OP_GET_PROPERTY_NO_POP_LONG", chunk, offset);
+    case OP_PRIVATE_PROPERTY_GET_LONG:
+      return longPropertyInstruction("OP_PRIVATE_PROPERTY_GET_LONG", chunk, offset);
+    case OP_PRIVATE_PROPERTY_SET_LONG:
+      return longPropertyInstruction("OP_PRIVATE_PROPERTY_SET_LONG", chunk, offset);
+    case OP_PRIVATE_GET_PROPERTY_NO_POP_LONG:
+      return longPropertyInstruction("OP_PRIVATE_GET_PROPERTY_NO_POP_LONG", chunk, offset);
+
+    case OP_INVOKE_LONG:
+      return longInvokeInstruction("OP_INVOKE_LONG", chunk, offset);
+    case OP_INVOKE1_LONG:
+      return longInvokeInstruction("OP_INVOKE1_LONG", chunk, offset);
+    case OP_USE_BUILTIN_LONG:
+      return longConstantInstruction("OP_USE_BUILTIN_LONG", chunk, offset) + 1;
+
+    case OP_CLOSURE_LONG:
+      return closureInstruction("OP_CLOSURE_LONG", chunk, offset, true);
+
     default:
       printf("Unknown opcode %d\n", instruction);
       return offset + 1;
@@ -24,9 +24,7 @@ static void repl() {
 
 
 static void runFile(char* path) {
-  char* source = readFile(path);
-  InterpretResult result = interpret(source, path);
-  free(source);
+  InterpretResult result = interpretFile(path);
 
   if (result == INTERPRET_COMPILE_ERROR) exit(65);
   if (result == INTERPRET_RUNTIME_ERROR) exit(70);
@@ -0,0 +1,239 @@
+#ifdef PARALLEL_MARK
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "mark.h"
+#include "memory.h"
+#include "vm.h"
+
+#define DEQUE_INITIAL 1024
+
+typedef struct MarkBuffer {
+  int64_t capacity;
+  // Thieves may still be reading a buffer that was outgrown, they are
+  // all freed once marking is over.
+  struct MarkBuffer* previous;
+  Obj* items[];
+} MarkBuffer;
+
+// A Chase-Lev deque, the owner pushes and takes at 'bottom' while the
+// other workers steal at 'top'.
+struct MarkWorker {
+  int64_t top;
+  int64_t bottom;
+  MarkBuffer* buffer;
+  uint32_t seed;
+
+  // Keeps the workers off each other's cache lines.
+  char padding[64];
+};
+
+_Thread_local MarkWorker* markWorker = NULL;
+
+static MarkWorker* workers;
+static int workerCount;
+static int idleCount;
+static bool started;
+
+static MarkBuffer* newBuffer(int64_t capacity) {
+  MarkBuffer* buffer = (MarkBuffer*)malloc(sizeof(MarkBuffer) +
+                                           sizeof(Obj*) * capacity);
+  if (buffer == NULL) exit(1);
+
+  buffer->capacity = capacity;
+  buffer->previous = NULL;
+  return buffer;
+}
+
+void markWorkerPush(MarkWorker* worker, Obj* object) {
+  int64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+  int64_t top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+  MarkBuffer* buffer = worker->buffer;
+
+  if (bottom - top > buffer->capacity - 1) {
+    MarkBuffer* grown = newBuffer(buffer->capacity * 2);
+    for (int64_t i = top; i < bottom; i++) {
+      grown->items[i & (grown->capacity - 1)] =
+          buffer->items[i & (buffer->capacity - 1)];
+    }
+
+    grown->previous = buffer;
+    __atomic_store_n(&worker->buffer, grown, __ATOMIC_RELEASE);
+    buffer = grown;
+  }
+
+  __atomic_store_n(&buffer->items[bottom & (buffer->capacity - 1)], object,
+                   __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+}
+
+static Obj* takeWork(MarkWorker* worker) {
+  int64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+  MarkBuffer* buffer = worker->buffer;
+  __atomic_store_n(&worker->bottom, bottom, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t top = __atomic_load_n(&worker->top, __ATOMIC_RELAXED);
+
+  if (top > bottom) {
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return NULL;
+  }
+
+  Obj* object = __atomic_load_n(&buffer->items[bottom & (buffer->capacity - 1)],
+                                __ATOMIC_RELAXED);
+  if (top == bottom) {
+    // The last one, a thief may be after it as well.
+    if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+      object = NULL;
+    }
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+  }
+
+  return object;
+}
+
+// Returns NULL when the deque is empty or another thief won.
+static Obj* stealWork(MarkWorker* worker) {
+  int64_t top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_ACQUIRE);
+  if (top >= bottom) return NULL;
+
+  MarkBuffer* buffer = __atomic_load_n(&worker->buffer, __ATOMIC_ACQUIRE);
+  Obj* object = __atomic_load_n(&buffer->items[top & (buffer->capacity - 1)],
+                                __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&worker->top, &top, top + 1, false,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    return NULL;
+  }
+
+  return object;
+}
+
+static Obj* stealFromOthers(MarkWorker* self) {
+  for (int attempt = 0; attempt < workerCount * 2; attempt++) {
+    // xorshift, the victims only need to be spread out.
+    self->seed ^= self->seed << 13;
+    self->seed ^= self->seed >> 17;
+    self->seed ^= self->seed << 5;
+
+    MarkWorker* victim = &workers[self->seed % workerCount];
+    if (victim == self) continue;
+
+    Obj* object = stealWork(victim);
+    if (object != NULL) return object;
+  }
+
+  return NULL;
+}
+
+static bool anyWorkLeft() {
+  for (int i = 0; i < workerCount; i++) {
+    if (__atomic_load_n(&workers[i].top, __ATOMIC_ACQUIRE) <
+        __atomic_load_n(&workers[i].bottom, __ATOMIC_ACQUIRE)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Marking is over once every worker is idle at the same time, an idle
+// worker has an empty deque and never pushes to it again.
+static void runWorker(MarkWorker* worker) {
+  markWorker = worker;
+
+  for (;;) {
+    Obj* object;
+    while ((object = takeWork(worker)) != NULL) {
+      blackenObject(object);
+    }
+
+    object = stealFromOthers(worker);
+    if (object != NULL) {
+      blackenObject(object);
+      continue;
+    }
+
+    __atomic_add_fetch(&idleCount, 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+      if (__atomic_load_n(&idleCount, __ATOMIC_SEQ_CST) == workerCount) {
+        markWorker = NULL;
+        return;
+      }
+
+      if (anyWorkLeft()) {
+        __atomic_sub_fetch(&idleCount, 1, __ATOMIC_SEQ_CST);
+        break;
+      }
+
+      sched_yield();
+    }
+  }
+}
+
+static void* workerMain(void* argument) {
+  while (!__atomic_load_n(&started, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+
+  runWorker((MarkWorker*)argument);
+  return NULL;
+}
+
+void markInParallel(int threadCount) {
+  workers = (MarkWorker*)malloc(sizeof(MarkWorker) * threadCount);
+  pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * threadCount);
+  if (workers == NULL || threads == NULL) exit(1);
+
+  for (int i = 0; i < threadCount; i++) {
+    workers[i].top = 0;
+    workers[i].bottom = 0;
+    workers[i].buffer = newBuffer(DEQUE_INITIAL);
+    workers[i].seed = 2463534242u + i;
+  }
+
+  idleCount = 0;
+  started = false;
+
+  // The threads wait for 'started', so the worker count and their
+  // deques can still be set up. Marking goes on with fewer threads if
+  // some can't be created.
+  int threadsCreated = 0;
+  for (int i = 1; i < threadCount; i++) {
+    if (pthread_create(&threads[threadsCreated], NULL, workerMain,
+                       &workers[i]) != 0) {
+      break;
+    }
+    threadsCreated++;
+  }
+  workerCount = threadsCreated + 1;
+
+  for (int i = 0; i < vm.grayCount; i++) {
+    markWorkerPush(&workers[i % workerCount], vm.grayStack[i]);
+  }
+  vm.grayCount = 0;
+
+  __atomic_store_n(&started, true, __ATOMIC_RELEASE);
+  runWorker(&workers[0]);
+
+  for (int i = 0; i < threadsCreated; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  for (int i = 0; i < threadCount; i++) {
+    MarkBuffer* buffer = workers[i].buffer;
+    while (buffer != NULL) {
+      MarkBuffer* previous = buffer->previous;
+      free(buffer);
+      buffer = previous;
+    }
+  }
+
+  free(workers);
+  free(threads);
+}
+#endif
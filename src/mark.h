@@ -0,0 +1,22 @@
+#ifndef Pa_mark_h
+#define Pa_mark_h
+
+#include "common.h"
+#include "object.h"
+
+#ifdef PARALLEL_MARK
+typedef struct MarkWorker MarkWorker;
+
+// The worker the current thread marks for, NULL outside of a parallel
+// trace. markObject() hands gray objects to it.
+extern _Thread_local MarkWorker* markWorker;
+
+void markWorkerPush(MarkWorker* worker, Obj* object);
+
+// Blackens everything reachable from the gray stack on 'threadCount'
+// threads, the calling one included. Each thread works off its own
+// deque and steals from the others once it runs dry.
+void markInParallel(int threadCount);
+#endif
+
+#endif
@@ -1,9 +1,11 @@
 //> Chunks of Bytecode memory-c
+#include <limits.h>
 #include <stdlib.h>
 #include <time.h>
 
 #include "compiler.h"
 
+#include "mark.h"
 #include "memory.h"
 #include "vm.h"
 
@@ -14,22 +16,36 @@
 #endif
 
 
-#define GC_HEAP_GROW_FACTOR 2
+static void collectSlice();
+static void startCollection();
+static void checkHeapLimit();
 
-void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
-  vm.bytesAllocated += newSize - oldSize;
-
-  if (newSize > oldSize) {
+// Runs whatever collection work is due before memory is handed out.
+static void collectIfNeeded() {
 #ifdef DEBUG_STRESS_GC
-    collectGarbage();
+  collectYoung();
+  if (vm.gcPhase != GC_IDLE) collectSlice();
 #endif
 //> collect-on-next
 
-    if (vm.bytesAllocated > vm.nextGC) {
-      collectGarbage();
-    }
+  if (vm.gcPhase != GC_IDLE && vm.bytesAllocated > vm.nextGCSlice) {
+    collectSlice();
+  } else if (vm.gcPhase == GC_IDLE && vm.bytesAllocated > vm.nextGC) {
+    startCollection();
+  } else if (vm.bytesAllocated > vm.nextMinorGC) {
+    collectYoung();
+  }
 //< collect-on-next
+
+  if (vm.heapLimit != 0 && vm.bytesAllocated > vm.heapLimit) {
+    checkHeapLimit();
   }
+}
+
+void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
+  vm.bytesAllocated += newSize - oldSize;
+
+  if (newSize > oldSize) collectIfNeeded();
 
 //< Garbage Collection call-collect
   if (newSize == 0) {
@@ -43,11 +59,55 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
 //< out-of-memory
   return result;
 }
+
+static int sweepPage(PoolPage* page);
+
+// Objects are accounted for by their own size, not the size class
+// that holds them, so 'bytesAllocated' stays exact.
+Obj* allocateObjectMemory(size_t size) {
+  vm.bytesAllocated += size;
+  collectIfNeeded();
+
+  // Sweeping is lazy, an unswept page is swept when it is next needed
+  // to allocate from.
+  if (size <= POOL_MAX_SIZE) {
+    int index = POOL_SIZE_CLASS(size);
+    while (vm.pool.available[index] == NULL &&
+           vm.pool.unswept[index] != NULL) {
+      PoolPage* page = vm.pool.unswept[index];
+      sweepPage(page);
+      poolSweptPage(&vm.pool, page);
+    }
+  }
+
+  return poolAllocate(&vm.pool, size);
+}
+
+void freeObjectMemory(size_t size) {
+  vm.bytesAllocated -= size;
+}
+
 //> Garbage Collection mark-object
+// References visited by marking, what an incremental slice is
+// budgeted in.
+static size_t markWork = 0;
+
+// Old objects are already marked, so a minor collection stops at them.
 void markObject(Obj* object) {
+#ifdef PARALLEL_MARK
+  // On a mark thread, the gray object goes to its own deque instead.
+  if (markWorker != NULL) {
+    if (object != NULL && markAtomically(object)) {
+      markWorkerPush(markWorker, object);
+    }
+    return;
+  }
+#endif
+
+  markWork++;
   if (object == NULL) return;
 //> check-is-marked
-  if (object->mark == vm.markVal) return;
+  if (isMarked(object)) return;
 
 #ifdef DEBUG_LOG_GC
   printf("%p mark ", (void*)object);
@@ -55,7 +115,7 @@ void markObject(Obj* object) {
   printf("\n");
 #endif
 
-  object->mark = vm.markVal;
+  setMarked(object);
 
   if (vm.grayCapacity < vm.grayCount + 1) {
     vm.grayCapacity = GROW_CAPACITY(vm.grayCapacity);
@@ -81,7 +141,7 @@ static void markArray(ValueArray* array) {
   }
 }
 
-static void blackenObject(Obj* object) {
+void blackenObject(Obj* object) {
 #ifdef DEBUG_LOG_GC
   printf("%p blacken ", (void*)object);
   printValue(OBJ_VAL(object));
@@ -106,6 +166,13 @@ static void blackenObject(Obj* object) {
       markTable(&klass->methods);
       markTable(&klass->privateMethods);
 //< Methods and Initializers mark-methods
+      for (int i = 0; i < klass->shapeCount; i++) {
+        Shape* shape = klass->shapes[i];
+        markTable(&shape->slots);
+        markTable(&shape->privateSlots);
+        markTable(&shape->transitions);
+        markTable(&shape->privateTransitions);
+      }
       break;
     }
 
@@ -129,6 +196,19 @@ static void blackenObject(Obj* object) {
         markArray(&list->items);
         break;
     }
+
+    case OBJ_MAP: {
+        ObjMap* map = (ObjMap*)object;
+        markValueTable(&map->items);
+        break;
+    }
+
+    case OBJ_SET: {
+        ObjSet* set = (ObjSet*)object;
+        markValueTable(&set->items);
+        break;
+    }
+
 //< blacken-closure
 //> blacken-function
     case OBJ_FUNCTION: {
@@ -143,6 +223,7 @@ static void blackenObject(Obj* object) {
       markObject((Obj*)library->name);
       markTable(&library->values);
       markTable(&library->privateValues);
+      markArray(&library->slots);
       break;
     }
 //< blacken-function
@@ -150,8 +231,9 @@ static void blackenObject(Obj* object) {
     case OBJ_INSTANCE: {
       ObjInstance* instance = (ObjInstance*)object;
       markObject((Obj*)instance->klass);
-      markTable(&instance->fields);
-      markTable(&instance->privateFields);
+      for (int i = 0; i < instance->shape->slotCount; i++) {
+        markValue(instance->fields[i]);
+      }
       break;
     }
 //< Classes and Instances blacken-instance
@@ -162,6 +244,8 @@ static void blackenObject(Obj* object) {
 //< blacken-upvalue
     case OBJ_NATIVE:
     case OBJ_STRING:
+    case OBJ_ARRAY:
+    case OBJ_STRING_BUILDER:
       break;
   }
 }
@@ -174,19 +258,28 @@ static void freeObject(Obj* object) {
 
   switch (object->type) {
     case OBJ_BOUND_METHOD:
-      FREE(ObjBoundMethod, object);
+      FREE_OBJ(ObjBoundMethod, object);
       break;
 
     case OBJ_CLASS: {
       ObjClass* klass = (ObjClass*)object;
       freeTable(&klass->methods);
       freeTable(&klass->privateMethods);
-      FREE(ObjClass, object);
+      for (int i = 0; i < klass->shapeCount; i++) {
+        Shape* shape = klass->shapes[i];
+        freeTable(&shape->slots);
+        freeTable(&shape->privateSlots);
+        freeTable(&shape->transitions);
+        freeTable(&shape->privateTransitions);
+        FREE(Shape, shape);
+      }
+      FREE_ARRAY(Shape*, klass->shapes, klass->shapeCapacity);
+      FREE_OBJ(ObjClass, object);
       break;
     }
 
     case OBJ_FILE: {
-      FREE(ObjFile, object);
+      FREE_OBJ(ObjFile, object);
       break;
     }
 
@@ -195,14 +288,43 @@ static void freeObject(Obj* object) {
       FREE_ARRAY(ObjUpvalue*, closure->upvalues,
                  closure->upvalueCount);
 
-      FREE(ObjClosure, object);
+      FREE_OBJ(ObjClosure, object);
       break;
     }
 
     case OBJ_LIST: {
         ObjList* list = (ObjList*)object;
-        freeValueArray(&list->items);
-        FREE(ObjList, object);
+        freeList(list);
+        FREE_OBJ(ObjList, object);
+        break;
+    }
+
+    case OBJ_MAP: {
+        ObjMap* map = (ObjMap*)object;
+        freeValueTable(&map->items);
+        FREE_OBJ(ObjMap, object);
+        break;
+    }
+
+    case OBJ_SET: {
+        ObjSet* set = (ObjSet*)object;
+        freeValueTable(&set->items);
+        FREE_OBJ(ObjSet, object);
+        break;
+    }
+
+    case OBJ_ARRAY: {
+        ObjArray* array = (ObjArray*)object;
+        FREE_ARRAY(char, array->data,
+                   arrayElementSize(array->kind) * array->count);
+        FREE_OBJ(ObjArray, object);
+        break;
+    }
+
+    case OBJ_STRING_BUILDER: {
+        ObjStringBuilder* builder = (ObjStringBuilder*)object;
+        FREE_ARRAY(char, builder->chars, builder->capacity);
+        FREE_OBJ(ObjStringBuilder, object);
         break;
     }
 
@@ -210,40 +332,39 @@ static void freeObject(Obj* object) {
       ObjLibrary* library = (ObjLibrary*)object;
       freeTable(&library->values);
       freeTable(&library->privateValues);
-      FREE(ObjLibrary, object);
+      freeValueArray(&library->slots);
+      FREE_OBJ(ObjLibrary, object);
       break;
     }
 
     case OBJ_FUNCTION: {
       ObjFunction* function = (ObjFunction*)object;
       freeChunk(&function->chunk);
-      FREE(ObjFunction, object);
+      FREE_OBJ(ObjFunction, object);
       break;
     }
 //< Calls and Functions free-function
 //> Classes and Instances free-instance
     case OBJ_INSTANCE: {
       ObjInstance* instance = (ObjInstance*)object;
-      freeTable(&instance->fields);
-      freeTable(&instance->privateFields);
-      FREE(ObjInstance, object);
+      FREE_ARRAY(Value, instance->fields, instance->fieldCapacity);
+      FREE_OBJ(ObjInstance, object);
       break;
     }
 //< Classes and Instances free-instance
 //> Calls and Functions free-native
     case OBJ_NATIVE:
-      FREE(ObjNative, object);
+      FREE_OBJ(ObjNative, object);
       break;
 //< Calls and Functions free-native
     case OBJ_STRING: {
       ObjString* string = (ObjString*)object;
-      FREE_ARRAY(char, string->chars, string->length + 1);
-      FREE(ObjString, object);
+      freeObjectMemory(STRING_SIZE(string->length));
       break;
     }
 //> Closures free-upvalue
     case OBJ_UPVALUE:
-      FREE(ObjUpvalue, object);
+      FREE_OBJ(ObjUpvalue, object);
       break;
 //< Closures free-upvalue
   }
@@ -269,10 +390,15 @@ static void markRoots() {
   }
 
   markTable(&vm.globals);
+  markArray(&vm.globalValues);
   markTable(&vm.libraries);
 
   //
   markTable(&vm.listNativeMethods);
+  markTable(&vm.mapNativeMethods);
+  markTable(&vm.setNativeMethods);
+  markTable(&vm.arrayNativeMethods);
+  markTable(&vm.builderNativeMethods);
   markTable(&vm.numberNativeMethods);
   markTable(&vm.stringNativeMethods);
   //
@@ -290,71 +416,385 @@ static void traceReferences() {
   }
 }
 
-static void sweep() {
-  Obj* previous = NULL;
-  Obj* object = vm.objects;
-  while (object != NULL) {
-    if (object->mark == vm.markVal) {
-      previous = object;
-      object = object->next;
+// Traces what is left to mark of a major collection, on
+// 'vm.gcMarkThreads' threads when built with PARALLEL_MARK. Minor
+// collections and incremental slices are too short to be worth it.
+static void traceMajor() {
+#ifdef PARALLEL_MARK
+  if (vm.gcMarkThreads > 1 && vm.grayCount > 0) {
+    markInParallel(vm.gcMarkThreads);
+    return;
+  }
+#endif
+
+  traceReferences();
+}
+
+static void recordPause(clock_t start) {
+  double pause = (double)(clock() - start) / CLOCKS_PER_SEC;
+  GCStats* stats = &vm.gcStats;
+
+  stats->totalPause += pause;
+  if (pause > stats->maxPause) stats->maxPause = pause;
+
+  int bucket = 0;
+  double bound = 0.0001;
+  while (bucket < GC_PAUSE_BUCKETS - 1 && pause > bound) {
+    bucket++;
+    bound *= 10;
+  }
+  stats->pauses[bucket]++;
+}
+
+// Frees a dead object, interned strings are unlinked from the intern
+// table first so it never holds a freed key.
+static void freeDeadObject(Obj* object) {
+  if (object->type == OBJ_STRING && ((ObjString*)object)->isInterned) {
+    tableDelete(&vm.strings, (ObjString*)object);
+  }
+  freeObject(object);
+}
+
+// Frees the objects that are allocated but not marked, which only
+// takes a scan of the page's bitmaps. Returns how many were freed.
+static int sweepPage(PoolPage* page) {
+  for (int i = 0; i < POOL_BITMAP_WORDS; i++) {
+    uint64_t dead = page->bits[i].allocated & ~page->bits[i].marked;
+
+    while (dead != 0) {
+      freeDeadObject(CELL_AT(page, i * 64 + lowestBit(dead)));
+      dead &= dead - 1;
+    }
+  }
+
+  return poolReclaimDead(&vm.pool, page);
+}
+
+// Survivors stay marked, which makes them old. Only the pages that were
+// allocated into since the last collection can hold young objects.
+static void sweepYoung() {
+  for (int i = 0; i < vm.pool.youngCount; i++) {
+    PoolPage* page = vm.pool.youngPages[i];
+    sweepPage(page);
+    page->isYoung = false;
+  }
+  vm.pool.youngCount = 0;
+
+  LargeObject* large = vm.pool.youngLarge;
+  while (large != NULL) {
+    LargeObject* next = large->next;
+
+    if (large->isMarked) {
+      large->next = vm.pool.large;
+      vm.pool.large = large;
     } else {
-      Obj* unreached = object;
-      object = object->next;
-      if (previous != NULL) {
-        previous->next = object;
-      } else {
-        vm.objects = object;
-      }
+      freeDeadObject(LARGE_OBJECT(large));
+      free(large);
+    }
+
+    large = next;
+  }
+
+  vm.pool.youngLarge = NULL;
+}
+
+void rememberObject(Obj* object) {
+  if (vm.rememberedCapacity < vm.rememberedCount + 1) {
+    vm.rememberedCapacity = GROW_CAPACITY(vm.rememberedCapacity);
+    vm.remembered = (Obj**)realloc(vm.remembered,
+                                   sizeof(Obj*) * vm.rememberedCapacity);
 
-      freeObject(unreached);
+    if (vm.remembered == NULL) exit(1);
+  }
+
+  object->isRemembered = true;
+  vm.remembered[vm.rememberedCount++] = object;
+}
+
+// Every surviving young object is promoted by either collection, so
+// no old object references a young one afterwards.
+static void forgetRemembered() {
+  for (int i = 0; i < vm.rememberedCount; i++) {
+    vm.remembered[i]->isRemembered = false;
+  }
+  vm.rememberedCount = 0;
+}
+
+//> incremental
+// A major collection runs in slices, one per GC_SLICE_SIZE bytes
+// allocated. Each slice traces about 'vm.gcSliceBudget' references or
+// frees as many objects.
+//
+// GC_MARKING   Every mark was cleared, gray objects are blackened a
+//              slice at a time. New objects start white, writeBarrier()
+//              grays a white object stored into a marked one. Minor
+//              collections wait, the marks don't tell old objects from
+//              young ones meanwhile.
+// GC_SWEEPING  Every page is unswept. Pages are swept a slice at a time,
+//              or when the allocator needs one. Survivors stay marked,
+//              they are all old now.
+static void beginMajor() {
+#ifdef DEBUG_LOG_GC
+  printf("-- gc begin\n");
+#endif
+
+  vm.gcPhase = GC_MARKING;
+  poolClearMarks(&vm.pool);
+  markRoots();
+}
+
+// Returns true once there is nothing gray left.
+static bool markSlice(int budget) {
+  size_t limit = markWork + budget;
+  while (vm.grayCount > 0 && markWork < limit) {
+    Obj* object = vm.grayStack[--vm.grayCount];
+    blackenObject(object);
+  }
+
+  return vm.grayCount == 0;
+}
+
+// The roots aren't behind the barrier, they are scanned once more with
+// the mutator stopped. That only traces what was reached from them
+// since the cycle began.
+static void finishMarking() {
+  markRoots();
+  traceMajor();
+
+  forgetRemembered();
+  poolStartSweep(&vm.pool);
+
+  vm.gcPhase = GC_SWEEPING;
+}
+
+static void finishSweeping() {
+  vm.gcPhase = GC_IDLE;
+  poolReleaseEmpty(&vm.pool);
+  vm.gcStats.collections++;
+
+  vm.nextGC = (size_t)(vm.bytesAllocated * vm.gcGrowFactor) + GC_NURSERY_SIZE;
+  vm.nextMinorGC = vm.bytesAllocated + GC_NURSERY_SIZE;
+
+#ifdef DEBUG_LOG_GC
+  printf("-- gc end\n");
+  printf("   %zu bytes left, next at %zu\n", vm.bytesAllocated, vm.nextGC);
+#endif
+}
+
+// Returns true once every page and large object has been swept. Minor
+// collections may promote large objects meanwhile, they are marked and
+// survive.
+static bool sweepSlice(int budget) {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    while (vm.pool.unswept[i] != NULL) {
+      if (budget <= 0) return false;
+
+      PoolPage* page = vm.pool.unswept[i];
+      budget -= sweepPage(page) + 1;
+      poolSweptPage(&vm.pool, page);
     }
   }
+
+  while (*vm.pool.largeSweep != NULL) {
+    if (budget-- <= 0) return false;
+
+    LargeObject* large = *vm.pool.largeSweep;
+    if (large->isMarked) {
+      vm.pool.largeSweep = &large->next;
+    } else {
+      *vm.pool.largeSweep = large->next;
+      freeDeadObject(LARGE_OBJECT(large));
+      free(large);
+    }
+  }
+
+  return true;
+}
+
+// Does one slice of the running major collection.
+static void collectSlice() {
+  clock_t start = clock();
+  int budget = vm.gcSliceBudget;
+
+  if (vm.gcPhase == GC_MARKING) {
+    if (markSlice(budget)) finishMarking();
+  } else if (sweepSlice(budget)) {
+    finishSweeping();
+  }
+
+  vm.nextGCSlice = vm.bytesAllocated + GC_SLICE_SIZE;
+  vm.gcStats.slices++;
+  recordPause(start);
 }
 
+// A budget of 0 turns the incremental mode off.
+static void startCollection() {
+  if (vm.gcSliceBudget <= 0) {
+    collectGarbage();
+    return;
+  }
+
+  beginMajor();
+  vm.nextGCSlice = vm.bytesAllocated + GC_SLICE_SIZE;
+}
+//< incremental
+
+// Runs a whole major collection, or the rest of the one in progress.
 void collectGarbage() {
 //> log-before-collect
 #ifdef DEBUG_LOG_GC
-  printf("-- gc begin\n");
   double start = (double)clock() / CLOCKS_PER_SEC;
   size_t before = vm.bytesAllocated;
 #endif
 //< log-before-collect
 //> call-mark-roots
+  clock_t pauseStart = clock();
 
-  markRoots();
-
-  traceReferences();
-
-  tableRemoveWhite(&vm.strings);
+  if (vm.gcPhase == GC_IDLE) beginMajor();
 
-  sweep();
-
-  vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+  if (vm.gcPhase == GC_MARKING) {
+    traceMajor();
+    finishMarking();
+  }
 
-  vm.markVal = !vm.markVal;
+  sweepSlice(INT_MAX);
+  finishSweeping();
+  recordPause(pauseStart);
 
 #ifdef DEBUG_LOG_GC
   double took = ((double)clock() / CLOCKS_PER_SEC) - start;
-  printf("-- gc end\n");
-  printf("   collected %zu bytes (from %zu to %zu) next at %zu (took %.3fms)\n",
+  printf("   collected %zu bytes (from %zu to %zu) (took %.3fms)\n",
         before - vm.bytesAllocated, before, vm.bytesAllocated,
-        vm.nextGC,
         took * 1000.0);
+#endif
+
+}
+
+// Only traces and sweeps the objects allocated since the last
+// collection. Old objects are assumed to be alive, the remembered set
+// stands in for the old objects that point into the young generation.
+void collectYoung() {
+  if (vm.gcPhase == GC_MARKING) return;
+
+#ifdef DEBUG_LOG_GC
+  printf("-- minor gc begin\n");
+  size_t before = vm.bytesAllocated;
+#endif
+  clock_t start = clock();
 
+  markRoots();
+  for (int i = 0; i < vm.rememberedCount; i++) {
+    blackenObject(vm.remembered[i]);
+  }
+
+  traceReferences();
+
+  forgetRemembered();
+
+  sweepYoung();
+
+  vm.nextMinorGC = vm.bytesAllocated + GC_NURSERY_SIZE;
+  vm.gcStats.minorCollections++;
+  recordPause(start);
+
+#ifdef DEBUG_LOG_GC
+  printf("-- minor gc end\n");
+  printf("   collected %zu bytes (from %zu to %zu)\n",
+        before - vm.bytesAllocated, before, vm.bytesAllocated);
 #endif
+}
 
+// A program that outgrows the limit can't be given the memory, and the
+// allocator has no way back into the interpreter loop. The error is
+// reported the same, and ends the program the way any runtime error
+// does.
+static void checkHeapLimit() {
+  collectGarbage();
+  if (vm.bytesAllocated <= vm.heapLimit) return;
+
+  runtimeError("Out of memory, the heap is limited to %zu bytes.",
+               vm.heapLimit);
+  exit(70);
+}
+
+static void countPageObjects(PoolPage* page, size_t counts[],
+                             size_t bytes[]) {
+  for (; page != NULL; page = page->next) {
+    // Unmarked objects on an unswept page are dead already.
+    bool skipDead = page->state == PAGE_UNSWEPT;
+
+    for (int i = 0; i < POOL_BITMAP_WORDS; i++) {
+      uint64_t live = page->bits[i].allocated;
+      if (skipDead) live &= page->bits[i].marked;
+
+      while (live != 0) {
+        Obj* object = CELL_AT(page, i * 64 + lowestBit(live));
+        counts[object->type]++;
+        bytes[object->type] += page->cellSize;
+        live &= live - 1;
+      }
+    }
+  }
+}
+
+void heapCensus(size_t counts[OBJ_TYPE_COUNT], size_t bytes[OBJ_TYPE_COUNT]) {
+  for (int i = 0; i < OBJ_TYPE_COUNT; i++) {
+    counts[i] = 0;
+    bytes[i] = 0;
+  }
+
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    countPageObjects(vm.pool.available[i], counts, bytes);
+    countPageObjects(vm.pool.full[i], counts, bytes);
+    countPageObjects(vm.pool.unswept[i], counts, bytes);
+  }
+
+  // Large objects left unmarked by the sweep are dead as well, young
+  // ones are on their own list.
+  bool sweeping = vm.gcPhase == GC_SWEEPING;
+  LargeObject* lists[] = {vm.pool.large, vm.pool.youngLarge};
+  for (int i = 0; i < 2; i++) {
+    for (LargeObject* large = lists[i]; large != NULL; large = large->next) {
+      if (i == 0 && sweeping && !large->isMarked) continue;
+
+      Obj* object = LARGE_OBJECT(large);
+      counts[object->type]++;
+      bytes[object->type] += large->size;
+    }
+  }
+}
+
+static void freePageObjects(PoolPage* page) {
+  for (; page != NULL; page = page->next) {
+    for (int i = 0; i < POOL_BITMAP_WORDS; i++) {
+      uint64_t allocated = page->bits[i].allocated;
+
+      while (allocated != 0) {
+        freeObject(CELL_AT(page, i * 64 + lowestBit(allocated)));
+        allocated &= allocated - 1;
+      }
+    }
+  }
 }
 
 void freeObjects() {
-  Obj* object = vm.objects;
-  while (object != NULL) {
-    Obj* next = object->next;
-    freeObject(object);
-    object = next;
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    freePageObjects(vm.pool.available[i]);
+    freePageObjects(vm.pool.full[i]);
+    freePageObjects(vm.pool.unswept[i]);
+  }
+
+  LargeObject* lists[] = {vm.pool.large, vm.pool.youngLarge};
+  for (int i = 0; i < 2; i++) {
+    for (LargeObject* large = lists[i]; large != NULL; large = large->next) {
+      freeObject(LARGE_OBJECT(large));
+    }
   }
 //> Garbage Collection free-gray-stack
 
   free(vm.grayStack);
+  free(vm.remembered);
+  freePool(&vm.pool);
 //< Garbage Collection free-gray-stack
 }
 //< Strings free-objects
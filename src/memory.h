@@ -6,6 +6,7 @@
 //> Strings memory-include-object
 #include "object.h"
 //< Strings memory-include-object
+#include "vm.h"
 
 //> Strings allocate
 #define ALLOCATE(type, count) \
@@ -15,12 +16,42 @@
 #define FREE(type, pointer) reallocate(pointer, sizeof(type), 0)
 //< free
 
+// Objects live in the pool, see pool.h. Their memory is reclaimed by
+// the sweep that finds them dead, freeing one only accounts for it.
+#define FREE_OBJ(type, pointer) freeObjectMemory(sizeof(type))
+
 //< Strings allocate
+// The heap may grow to this many times what a major collection leaves
+// before the next one starts, the first starts at GC_INITIAL_THRESHOLD.
+// Both can be changed from the Gc library.
+#define GC_HEAP_GROW_FACTOR 2
+#define GC_INITIAL_THRESHOLD (1024 * 1024)
+
+// Bytes allocated between two minor collections.
+#define GC_NURSERY_SIZE (1024 * 1024)
+
+// Bytes allocated between two slices of an incremental major
+// collection, and the references traced or objects swept by a slice.
+#define GC_SLICE_SIZE (64 * 1024)
+#define GC_SLICE_BUDGET 20000
+
+// Threads that trace a major collection, builds without PARALLEL_MARK
+// only ever use the one. Incremental slices are always traced on the
+// VM's thread, set 'vm.gcSliceBudget' to 0 for the threads to see all
+// of the work.
+#ifndef GC_MARK_THREADS
+#ifdef PARALLEL_MARK
+#define GC_MARK_THREADS 4
+#else
+#define GC_MARK_THREADS 1
+#endif
+#endif
+
 #define GROW_CAPACITY(capacity) \
     ((capacity) < 8 ? 8 : (capacity) * 2)
 
 #define SHRINK_CAPACITY(capacity) \
-    ((capacity) > 8 ? 8 : (capacity) / 2)
+    ((capacity) / 2 < 8 ? 8 : (capacity) / 2)
 
 #define GROW_ARRAY(type, pointer, oldCount, newCount) \
     (type*)reallocate(pointer, sizeof(type) * (oldCount), \
@@ -32,16 +63,44 @@
 //< free-array
 
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
+Obj* allocateObjectMemory(size_t size);
+void freeObjectMemory(size_t size);
 //< grow-array
 //> Garbage Collection mark-object-h
 void markObject(Obj* object);
 //< Garbage Collection mark-object-h
 //> Garbage Collection mark-value-h
 void markValue(Value value);
+void blackenObject(Obj* object);
 //< Garbage Collection mark-value-h
 //> Garbage Collection collect-garbage-h
 void collectGarbage();
 //< Garbage Collection collect-garbage-h
+void collectYoung();
+void rememberObject(Obj* object);
+
+// Counts the live objects of each type, and the heap bytes they take
+// without the arrays they own. Garbage that no collection has found
+// yet counts as live.
+void heapCensus(size_t counts[OBJ_TYPE_COUNT], size_t bytes[OBJ_TYPE_COUNT]);
+
+// Must follow every store of a reference into an existing object.
+// Minor collections don't trace old objects, so an old one that now
+// holds a young object goes into the remembered set, old objects being
+// the marked ones. While a major collection is marking, a white object
+// stored into a marked one is grayed so it can't be missed.
+static inline void writeBarrier(Obj* owner, Value value) {
+  if (!IS_OBJ(value)) return;
+  Obj* object = AS_OBJ(value);
+
+  if (!isMarked(owner) || isMarked(object)) return;
+
+  if (vm.gcPhase == GC_MARKING) {
+    markObject(object);
+  } else if (!owner->isRemembered) {
+    rememberObject(owner);
+  }
+}
 //> Strings free-objects-h
 void freeObjects();
 //< Strings free-objects-h
@@ -4,6 +4,7 @@
 
 #include "value.h"
 #include "natives.h"
+#include "object.h"
 #include "vm.h"
 #include "memory.h"
 
@@ -74,7 +75,7 @@ static Value inputNative(int argCount, Value *args) {
 
     line[length] = '\0';
 
-    return OBJ_VAL(takeString(line, length));
+    return OBJ_VAL(takeRuntimeString(line, length));
 }
 
 static Value typeNative(int argCount, Value *args) {
@@ -154,9 +155,107 @@ static Value toStringNative(int argCount, Value *args) {
     }
 
     char* c = stringValue(args[0]);
-    return OBJ_VAL(takeString(c, strlen(c)));
+    return OBJ_VAL(takeRuntimeString(c, strlen(c)));
 }
 
+// set() or set(list), the set is sized for the whole list up front.
+static Value setNative(int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError("Expected 0 or 1 arguments but got %d from 'set()'.", argCount);
+        return NOTCLEAR;
+    }
+
+    if (argCount == 1 && !IS_LIST(args[0])) {
+        runtimeError("Argument must be a list from 'set()'.");
+        return NOTCLEAR;
+    }
+
+    ObjSet* set = newSet();
+    if (argCount == 0) return OBJ_VAL(set);
+
+    push(OBJ_VAL(set));
+    ObjList* list = AS_LIST(args[0]);
+    valueTableReserve(&set->items, list->items.count);
+
+    for (int i = 0; i < list->items.count; i++) {
+        Value item = list->items.values[i];
+
+        if (!isHashable(item)) {
+            runtimeError("Type '%s' can not be in a set from 'set()'.", typeValue(item));
+            return NOTCLEAR;
+        }
+
+        setAdd(set, item);
+    }
+
+    pop();
+    return OBJ_VAL(set);
+}
+
+// Typed arrays are built zeroed from a length, or from a list of
+// numbers in one pass.
+static Value arrayNative(ArrayKind kind, int argCount, Value *args, const char* name) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d from '%s()'.", argCount, name);
+        return NOTCLEAR;
+    }
+
+    if (IS_NUMBER(args[0])) {
+        double length = AS_NUMBER(args[0]);
+        if (length < 0 || length > INT32_MAX || length != (int)length) {
+            runtimeError("Length must be a whole number from '%s()'.", name);
+            return NOTCLEAR;
+        }
+
+        return OBJ_VAL(newArray(kind, (int)length));
+    }
+
+    if (!IS_LIST(args[0])) {
+        runtimeError("Argument must be a length or a list from '%s()'.", name);
+        return NOTCLEAR;
+    }
+
+    ObjList* list = AS_LIST(args[0]);
+    ObjArray* array = newArray(kind, list->items.count);
+
+    for (int i = 0; i < list->items.count; i++) {
+        Value item = list->items.values[i];
+
+        if (!IS_NUMBER(item)) {
+            runtimeError("Type '%s' can not be in an array from '%s()'.", typeValue(item), name);
+            return NOTCLEAR;
+        }
+
+        storeToArray(array, i, AS_NUMBER(item));
+    }
+
+    return OBJ_VAL(array);
+}
+
+static Value floatArrayNative(int argCount, Value *args) {
+    return arrayNative(ARRAY_FLOAT64, argCount, args, "floatArray");
+}
+
+static Value intArrayNative(int argCount, Value *args) {
+    return arrayNative(ARRAY_INT32, argCount, args, "intArray");
+}
+
+static Value byteArrayNative(int argCount, Value *args) {
+    return arrayNative(ARRAY_UINT8, argCount, args, "byteArray");
+}
+
+// stringBuilder() or stringBuilder(value...), starting with the values.
+static Value stringBuilderNative(int argCount, Value *args) {
+    ObjStringBuilder* builder = newStringBuilder();
+    push(OBJ_VAL(builder));
+
+    for (int i = 0; i < argCount; i++) {
+        builderAppendValue(builder, args[i]);
+    }
+
+    pop();
+    return OBJ_VAL(builder);
+}
 
 ///////////////////
 
@@ -167,6 +266,11 @@ void defineAllNatives() {
         "type",
         "toString",
         "isInstance",
+        "set",
+        "floatArray",
+        "intArray",
+        "byteArray",
+        "stringBuilder",
     };
 
     NativeFn nativeFunctions[] = {
@@ -175,9 +279,14 @@ void defineAllNatives() {
         typeNative,
         toStringNative,
         isInstanceNative,
+        setNative,
+        floatArrayNative,
+        intArrayNative,
+        byteArrayNative,
+        stringBuilderNative,
     };
 
     for (uint8_t i = 0; i < sizeof(nativeStrings) / sizeof(nativeStrings[0]); i++) {
-        defineNative(nativeStrings[i], nativeFunctions[i], &vm.globals);
+        defineGlobalNative(nativeStrings[i], nativeFunctions[i]);
     }
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #ifndef Pa_natives_h
 #define Pa_natives_h
 
-#define NOTCLEAR NIL_VAL
+// Natives return this once they reported an error. It is the empty
+// value, which no script can hold, so none is an ordinary result.
+#define NOTCLEAR EMPTY_VAL
 #define CLEAR NUMBER_VAL(0)
 
 //meh
@@ -18,16 +18,9 @@
 
 
 static Obj* allocateObject(size_t size, ObjType type) {
-  Obj* object = (Obj*)reallocate(NULL, 0, size);
+  Obj* object = allocateObjectMemory(size);
   object->type = type;
-//> Garbage Collection init-is-marked
-  object->mark = !vm.markVal;
-//< Garbage Collection init-is-marked
-//> add-to-list
-  
-  object->next = vm.objects;
-  vm.objects = object;
-//< add-to-list
+  object->isRemembered = false;
 //> Garbage Collection debug-log-allocate
 
 #ifdef DEBUG_LOG_GC
@@ -46,11 +39,42 @@ ObjBoundMethod* newBoundMethod(Value receiver, ObjClosure* method) {
 }
 //< Methods and Initializers new-bound-method
 //> Classes and Instances new-class
+static uint32_t shapeIds = 0;
+
+static Shape* addShape(ObjClass* klass) {
+  if (klass->shapeCapacity < klass->shapeCount + 1) {
+    int oldCapacity = klass->shapeCapacity;
+    klass->shapeCapacity = GROW_CAPACITY(oldCapacity);
+    klass->shapes = GROW_ARRAY(Shape*, klass->shapes,
+        oldCapacity, klass->shapeCapacity);
+  }
+
+  Shape* shape = ALLOCATE(Shape, 1);
+  shape->id = ++shapeIds;
+  shape->slotCount = 0;
+  initTable(&shape->slots);
+  initTable(&shape->privateSlots);
+  initTable(&shape->transitions);
+  initTable(&shape->privateTransitions);
+
+  klass->shapes[klass->shapeCount++] = shape;
+  return shape;
+}
+
 ObjClass* newClass(ObjString* name) {
   ObjClass* klass = ALLOCATE_OBJ(ObjClass, OBJ_CLASS);
   klass->name = name;
   initTable(&klass->methods);
   initTable(&klass->privateMethods);
+
+  klass->shapes = NULL;
+  klass->shapeCount = 0;
+  klass->shapeCapacity = 0;
+  klass->maxSlotCount = 0;
+
+  push(OBJ_VAL(klass));
+  addShape(klass);
+  pop();
   return klass;
 }
 
@@ -81,6 +105,7 @@ ObjLibrary* newLibrary(ObjString* name) {
   ObjLibrary* library = ALLOCATE_OBJ(ObjLibrary, OBJ_LIBRARY);
   initTable(&library->values);
   initTable(&library->privateValues);
+  initValueArray(&library->slots);
   library->name = name;
 
 
@@ -88,7 +113,7 @@ ObjLibrary* newLibrary(ObjString* name) {
   push(OBJ_VAL(library));
   ObjString* __name__ = copyString("__name__", 8); 
   push(OBJ_VAL(__name__));
-  tableSet(&library->values, __name__, OBJ_VAL(name));
+  librarySet(library, __name__, OBJ_VAL(name));
   //
 
   tableSet(&vm.libraries, name, OBJ_VAL(library));
@@ -98,10 +123,58 @@ ObjLibrary* newLibrary(ObjString* name) {
   return library;
 }
 
+// Returns the slot of 'name', adding an unassigned one if needed.
+// 'name' must be reachable, this may allocate.
+int librarySlot(ObjLibrary* library, ObjString* name, bool isPrivate) {
+  Table* names = isPrivate ? &library->privateValues : &library->values;
+  Value slot;
+  if (tableGet(names, name, &slot)) {
+    return (int)AS_NUMBER(slot);
+  }
+
+  writeValueArray(&library->slots, EMPTY_VAL);
+  tableSet(names, name, NUMBER_VAL(library->slots.count - 1));
+  writeBarrier((Obj*)library, OBJ_VAL(name));
+  return library->slots.count - 1;
+}
+
+// Only used for error messages.
+ObjString* librarySlotName(ObjLibrary* library, int slot) {
+  Table* tables[] = {&library->values, &library->privateValues};
+
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < tables[i]->capacity; j++) {
+      Entry* entry = &tables[i]->entries[j];
+      if (entry->key != NULL && AS_NUMBER(entry->value) == slot) {
+        return entry->key;
+      }
+    }
+  }
+
+  return library->name;
+}
+
+bool libraryGet(ObjLibrary* library, ObjString* name, Value* value) {
+  Value slot;
+  if (!tableGet(&library->values, name, &slot)) return false;
+
+  *value = library->slots.values[(int)AS_NUMBER(slot)];
+  return !IS_EMPTY(*value);
+}
+
+void librarySet(ObjLibrary* library, ObjString* name, Value value) {
+  push(value);
+  int slot = librarySlot(library, name, false);
+  library->slots.values[slot] = value;
+  writeBarrier((Obj*)library, value);
+  pop();
+}
+
 ObjFunction* newFunction(ObjLibrary* library, FunctionType type) {
   ObjFunction* function = ALLOCATE_OBJ(ObjFunction, OBJ_FUNCTION);
   function->arity = 0;
   function->upvalueCount = 0;
+  function->maxStack = 0;
 
   function->library = library;
   function->type = type;
@@ -115,11 +188,90 @@ ObjFunction* newFunction(ObjLibrary* library, FunctionType type) {
 ObjInstance* newInstance(ObjClass* klass) {
   ObjInstance* instance = ALLOCATE_OBJ(ObjInstance, OBJ_INSTANCE);
   instance->klass = klass;
-  initTable(&instance->fields);
-  initTable(&instance->privateFields);
+  instance->shape = klass->shapes[0];
+  instance->fields = NULL;
+  instance->fieldCapacity = 0;
+
+  if (klass->maxSlotCount > 0) {
+    push(OBJ_VAL(instance));
+    instance->fields = ALLOCATE(Value, klass->maxSlotCount);
+    instance->fieldCapacity = klass->maxSlotCount;
+    pop();
+  }
+
   return instance;
 }
 
+int shapeFindSlot(Shape* shape, ObjString* name, bool isPrivate) {
+  Value slot;
+  if (!tableGet(isPrivate ? &shape->privateSlots : &shape->slots, name, &slot)) {
+    return -1;
+  }
+
+  return (int)AS_NUMBER(slot);
+}
+
+Shape* shapeTransition(ObjClass* klass, Shape* shape, ObjString* name, bool isPrivate) {
+  Table* transitions = isPrivate ? &shape->privateTransitions : &shape->transitions;
+  Value index;
+  if (tableGet(transitions, name, &index)) {
+    return klass->shapes[(int)AS_NUMBER(index)];
+  }
+
+  // Registered before filling it in, so a collection triggered
+  // while copying the tables still sees the new shape.
+  int nextIndex = klass->shapeCount;
+  Shape* next = addShape(klass);
+  tableAddAll(&shape->slots, &next->slots);
+  tableAddAll(&shape->privateSlots, &next->privateSlots);
+
+  next->slotCount = shape->slotCount + 1;
+  if (next->slotCount > klass->maxSlotCount) {
+    klass->maxSlotCount = next->slotCount;
+  }
+  tableSet(isPrivate ? &next->privateSlots : &next->slots, name, NUMBER_VAL(shape->slotCount));
+
+  tableSet(transitions, name, NUMBER_VAL(nextIndex));
+  writeBarrier((Obj*)klass, OBJ_VAL(name));
+  return next;
+}
+
+void reserveInstanceFields(ObjInstance* instance, int count) {
+  if (instance->fieldCapacity >= count) return;
+
+  int oldCapacity = instance->fieldCapacity;
+  int capacity = instance->klass->maxSlotCount;
+  if (capacity < count) capacity = count;
+
+  instance->fields = GROW_ARRAY(Value, instance->fields, oldCapacity, capacity);
+  instance->fieldCapacity = capacity;
+}
+
+bool instanceGetField(ObjInstance* instance, ObjString* name, bool isPrivate, Value* value) {
+  int slot = shapeFindSlot(instance->shape, name, isPrivate);
+  if (slot == -1) return false;
+
+  *value = instance->fields[slot];
+  return true;
+}
+
+// Returns the slot the value was stored in.
+// The instance and value must be reachable, this may allocate.
+int instanceSetField(ObjInstance* instance, ObjString* name, bool isPrivate, Value value) {
+  int slot = shapeFindSlot(instance->shape, name, isPrivate);
+  if (slot == -1) {
+    Shape* next = shapeTransition(instance->klass, instance->shape, name, isPrivate);
+    reserveInstanceFields(instance, next->slotCount);
+
+    slot = instance->shape->slotCount;
+    instance->shape = next;
+  }
+
+  instance->fields[slot] = value;
+  writeBarrier((Obj*)instance, value);
+  return slot;
+}
+
 ObjNative* newNative(NativeFn function) {
   ObjNative* native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
   native->function = function;
@@ -133,11 +285,151 @@ ObjFile* newFile() {
 ObjList* newList() {
   ObjList* list = ALLOCATE_OBJ(ObjList, OBJ_LIST);
   initValueArray(&list->items);
+  list->front = 0;
   return list;
 }
 
+// Sized once for lists whose length is known up front.
+ObjList* newListWithCapacity(int capacity) {
+  ObjList* list = newList();
+
+  if (capacity > 0) {
+    push(OBJ_VAL(list));
+    reserveList(list, capacity);
+    pop();
+  }
+
+  return list;
+}
+
+// The storage block starts 'front' slots before the first item, and
+// 'capacity' counts from the first item to its end.
+static inline Value* listBlock(ObjList* list) {
+  return list->items.values - list->front;
+}
+
+static inline int listBlockSize(ObjList* list) {
+  return list->front + list->items.capacity;
+}
+
+// Moves the items to a new block with the given room at each side.
+// May collect, the items are still reachable from the old block then.
+static void relocateList(ObjList* list, int front, int capacity) {
+  if (list->front == 0 && front == 0) {
+    list->items.values = GROW_ARRAY(Value, list->items.values,
+                                    list->items.capacity, capacity);
+    list->items.capacity = capacity;
+    return;
+  }
+
+  Value* block = GROW_ARRAY(Value, NULL, 0, front + capacity);
+  memcpy(block + front, list->items.values, sizeof(Value) * list->items.count);
+  FREE_ARRAY(Value, listBlock(list), listBlockSize(list));
+
+  list->items.values = block + front;
+  list->items.capacity = capacity;
+  list->front = front;
+}
+
+// Slides the items down to the start of the block, so the whole block
+// is back room. Never allocates.
+static void slideListDown(ObjList* list) {
+  if (list->front == 0) return;
+
+  Value* block = listBlock(list);
+  memmove(block, list->items.values, sizeof(Value) * list->items.count);
+  list->items.values = block;
+  list->items.capacity += list->front;
+  list->front = 0;
+}
+
+static void growListBack(ObjList* list, int needed) {
+  int count = list->items.count;
+  if (count + needed <= list->items.capacity) return;
+
+  // Used as a queue the items drift toward the back, slide them down
+  // rather than grow while at least half of the block is free in front.
+  int size = listBlockSize(list);
+  if (count + needed <= size && list->front >= size / 2) {
+    slideListDown(list);
+    return;
+  }
+
+  int capacity = GROW_CAPACITY(list->items.capacity);
+  if (capacity < count + needed) capacity = count + needed;
+  relocateList(list, 0, capacity);
+}
+
+// The new room in front grows with the list, so filling a list from
+// the front relocates it only a logarithmic number of times.
+static void growListFront(ObjList* list, int needed) {
+  if (list->front >= needed) return;
+
+  int front = list->items.count < 8 ? 8 : list->items.count;
+  if (front < needed) front = needed;
+  relocateList(list, front, list->items.count);
+}
+
+// Halves once it is a quarter full, so a list that grows and shrinks
+// around one size doesn't reallocate every time. Never collects.
+static void shrinkListIfSparse(ObjList* list) {
+  int size = listBlockSize(list);
+  if (size <= 8 || list->items.count > size / 4) return;
+
+  slideListDown(list);
+
+  int shrunk = SHRINK_CAPACITY(size);
+  list->items.values = GROW_ARRAY(Value, list->items.values, size, shrunk);
+  list->items.capacity = shrunk;
+}
+
 void appendToList(ObjList* list, Value value) {
-  writeValueArray(&list->items, value);
+  growListBack(list, 1);
+
+  list->items.values[list->items.count++] = value;
+  writeBarrier((Obj*)list, value);
+}
+
+// Room for at least 'capacity' items from the first one, never
+// shrinks. May collect, so whatever is about to be stored has to be
+// reachable already.
+void reserveList(ObjList* list, int capacity) {
+  if (capacity <= list->items.capacity) return;
+
+  relocateList(list, 0, capacity);
+}
+
+// Gives back the unused room at both ends, shrinking never collects.
+void shrinkList(ObjList* list) {
+  if (listBlockSize(list) == list->items.count) return;
+
+  int size = listBlockSize(list);
+  slideListDown(list);
+
+  list->items.values = GROW_ARRAY(Value, list->items.values,
+                                  size, list->items.count);
+  list->items.capacity = list->items.count;
+}
+
+void freeList(ObjList* list) {
+  FREE_ARRAY(Value, listBlock(list), listBlockSize(list));
+  initValueArray(&list->items);
+  list->front = 0;
+}
+
+// 'values' must not be this list's own storage, which may move.
+void appendValuesToList(ObjList* list, Value* values, int count) {
+  if (count <= 0) return;
+
+  growListBack(list, count);
+
+  Value* to = &list->items.values[list->items.count];
+  memcpy(to, values, sizeof(Value) * count);
+  list->items.count += count;
+
+  for (int i = 0; i < count; i++) {
+    writeBarrier((Obj*)list, to[i]);
+  }
 }
 
 Value indexFromList(ObjList* list, int index) {
@@ -154,6 +446,7 @@ void storeToList(ObjList* list, int index, Value value) {
   }
 
   list->items.values[index] = value;
+  writeBarrier((Obj*)list, value);
 }
 
 bool isValidListIndex(ObjList* list, int index) {
@@ -167,28 +460,268 @@ bool isValidListIndex(ObjList* list, int index) {
   return false;
 }
 
+// 'index' goes from 0, the first item, up to the count for appending.
+// The items on the shorter side are the ones moved. May collect, the
+// value has to be reachable already.
+void insertIntoList(ObjList* list, int index, Value value) {
+  int count = list->items.count;
+
+  if (index < count / 2) {
+    growListFront(list, 1);
+
+    list->items.values--;
+    list->items.capacity++;
+    list->front--;
+    memmove(list->items.values, list->items.values + 1, sizeof(Value) * index);
+  } else {
+    growListBack(list, 1);
+
+    memmove(list->items.values + index + 1, list->items.values + index,
+            sizeof(Value) * (count - index));
+  }
+
+  list->items.values[index] = value;
+  list->items.count++;
+  writeBarrier((Obj*)list, value);
+}
+
+// Takes out the item at 'index', moving the items on the shorter side.
+// The front is dropped in place, so using a list as a queue is cheap.
 void deleteFromList(ObjList* list, int index) {
-  for (int i = index; i < list->items.count - 1; i++) {
-    list->items.values[i] = list->items.values[i + 1];
+  if (index < 0) {
+    index = list->items.count + index;
+  }
+
+  int count = list->items.count;
+  if (index < count / 2) {
+    memmove(list->items.values + 1, list->items.values, sizeof(Value) * index);
+
+    list->items.values++;
+    list->items.capacity--;
+    list->front++;
+  } else {
+    memmove(list->items.values + index, list->items.values + index + 1,
+            sizeof(Value) * (count - index - 1));
   }
 
   list->items.count--;
+  shrinkListIfSparse(list);
+}
+
+// Moves every item 'steps' places toward the back, the last ones coming
+// around to the front, or toward the front for negative steps. The
+// shorter way round copies just those items into the room at one end.
+void rotateList(ObjList* list, int steps) {
+  int count = list->items.count;
+  if (count < 2) return;
+
+  steps %= count;
+  if (steps < 0) steps += count;
+  if (steps == 0) return;
+
+  if (steps <= count / 2) {
+    growListFront(list, steps);
+
+    memcpy(list->items.values - steps, list->items.values + count - steps,
+           sizeof(Value) * steps);
+    list->items.values -= steps;
+    list->items.capacity += steps;
+    list->front -= steps;
+  } else {
+    int back = count - steps;
+    growListBack(list, back);
+
+    memcpy(list->items.values + count, list->items.values, sizeof(Value) * back);
+    list->items.values += back;
+    list->items.capacity -= back;
+    list->front += back;
+  }
 }
 
 void clearList(ObjList* list) {
-  const int count = list->items.count;
+  list->items.count = 0;
+  slideListDown(list);
+}
 
-  for (int i = 0; i < count; i++) {
-    deleteFromList(list, i);
+ObjMap* newMap() {
+  ObjMap* map = ALLOCATE_OBJ(ObjMap, OBJ_MAP);
+  initValueTable(&map->items);
+  return map;
+}
+
+bool mapGet(ObjMap* map, Value key, Value* value) {
+  return valueTableGet(&map->items, key, value);
+}
+
+// Keys are interned, so the table compares strings by identity. The
+// interned one may only be reachable from the weak intern table, so
+// it stays on the stack while the table grows.
+static Value internKey(Value key) {
+  if (!IS_STRING(key)) return key;
+  return OBJ_VAL(internString(AS_STRING(key)));
+}
+
+void mapSet(ObjMap* map, Value key, Value value) {
+  key = internKey(key);
+  push(key);
+  valueTableSet(&map->items, key, value);
+  pop();
+  writeBarrier((Obj*)map, key);
+  writeBarrier((Obj*)map, value);
+}
+
+bool mapDelete(ObjMap* map, Value key) {
+  return valueTableDelete(&map->items, key);
+}
+
+ObjSet* newSet() {
+  ObjSet* set = ALLOCATE_OBJ(ObjSet, OBJ_SET);
+  initValueTable(&set->items);
+  return set;
+}
+
+void setAdd(ObjSet* set, Value value) {
+  value = internKey(value);
+  push(value);
+  valueTableSet(&set->items, value, TRUE_VAL);
+  pop();
+  writeBarrier((Obj*)set, value);
+}
+
+bool setHas(ObjSet* set, Value value) {
+  Value unused;
+  return valueTableGet(&set->items, value, &unused);
+}
+
+bool setRemove(ObjSet* set, Value value) {
+  return valueTableDelete(&set->items, value);
+}
+
+size_t arrayElementSize(ArrayKind kind) {
+  switch (kind) {
+    case ARRAY_FLOAT64: return sizeof(double);
+    case ARRAY_INT32: return sizeof(int32_t);
+    case ARRAY_UINT8: return sizeof(uint8_t);
   }
+
+  return 0; // Unreachable.
 }
 
-static ObjString* allocateString(char* chars, int length, uint32_t hash) {
-//< Hash Tables allocate-string
-  ObjString* string = ALLOCATE_OBJ(ObjString, OBJ_STRING);
+ObjArray* newArray(ArrayKind kind, int count) {
+  ObjArray* array = ALLOCATE_OBJ(ObjArray, OBJ_ARRAY);
+  array->kind = kind;
+  array->count = 0;
+  array->data = NULL;
+
+  push(OBJ_VAL(array));
+  if (count > 0) {
+    size_t size = arrayElementSize(kind) * count;
+    array->data = ALLOCATE(char, size);
+    memset(array->data, 0, size);
+    array->count = count;
+  }
+  pop();
+
+  return array;
+}
+
+bool isValidArrayIndex(ObjArray* array, int index) {
+  if (index < 0) {
+    index = array->count + index;
+  }
+
+  return index >= 0 && index < array->count;
+}
+
+Value indexFromArray(ObjArray* array, int index) {
+  if (index < 0) {
+    index = array->count + index;
+  }
+
+  switch (array->kind) {
+    case ARRAY_FLOAT64: return NUMBER_VAL(ARRAY_FLOATS(array)[index]);
+    case ARRAY_INT32: return NUMBER_VAL(ARRAY_INTS(array)[index]);
+    case ARRAY_UINT8: return NUMBER_VAL(ARRAY_BYTES(array)[index]);
+  }
+
+  return NIL_VAL; // Unreachable.
+}
+
+void storeToArray(ObjArray* array, int index, double value) {
+  if (index < 0) {
+    index = array->count + index;
+  }
+
+  switch (array->kind) {
+    case ARRAY_FLOAT64: ARRAY_FLOATS(array)[index] = value; break;
+    case ARRAY_INT32: ARRAY_INTS(array)[index] = clampInt32(value); break;
+    case ARRAY_UINT8: ARRAY_BYTES(array)[index] = clampUint8(value); break;
+  }
+}
+
+ObjStringBuilder* newStringBuilder() {
+  ObjStringBuilder* builder = ALLOCATE_OBJ(ObjStringBuilder, OBJ_STRING_BUILDER);
+  builder->length = 0;
+  builder->capacity = 0;
+  builder->chars = NULL;
+  return builder;
+}
+
+void builderAppend(ObjStringBuilder* builder, const char* chars, int length) {
+  if (builder->length + length > builder->capacity) {
+    int oldCapacity = builder->capacity;
+    int capacity = GROW_CAPACITY(oldCapacity);
+    while (capacity < builder->length + length) capacity *= 2;
+
+    builder->chars = GROW_ARRAY(char, builder->chars, oldCapacity, capacity);
+    builder->capacity = capacity;
+  }
+
+  memcpy(builder->chars + builder->length, chars, length);
+  builder->length += length;
+}
+
+void builderAppendValue(ObjStringBuilder* builder, Value value) {
+  if (IS_STRING(value)) {
+    ObjString* string = AS_STRING(value);
+    builderAppend(builder, string->chars, string->length);
+    return;
+  }
+
+  if (IS_NUMBER(value)) {
+    char number[32];
+    int length = snprintf(number, sizeof(number), "%.15g", AS_NUMBER(value));
+    builderAppend(builder, number, length);
+    return;
+  }
+
+  char* chars = stringValue(value);
+  builderAppend(builder, chars, strlen(chars));
+  free(chars);
+}
+
+ObjString* makeString(int length) {
+  ObjString* string = (ObjString*)allocateObject(STRING_SIZE(length), OBJ_STRING);
   string->length = length;
-  string->chars = chars;
+  string->hash = 0;
+  string->isHashed = false;
+  string->isInterned = false;
+  string->chars[length] = '\0';
+  return string;
+}
+
+ObjString* finishString(ObjString* string) {
+  if (string->length > STRING_INTERN_MAX) return string;
+  return internString(string);
+}
+
+static ObjString* allocateString(const char* chars, int length, uint32_t hash) {
+//< Hash Tables allocate-string
+  ObjString* string = makeString(length);
+  memcpy(string->chars, chars, length);
   string->hash = hash;
+  string->isHashed = true;
+  string->isInterned = true;
 
   push(OBJ_VAL(string));
   tableSet(&vm.strings, string, NIL_VAL);
@@ -239,31 +772,89 @@ static uint32_t hashString(const char* key, int length) {
 }
 //< Hash Tables hash-string
 //> take-string
+// A dead string stays interned until the sweeper gets to its page,
+// finding it again brings it back. A young one is merely made old.
+static ObjString* findInterned(const char* chars, int length, uint32_t hash) {
+  ObjString* interned = tableFindString(&vm.strings, chars, length, hash);
+  if (interned != NULL && vm.gcPhase == GC_SWEEPING &&
+      !isMarked(&interned->obj)) {
+    setMarked(&interned->obj);
+  }
+
+  return interned;
+}
+
 ObjString* takeString(char* chars, int length) {
   uint32_t hash = hashString(chars, length);
 
-  ObjString* interned = tableFindString(&vm.strings, chars, length, hash);
-  if (interned != NULL) {
-    FREE_ARRAY(char, chars, length + 1);
-    return interned;
-  }
+  ObjString* interned = findInterned(chars, length, hash);
+  if (interned == NULL) interned = allocateString(chars, length, hash);
 
-  return allocateString(chars, length, hash);
+  FREE_ARRAY(char, chars, length + 1);
+  return interned;
 //< Hash Tables take-string-hash
 }
 //< take-string
 ObjString* copyString(const char* chars, int length) {
 
   uint32_t hash = hashString(chars, length);
-  ObjString* interned = tableFindString(&vm.strings, chars, length, hash);
+  ObjString* interned = findInterned(chars, length, hash);
   if (interned != NULL) return interned;
 
+  return allocateString(chars, length, hash);
+}
+
+ObjString* takeRuntimeString(char* chars, int length) {
+  if (length <= STRING_INTERN_MAX) return takeString(chars, length);
+
+  ObjString* string = makeString(length);
+  memcpy(string->chars, chars, length);
+  FREE_ARRAY(char, chars, length + 1);
+  return string;
+}
+
+ObjString* copyRuntimeString(const char* chars, int length) {
+  if (length <= STRING_INTERN_MAX) return copyString(chars, length);
+
+  ObjString* string = makeString(length);
+  memcpy(string->chars, chars, length);
+  return string;
+}
+
+uint32_t stringHash(ObjString* string) {
+  if (!string->isHashed) {
+    string->hash = hashString(string->chars, string->length);
+    string->isHashed = true;
+  }
+
+  return string->hash;
+}
+
+// Two interned strings are equal only if they are the same one.
+bool stringsEqual(ObjString* a, ObjString* b) {
+  if (a == b) return true;
+  if (a->isInterned && b->isInterned) return false;
+  if (a->length != b->length) return false;
+  if (a->isHashed && b->isHashed && a->hash != b->hash) return false;
+
+  return memcmp(a->chars, b->chars, a->length) == 0;
+}
+
+ObjString* findInternedString(ObjString* string) {
+  if (string->isInterned) return string;
+  return findInterned(string->chars, string->length, stringHash(string));
+}
+
+ObjString* internString(ObjString* string) {
+  ObjString* interned = findInternedString(string);
+  if (interned != NULL) return interned;
 
-  char* heapChars = ALLOCATE(char, length + 1);
-  memcpy(heapChars, chars, length);
-  heapChars[length] = '\0';
+  string->isInterned = true;
+  push(OBJ_VAL(string));
+  tableSet(&vm.strings, string, NIL_VAL);
+  pop();
 
-  return allocateString(heapChars, length, hash);
+  return string;
 }
 
 bool isValidStringIndex(ObjString* string, int index) {
@@ -337,6 +928,18 @@ char* typeObject(Value value) {
     case OBJ_LIST:
       return generateType("list");
 
+    case OBJ_MAP:
+      return generateType("map");
+
+    case OBJ_SET:
+      return generateType("set");
+
+    case OBJ_ARRAY:
+      return generateType("array");
+
+    case OBJ_STRING_BUILDER:
+      return generateType("stringBuilder");
+
     case OBJ_INSTANCE: {
       return generateType("instance");
     }
@@ -416,6 +1019,132 @@ char* stringList(Value value) {
   return objectString;
 }
 
+// Appends 'length' bytes to a malloc'd string of 'size' bytes.
+static char* appendChars(char* string, int* length, int* size,
+                         const char* chars, int count) {
+  if (*length + count + 1 > *size) {
+    while (*length + count + 1 > *size) *size *= 2;
+    string = realloc(string, sizeof(char) * *size);
+
+    if (!string) {
+      printf("An issue occured during string conversion\n");
+      exit(71);
+    }
+  }
+
+  memcpy(string + *length, chars, count);
+  *length += count;
+  return string;
+}
+
+static char* appendValue(char* string, int* length, int* size, Value value) {
+  if (IS_STRING(value)) {
+    ObjString* s = AS_STRING(value);
+    string = appendChars(string, length, size, "\"", 1);
+    string = appendChars(string, length, size, s->chars, s->length);
+    return appendChars(string, length, size, "\"", 1);
+  }
+
+  char* valueString = stringValue(value);
+  string = appendChars(string, length, size, valueString, strlen(valueString));
+  free(valueString);
+  return string;
+}
+
+static char* stringMap(Value value) {
+  ObjMap* map = AS_MAP(value);
+  int size = 50;
+  int length = 0;
+  char* objectString = malloc(sizeof(char) * size);
+  objectString = appendChars(objectString, &length, &size, "{", 1);
+
+  bool first = true;
+  for (int i = 0; i < map->items.capacity; i++) {
+    ValueEntry* entry = &map->items.entries[i];
+    if (IS_EMPTY(entry->key)) continue;
+
+    if (!first) {
+      objectString = appendChars(objectString, &length, &size, ", ", 2);
+    }
+    first = false;
+
+    objectString = appendValue(objectString, &length, &size, entry->key);
+    objectString = appendChars(objectString, &length, &size, ": ", 2);
+    objectString = appendValue(objectString, &length, &size, entry->value);
+  }
+
+  objectString = appendChars(objectString, &length, &size, "}", 1);
+  objectString[length] = '\0';
+  return objectString;
+}
+
+static const char* arrayKindNames[] = {
+  [ARRAY_FLOAT64] = "float64",
+  [ARRAY_INT32] = "int32",
+  [ARRAY_UINT8] = "uint8",
+};
+
+const char* arrayKindName(ArrayKind kind) {
+  return arrayKindNames[kind];
+}
+
+// Written as a list led by the kind, float64[1, 2.5].
+static char* stringArray(Value value) {
+  ObjArray* array = AS_ARRAY(value);
+  const char* kind = arrayKindName(array->kind);
+  int size = 50;
+  int length = 0;
+  char* objectString = malloc(sizeof(char) * size);
+
+  objectString = appendChars(objectString, &length, &size, kind, strlen(kind));
+  objectString = appendChars(objectString, &length, &size, "[", 1);
+  for (int i = 0; i < array->count; i++) {
+    if (i != 0) {
+      objectString = appendChars(objectString, &length, &size, ", ", 2);
+    }
+
+    objectString = appendValue(objectString, &length, &size, indexFromArray(array, i));
+  }
+
+  objectString = appendChars(objectString, &length, &size, "]", 1);
+  objectString[length] = '\0';
+  return objectString;
+}
+
+// Written like a map without values, 'set()' when empty as '{}' would
+// read as a map.
+static char* stringSet(Value value) {
+  ObjSet* set = AS_SET(value);
+  int size = 50;
+  int length = 0;
+  char* objectString = malloc(sizeof(char) * size);
+
+  if (set->items.count == 0) {
+    objectString = appendChars(objectString, &length, &size, "set()", 5);
+    objectString[length] = '\0';
+    return objectString;
+  }
+
+  objectString = appendChars(objectString, &length, &size, "{", 1);
+
+  bool first = true;
+  for (int i = 0; i < set->items.capacity; i++) {
+    ValueEntry* entry = &set->items.entries[i];
+    if (IS_EMPTY(entry->key)) continue;
+
+    if (!first) {
+      objectString = appendChars(objectString, &length, &size, ", ", 2);
+    }
+    first = false;
+
+    objectString = appendValue(objectString, &length, &size, entry->key);
+  }
+
+  objectString = appendChars(objectString, &length, &size, "}", 1);
+  objectString[length] = '\0';
+  return objectString;
+}
+
 char* objectString(Value value) {
   switch (OBJ_TYPE(value)) {
     case OBJ_LIBRARY: {
@@ -504,6 +1233,26 @@ char* objectString(Value value) {
       return stringList(value);
     }
 
+    case OBJ_MAP: {
+      return stringMap(value);
+    }
+
+    case OBJ_SET: {
+      return stringSet(value);
+    }
+
+    case OBJ_ARRAY: {
+      return stringArray(value);
+    }
+
+    case OBJ_STRING_BUILDER: {
+      ObjStringBuilder* builder = AS_STRING_BUILDER(value);
+      char* builderString = malloc(sizeof(char) * (builder->length + 1));
+      memcpy(builderString, builder->chars, builder->length);
+      builderString[builder->length] = '\0';
+      return builderString;
+    }
+
     case OBJ_UPVALUE: {
       char* objectString = malloc(sizeof(char) * 8);
       memmove(objectString, "upvalue", 7);
@@ -551,6 +1300,67 @@ void printObject(Value value) {
       printf("]");
       break;
     }
+
+    case OBJ_MAP: {
+      ObjMap* map = AS_MAP(value);
+      bool first = true;
+      printf("{");
+      for (int i = 0; i < map->items.capacity; i++) {
+        ValueEntry* entry = &map->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        if (!first) printf(", ");
+        first = false;
+
+        printValue(entry->key);
+        printf(": ");
+        printValue(entry->value);
+      }
+
+      printf("}");
+      break;
+    }
+
+    case OBJ_SET: {
+      ObjSet* set = AS_SET(value);
+      if (set->items.count == 0) {
+        printf("set()");
+        break;
+      }
+
+      bool first = true;
+      printf("{");
+      for (int i = 0; i < set->items.capacity; i++) {
+        ValueEntry* entry = &set->items.entries[i];
+        if (IS_EMPTY(entry->key)) continue;
+
+        if (!first) printf(", ");
+        first = false;
+
+        printValue(entry->key);
+      }
+
+      printf("}");
+      break;
+    }
+
+    case OBJ_ARRAY: {
+      ObjArray* array = AS_ARRAY(value);
+      printf("%s[", arrayKindName(array->kind));
+      for (int i = 0; i < array->count; i++) {
+        if (i != 0) printf(", ");
+        printValue(indexFromArray(array, i));
+      }
+
+      printf("]");
+      break;
+    }
+
+    case OBJ_STRING_BUILDER: {
+      ObjStringBuilder* builder = AS_STRING_BUILDER(value);
+      printf("%.*s", builder->length, builder->chars);
+      break;
+    }
 //< Classes and Instances print-class
 //> Closures print-closure
     case OBJ_CLOSURE:
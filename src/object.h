@@ -30,6 +30,10 @@
 #define IS_LIST(value)       isObjType(value, OBJ_LIST)
 #define IS_LIBRARY(value)    isObjType(value, OBJ_LIBRARY)
 #define IS_FILE(value)       isObjType(value, OBJ_FILE)
+#define IS_MAP(value)        isObjType(value, OBJ_MAP)
+#define IS_SET(value)        isObjType(value, OBJ_SET)
+#define IS_ARRAY(value)      isObjType(value, OBJ_ARRAY)
+#define IS_STRING_BUILDER(value) isObjType(value, OBJ_STRING_BUILDER)
 
 
 
@@ -38,6 +42,10 @@
 #define AS_BOUND_METHOD(value) ((ObjBoundMethod*)AS_OBJ(value))
 #define AS_CLASS(value)        ((ObjClass*)AS_OBJ(value))
 #define AS_LIST(value)        ((ObjList*)AS_OBJ(value))
+#define AS_MAP(value)         ((ObjMap*)AS_OBJ(value))
+#define AS_SET(value)         ((ObjSet*)AS_OBJ(value))
+#define AS_ARRAY(value)       ((ObjArray*)AS_OBJ(value))
+#define AS_STRING_BUILDER(value) ((ObjStringBuilder*)AS_OBJ(value))
 
 #define AS_CLOSURE(value)      ((ObjClosure*)AS_OBJ(value))
 
@@ -74,22 +82,42 @@ typedef enum {
   OBJ_LIBRARY,
 
   OBJ_FILE,
+
+  OBJ_MAP,
+
+  OBJ_SET,
+
+  OBJ_ARRAY,
+
+  OBJ_STRING_BUILDER,
 } ObjType;
 
+// Keep in step with the last of ObjType.
+#define OBJ_TYPE_COUNT (OBJ_STRING_BUILDER + 1)
+
 
+// The mark bit, which also tells old objects from young ones, is kept
+// in a bitmap on the object's page, see pool.h.
 struct Obj {
   ObjType type;
-  bool mark;
-  struct Obj* next;
+  // Allocated on its own instead of in a page.
+  bool isLarge;
+  // Old object that is in the remembered set.
+  bool isRemembered;
 };
 
 typedef struct {
   Obj obj;
 
   ObjString* name;
+
+  // Name -> index into 'slots'. Module level names are resolved to
+  // slots by the compiler, the tables are for lookups by name.
   Table values;
   Table privateValues;
 
+  ValueArray slots;
+
 } ObjLibrary;
 
 typedef enum {
@@ -113,6 +141,9 @@ typedef struct {
 
   int upvalueCount;
 
+  // Most values a call holds on the stack at once, slot zero included.
+  int maxStack;
+
   Chunk chunk;
   ObjString* name;
 
@@ -134,11 +165,20 @@ typedef struct {
 struct ObjString {
   Obj obj;
   int length;
-  char* chars;
+  // Only valid once 'isHashed' is set, interned strings always are.
   uint32_t hash;
-
+  bool isHashed;
+  bool isInterned;
+  // Right after the header, a string is a single allocation.
+  char chars[];
 };
 
+#define STRING_SIZE(length) (sizeof(ObjString) + (length) + 1)
+
+// Longer strings made while running are left out of the intern table,
+// and only hashed once something needs the hash.
+#define STRING_INTERN_MAX 256
+
 typedef struct ObjUpvalue {
   Obj obj;
   Value* location;
@@ -166,6 +206,20 @@ typedef struct {
 } ObjClosure;
 
 
+// Describes the field layout shared by instances of a class. Adding a
+// field moves an instance along a transition to the next shape.
+typedef struct Shape {
+  uint32_t id;
+  int slotCount;
+
+  Table slots;
+  Table privateSlots;
+
+  // Field name -> index of the next shape in its class.
+  Table transitions;
+  Table privateTransitions;
+} Shape;
+
 typedef struct {
   Obj obj;
   ObjString* name;
@@ -173,18 +227,70 @@ typedef struct {
   Table methods;
   Table privateMethods;
 
+  Shape** shapes;
+  int shapeCount;
+  int shapeCapacity;
+
+  // Largest field count seen, new instances start with that many slots.
+  int maxSlotCount;
+
 } ObjClass;
 
+// 'items.values' points at the first item, 'front' free slots into
+// the block, so either end can grow or shrink without moving the rest.
 typedef struct {
     Obj obj;
     ValueArray items;
+    int front;
 } ObjList;
 
+typedef struct {
+    Obj obj;
+    ValueTable items;
+} ObjMap;
+
+// The members are the keys of 'items', their values are all true.
+typedef struct {
+    Obj obj;
+    ValueTable items;
+} ObjSet;
+
+typedef enum {
+  ARRAY_FLOAT64,
+  ARRAY_INT32,
+  ARRAY_UINT8,
+} ArrayKind;
+
+// A fixed length array of unboxed numbers of one kind. Numbers stored
+// into the integer kinds are truncated and clamped to their range,
+// NaN becomes 0.
+typedef struct {
+    Obj obj;
+    ArrayKind kind;
+    int count;
+    void* data;
+} ObjArray;
+
+#define ARRAY_FLOATS(array) ((double*)(array)->data)
+#define ARRAY_INTS(array)   ((int32_t*)(array)->data)
+#define ARRAY_BYTES(array)  ((uint8_t*)(array)->data)
+
+// Text gathered piece by piece into a buffer that grows by doubling,
+// the characters are only hashed and interned once made a string.
+typedef struct {
+    Obj obj;
+    int length;
+    int capacity;
+    char* chars;
+} ObjStringBuilder;
+
 typedef struct {
   Obj obj;
   ObjClass* klass;
-  Table fields;
-  Table privateFields;
+  Shape* shape;
+
+  Value* fields;
+  int fieldCapacity;
 } ObjInstance;
 
 
@@ -200,28 +306,100 @@ ObjBoundMethod* newBoundMethod(Value receiver, ObjClosure* method);
 ObjClass* newClass(ObjString* name);
 
 ObjLibrary* newLibrary(ObjString* name);
+int librarySlot(ObjLibrary* library, ObjString* name, bool isPrivate);
+ObjString* librarySlotName(ObjLibrary* library, int slot);
+bool libraryGet(ObjLibrary* library, ObjString* name, Value* value);
+void librarySet(ObjLibrary* library, ObjString* name, Value value);
 
 ObjClosure* newClosure(ObjFunction* function);
 
 ObjFunction* newFunction(ObjLibrary* library, FunctionType type);
 
 ObjInstance* newInstance(ObjClass* klass);
+int shapeFindSlot(Shape* shape, ObjString* name, bool isPrivate);
+Shape* shapeTransition(ObjClass* klass, Shape* shape, ObjString* name, bool isPrivate);
+void reserveInstanceFields(ObjInstance* instance, int count);
+bool instanceGetField(ObjInstance* instance, ObjString* name, bool isPrivate, Value* value);
+int instanceSetField(ObjInstance* instance, ObjString* name, bool isPrivate, Value value);
 
 ObjFile* newFile();
 
 ObjList* newList();
+ObjList* newListWithCapacity(int capacity);
 void appendToList(ObjList* list, Value value);
+void reserveList(ObjList* list, int capacity);
+void shrinkList(ObjList* list);
+void appendValuesToList(ObjList* list, Value* values, int count);
 Value indexFromList(ObjList* list, int index);
 bool isValidListIndex(ObjList* list, int index);
+void insertIntoList(ObjList* list, int index, Value value);
 void deleteFromList(ObjList* list, int index);
+void rotateList(ObjList* list, int steps);
 void storeToList(ObjList* list, int index, Value value);
 void clearList(ObjList* list);
+void freeList(ObjList* list);
+
+ObjMap* newMap();
+bool mapGet(ObjMap* map, Value key, Value* value);
+// The key must be hashable, the map and both values reachable.
+void mapSet(ObjMap* map, Value key, Value value);
+bool mapDelete(ObjMap* map, Value key);
+
+ObjSet* newSet();
+// The value must be hashable, the set and the value reachable.
+void setAdd(ObjSet* set, Value value);
+bool setHas(ObjSet* set, Value value);
+bool setRemove(ObjSet* set, Value value);
+
+// Zeroed.
+ObjArray* newArray(ArrayKind kind, int count);
+size_t arrayElementSize(ArrayKind kind);
+const char* arrayKindName(ArrayKind kind);
+bool isValidArrayIndex(ObjArray* array, int index);
+Value indexFromArray(ObjArray* array, int index);
+void storeToArray(ObjArray* array, int index, double value);
+
+ObjStringBuilder* newStringBuilder();
+void builderAppend(ObjStringBuilder* builder, const char* chars, int length);
+// Strings go in as they are, anything else as toString() writes it.
+void builderAppendValue(ObjStringBuilder* builder, Value value);
+
+static inline int32_t clampInt32(double value) {
+  if (value != value) return 0;
+  if (value <= -2147483648.0) return INT32_MIN;
+  if (value >= 2147483647.0) return INT32_MAX;
+  return (int32_t)value;
+}
+
+static inline uint8_t clampUint8(double value) {
+  if (value != value || value <= 0) return 0;
+  if (value >= 255) return 255;
+  return (uint8_t)value;
+}
 
 
 ObjNative* newNative(NativeFn function);
 
+// Takes ownership of 'chars', which are copied into the string.
 ObjString* takeString(char* chars, int length);
 ObjString* copyString(const char* chars, int length);
+// An uninterned string of 'length' characters for the caller to fill
+// in, then hand to finishString().
+ObjString* makeString(int length);
+// Interns the string if short, returning the interned one.
+ObjString* finishString(ObjString* string);
+// For the strings natives and operators make, which are only interned
+// if short.
+ObjString* takeRuntimeString(char* chars, int length);
+ObjString* copyRuntimeString(const char* chars, int length);
+
+uint32_t stringHash(ObjString* string);
+bool stringsEqual(ObjString* a, ObjString* b);
+// Returns the interned string equal to 'string', which becomes it when
+// there is none.
+ObjString* internString(ObjString* string);
+// Like internString() but never interns, NULL when there is none.
+ObjString* findInternedString(ObjString* string);
 
 bool isValidStringIndex(ObjString* string, int index);
 Value indexFromString(ObjString* string, int index);
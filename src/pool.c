@@ -0,0 +1,295 @@
+// posix_memalign() is POSIX, a strict -std=c99 build hides it otherwise.
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "pool.h"
+
+#define PAGE_HEADER_SIZE \
+    ((sizeof(PoolPage) + POOL_GRANULE - 1) & ~(size_t)(POOL_GRANULE - 1))
+
+#define PAGE_END(page) ((char*)(page) + POOL_PAGE_SIZE)
+
+static void* allocatePage() {
+  void* page;
+#ifdef _WIN32
+  page = _aligned_malloc(POOL_PAGE_SIZE, POOL_PAGE_SIZE);
+#else
+  if (posix_memalign(&page, POOL_PAGE_SIZE, POOL_PAGE_SIZE) != 0) page = NULL;
+#endif
+  if (page == NULL) exit(1);
+  return page;
+}
+
+static void releasePage(PoolPage* page) {
+#ifdef _WIN32
+  _aligned_free(page);
+#else
+  free(page);
+#endif
+}
+
+static PoolPage** pageList(Pool* pool, int index, PageState state) {
+  switch (state) {
+    case PAGE_AVAILABLE: return &pool->available[index];
+    case PAGE_FULL: return &pool->full[index];
+    case PAGE_UNSWEPT: return &pool->unswept[index];
+  }
+
+  return NULL; // Unreachable.
+}
+
+static void linkPage(Pool* pool, PoolPage* page, PageState state) {
+  PoolPage** list = pageList(pool, POOL_SIZE_CLASS(page->cellSize), state);
+
+  page->state = state;
+  page->prev = NULL;
+  page->next = *list;
+  if (page->next != NULL) page->next->prev = page;
+  *list = page;
+}
+
+static void unlinkPage(Pool* pool, PoolPage* page) {
+  if (page->prev != NULL) {
+    page->prev->next = page->next;
+  } else {
+    *pageList(pool, POOL_SIZE_CLASS(page->cellSize), page->state) = page->next;
+  }
+  if (page->next != NULL) page->next->prev = page->prev;
+}
+
+static void releasePages(PoolPage* page) {
+  while (page != NULL) {
+    PoolPage* next = page->next;
+    releasePage(page);
+    page = next;
+  }
+}
+
+static void releaseLarge(LargeObject* large) {
+  while (large != NULL) {
+    LargeObject* next = large->next;
+    free(large);
+    large = next;
+  }
+}
+
+void initPool(Pool* pool) {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    pool->available[i] = NULL;
+    pool->full[i] = NULL;
+    pool->unswept[i] = NULL;
+  }
+
+  pool->youngPages = NULL;
+  pool->youngCount = 0;
+  pool->youngCapacity = 0;
+
+  pool->large = NULL;
+  pool->youngLarge = NULL;
+  pool->largeSweep = &pool->large;
+}
+
+void freePool(Pool* pool) {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    releasePages(pool->available[i]);
+    releasePages(pool->full[i]);
+    releasePages(pool->unswept[i]);
+  }
+
+  releaseLarge(pool->large);
+  releaseLarge(pool->youngLarge);
+  free(pool->youngPages);
+
+  initPool(pool);
+}
+
+static inline bool isFull(PoolPage* page) {
+  return page->freeList == NULL &&
+         page->bump + page->cellSize > PAGE_END(page);
+}
+
+static PoolPage* newPage(Pool* pool, int index) {
+  PoolPage* page = (PoolPage*)allocatePage();
+  page->isYoung = false;
+  page->freeList = NULL;
+  page->bump = (char*)page + PAGE_HEADER_SIZE;
+  page->cellSize = (index + 1) * POOL_GRANULE;
+  page->liveCount = 0;
+  memset(page->bits, 0, sizeof(page->bits));
+
+  linkPage(pool, page, PAGE_AVAILABLE);
+  return page;
+}
+
+static void addYoungPage(Pool* pool, PoolPage* page) {
+  if (pool->youngCapacity < pool->youngCount + 1) {
+    pool->youngCapacity = pool->youngCapacity < 8 ? 8 : pool->youngCapacity * 2;
+    pool->youngPages = (PoolPage**)realloc(pool->youngPages,
+        sizeof(PoolPage*) * pool->youngCapacity);
+
+    if (pool->youngPages == NULL) exit(1);
+  }
+
+  page->isYoung = true;
+  pool->youngPages[pool->youngCount++] = page;
+}
+
+static Obj* allocateLarge(Pool* pool, size_t size) {
+  LargeObject* large = (LargeObject*)malloc(sizeof(LargeObject) + size);
+  if (large == NULL) exit(1);
+
+  large->size = size;
+  large->isMarked = false;
+  large->next = pool->youngLarge;
+  pool->youngLarge = large;
+
+  Obj* object = LARGE_OBJECT(large);
+  object->isLarge = true;
+  return object;
+}
+
+Obj* poolAllocate(Pool* pool, size_t size) {
+  if (size > POOL_MAX_SIZE) return allocateLarge(pool, size);
+
+  int index = POOL_SIZE_CLASS(size);
+  PoolPage* page = pool->available[index];
+  if (page == NULL) page = newPage(pool, index);
+
+  Obj* object;
+  if (page->freeList != NULL) {
+    object = (Obj*)page->freeList;
+    page->freeList = *(void**)object;
+  } else {
+    object = (Obj*)page->bump;
+    page->bump += page->cellSize;
+  }
+
+  size_t bit = CELL_BIT(page, object);
+  page->bits[bit / 64].allocated |= (uint64_t)1 << (bit % 64);
+  page->liveCount++;
+
+  if (!page->isYoung) addYoungPage(pool, page);
+  if (isFull(page)) {
+    unlinkPage(pool, page);
+    linkPage(pool, page, PAGE_FULL);
+  }
+
+  object->isLarge = false;
+  return object;
+}
+
+int poolReclaimDead(Pool* pool, PoolPage* page) {
+  int reclaimed = 0;
+  // The cells are chained in address order, ahead of the older ones.
+  void* head = NULL;
+  void** tail = &head;
+
+  for (int i = 0; i < POOL_BITMAP_WORDS; i++) {
+    uint64_t dead = page->bits[i].allocated & ~page->bits[i].marked;
+    if (dead == 0) continue;
+
+    page->bits[i].allocated &= page->bits[i].marked;
+    while (dead != 0) {
+      void* cell = CELL_AT(page, i * 64 + lowestBit(dead));
+      dead &= dead - 1;
+
+      *tail = cell;
+      tail = (void**)cell;
+      reclaimed++;
+    }
+  }
+
+  if (reclaimed == 0) return 0;
+
+  *tail = page->freeList;
+  page->freeList = head;
+  page->liveCount -= reclaimed;
+
+  if (page->state == PAGE_FULL) {
+    unlinkPage(pool, page);
+    linkPage(pool, page, PAGE_AVAILABLE);
+  }
+
+  return reclaimed;
+}
+
+void poolSweptPage(Pool* pool, PoolPage* page) {
+  unlinkPage(pool, page);
+  linkPage(pool, page, isFull(page) ? PAGE_FULL : PAGE_AVAILABLE);
+}
+
+void poolClearMarks(Pool* pool) {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    PoolPage* lists[] = {pool->available[i], pool->full[i]};
+    for (int j = 0; j < 2; j++) {
+      for (PoolPage* page = lists[j]; page != NULL; page = page->next) {
+        for (int k = 0; k < POOL_BITMAP_WORDS; k++) {
+          page->bits[k].marked = 0;
+        }
+      }
+    }
+  }
+
+  for (LargeObject* large = pool->large; large != NULL; large = large->next) {
+    large->isMarked = false;
+  }
+}
+
+static void moveToUnswept(Pool* pool, PoolPage** list) {
+  while (*list != NULL) {
+    PoolPage* page = *list;
+    unlinkPage(pool, page);
+    linkPage(pool, page, PAGE_UNSWEPT);
+  }
+}
+
+void poolStartSweep(Pool* pool) {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    moveToUnswept(pool, &pool->available[i]);
+    moveToUnswept(pool, &pool->full[i]);
+  }
+
+  for (int i = 0; i < pool->youngCount; i++) {
+    pool->youngPages[i]->isYoung = false;
+  }
+  pool->youngCount = 0;
+
+  while (pool->youngLarge != NULL) {
+    LargeObject* large = pool->youngLarge;
+    pool->youngLarge = large->next;
+    large->next = pool->large;
+    pool->large = large;
+  }
+  pool->largeSweep = &pool->large;
+}
+
+void poolReleaseEmpty(Pool* pool) {
+  for (int i = 0; i < POOL_CLASS_COUNT; i++) {
+    bool keptSpare = false;
+    PoolPage* page = pool->available[i];
+
+    while (page != NULL) {
+      PoolPage* next = page->next;
+
+      if (page->liveCount == 0 && !page->isYoung) {
+        if (keptSpare) {
+          unlinkPage(pool, page);
+          releasePage(page);
+        } else {
+          keptSpare = true;
+        }
+      }
+
+      page = next;
+    }
+  }
+}
@@ -0,0 +1,173 @@
+#ifndef Pa_pool_h
+#define Pa_pool_h
+
+#include "common.h"
+#include "object.h"
+
+// Objects are carved out of POOL_PAGE_SIZE pages, each page holding
+// cells of a single size class. Classes are POOL_GRANULE bytes apart,
+// anything larger than POOL_MAX_SIZE is allocated on its own.
+#define POOL_PAGE_SIZE (64 * 1024)
+#define POOL_GRANULE 8
+#define POOL_MAX_SIZE 256
+#define POOL_CLASS_COUNT (POOL_MAX_SIZE / POOL_GRANULE)
+
+// One bit per granule of a page, cells use the bit of their first one.
+#define POOL_BITMAP_WORDS (POOL_PAGE_SIZE / POOL_GRANULE / 64)
+
+#define POOL_SIZE_CLASS(size) ((int)(((size) - 1) / POOL_GRANULE))
+
+typedef enum {
+  PAGE_AVAILABLE,
+  PAGE_FULL,
+  // May still hold objects the last major collection found dead.
+  PAGE_UNSWEPT,
+} PageState;
+
+// Mark bits are sticky: a marked object is an old one, and stays marked
+// until the next major collection clears them all. Objects that are
+// allocated but not marked are young, or dead once marking is over.
+typedef struct PoolPage {
+  struct PoolPage* next;
+  struct PoolPage* prev;
+  PageState state;
+  // Allocated into since the last minor collection.
+  bool isYoung;
+
+  // Freed cells, then the never used ones from 'bump' to the end.
+  void* freeList;
+  char* bump;
+
+  int cellSize;
+  int liveCount;
+
+  // Side by side, the barrier checks the mark of an object the
+  // allocator has just touched.
+  struct {
+    uint64_t allocated;
+    uint64_t marked;
+  } bits[POOL_BITMAP_WORDS];
+} PoolPage;
+
+// Sits right before an object too large for the pages.
+typedef struct LargeObject {
+  struct LargeObject* next;
+  size_t size;
+  bool isMarked;
+} LargeObject;
+
+typedef struct {
+  // Pages of each size class by state, allocation takes the first
+  // available one.
+  PoolPage* available[POOL_CLASS_COUNT];
+  PoolPage* full[POOL_CLASS_COUNT];
+  PoolPage* unswept[POOL_CLASS_COUNT];
+
+  // The pages a minor collection has to sweep.
+  PoolPage** youngPages;
+  int youngCount;
+  int youngCapacity;
+
+  LargeObject* large;
+  LargeObject* youngLarge;
+  // How far the sweep of 'large' has got.
+  LargeObject** largeSweep;
+} Pool;
+
+// Pages are aligned to their size, so an object finds its page by
+// masking its address.
+#define PAGE_OF(object) \
+    ((PoolPage*)((uintptr_t)(object) & ~(uintptr_t)(POOL_PAGE_SIZE - 1)))
+
+#define CELL_BIT(page, object) \
+    ((size_t)((char*)(object) - (char*)(page)) / POOL_GRANULE)
+
+#define CELL_AT(page, bit) \
+    ((Obj*)((char*)(page) + (size_t)(bit) * POOL_GRANULE))
+
+#define LARGE_OF(object) ((LargeObject*)(object) - 1)
+#define LARGE_OBJECT(large) ((Obj*)((large) + 1))
+
+static inline int lowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#else
+  int bit = 0;
+  while ((bits & 1) == 0) {
+    bits >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+static inline bool isMarked(Obj* object) {
+  if (object->isLarge) return LARGE_OF(object)->isMarked;
+
+  PoolPage* page = PAGE_OF(object);
+  size_t bit = CELL_BIT(page, object);
+  return (page->bits[bit / 64].marked >> (bit % 64)) & 1;
+}
+
+static inline void setMarked(Obj* object) {
+  if (object->isLarge) {
+    LARGE_OF(object)->isMarked = true;
+    return;
+  }
+
+  PoolPage* page = PAGE_OF(object);
+  size_t bit = CELL_BIT(page, object);
+  page->bits[bit / 64].marked |= (uint64_t)1 << (bit % 64);
+}
+
+#ifdef PARALLEL_MARK
+// setMarked() for the mark threads, returns false if the object was
+// marked already, by this thread or another.
+static inline bool markAtomically(Obj* object) {
+  if (object->isLarge) {
+    LargeObject* large = LARGE_OF(object);
+    if (__atomic_load_n(&large->isMarked, __ATOMIC_RELAXED)) return false;
+    return !__atomic_exchange_n(&large->isMarked, true, __ATOMIC_RELAXED);
+  }
+
+  PoolPage* page = PAGE_OF(object);
+  size_t bit = CELL_BIT(page, object);
+  uint64_t mask = (uint64_t)1 << (bit % 64);
+  uint64_t* marked = &page->bits[bit / 64].marked;
+
+  // Most references are to objects that are marked already, a plain
+  // load keeps those from taking the cache line.
+  if (__atomic_load_n(marked, __ATOMIC_RELAXED) & mask) return false;
+  return !(__atomic_fetch_or(marked, mask, __ATOMIC_RELAXED) & mask);
+}
+#endif
+
+void initPool(Pool* pool);
+
+// Releases the memory only, the objects must have been freed.
+void freePool(Pool* pool);
+
+// Returns an unmarked, young object with 'isLarge' set. Pages that are
+// still unswept are not allocated from.
+Obj* poolAllocate(Pool* pool, size_t size);
+
+// Takes back the cells of the objects that are allocated but not
+// marked, which must have been freed already. Returns how many.
+int poolReclaimDead(Pool* pool, PoolPage* page);
+
+// Moves a page whose dead cells have all been freed out of the
+// unswept list.
+void poolSweptPage(Pool* pool, PoolPage* page);
+
+// Clears every mark for a major collection.
+void poolClearMarks(Pool* pool);
+
+// Once marking is over every page needs sweeping, and every large
+// object is either old or dead.
+void poolStartSweep(Pool* pool);
+
+// Gives the pages left without a live cell back to the system, one
+// spare page per class is kept.
+void poolReleaseEmpty(Pool* pool);
+
+#endif
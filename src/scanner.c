@@ -9,6 +9,11 @@ typedef struct {
   const char* start;
   const char* current;
   int line;
+
+  // First character of the current line, and the column the token
+  // being scanned starts at.
+  const char* lineStart;
+  int column;
 } Scanner;
 
 Scanner scanner;
@@ -17,6 +22,8 @@ void initScanner(const char* source) {
   scanner.start = source;
   scanner.current = source;
   scanner.line = 1;
+  scanner.lineStart = source;
+  scanner.column = 1;
 }
 
 static bool isAlpha(char c) {
@@ -81,6 +88,7 @@ static Token makeToken(TokenType type) {
   token.start = scanner.start;
   token.length = (int)(scanner.current - scanner.start);
   token.line = scanner.line;
+  token.column = scanner.column;
   return token;
 }
 //< make-token
@@ -91,6 +99,7 @@ static Token errorToken(const char* message) {
   token.start = message;
   token.length = (int)strlen(message);
   token.line = scanner.line;
+  token.column = scanner.column;
   return token;
 }
 //< error-token
@@ -108,6 +117,7 @@ static void skipWhitespace() {
       case '\n':
         scanner.line++;
         advance();
+        scanner.lineStart = scanner.current;
         break;
 
       case '/':
@@ -246,6 +256,7 @@ static Token string(char stringToken) {
   while (peek() != stringToken && !isAtEnd()) {
     if (peek() == '\n') {
       scanner.line++;
+      scanner.lineStart = scanner.current + 1;
     } else if (peek() == '\\') {
       scanner.current++;
     }
@@ -265,6 +276,7 @@ Token scanToken() {
   skipWhitespace();
 //< call-skip-whitespace
   scanner.start = scanner.current;
+  scanner.column = (int)(scanner.start - scanner.lineStart) + 1;
 
   if (isAtEnd()) return makeToken(TOKEN_EOF);
 //> scan-char
@@ -38,6 +38,7 @@ typedef struct {
   const char* start;
   int length;
   int line;
+  int column;
 } Token;
 //< token-struct
 
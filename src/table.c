@@ -139,24 +139,188 @@ ObjString* tableFindString(Table* table, const char* chars, int length, uint32_t
   }
 }
 
-void tableRemoveWhite(Table* table) {
+void markTable(Table* table) {
   for (int i = 0; i < table->capacity; i++) {
+
     Entry* entry = &table->entries[i];
+    markObject((Obj*)entry->key);
+    markValue(entry->value);
+  }
+}
+//< Garbage Collection mark-table
+
+//> value-table
+bool isHashable(Value value) {
+  return IS_STRING(value) || IS_NUMBER(value) || IS_BOOL(value) ||
+         IS_NIL(value);
+}
+
+static uint32_t hashValue(Value value) {
+  if (IS_STRING(value)) return stringHash(AS_STRING(value));
+
+  if (IS_NUMBER(value)) {
+    double number = AS_NUMBER(value);
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+
+    // The low bits of a double are mostly zero for integers.
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    return (uint32_t)bits;
+  }
+
+  if (IS_BOOL(value)) return AS_BOOL(value) ? 3 : 2;
+  return 1;
+}
+
+// -0 and 0 are equal, so they must hash the same.
+static inline Value normalizeKey(Value key) {
+  if (IS_NUMBER(key) && AS_NUMBER(key) == 0) return NUMBER_VAL(0);
+  return key;
+}
+
+// Keys are interned when set, a string that isn't interned has no
+// entry. Returns false for those.
+static inline bool lookupKey(Value* key) {
+  if (IS_STRING(*key) && !AS_STRING(*key)->isInterned) {
+    ObjString* interned = findInternedString(AS_STRING(*key));
+    if (interned == NULL) return false;
+    *key = OBJ_VAL(interned);
+    return true;
+  }
+
+  *key = normalizeKey(*key);
+  return true;
+}
 
-    if (entry->key != NULL && entry->key->obj.mark != vm.markVal) {
+static inline bool keysEqual(Value a, Value b) {
+#ifdef NAN_BOXING
+  // Strings are interned and zeros normalized, the bits tell.
+  return a == b;
+#else
+  return valuesEqual(a, b);
+#endif
+}
+
+void initValueTable(ValueTable* table) {
+  table->count = 0;
+  table->used = 0;
+  table->capacity = 0;
+  table->entries = NULL;
+}
+
+void freeValueTable(ValueTable* table) {
+  FREE_ARRAY(ValueEntry, table->entries, table->capacity);
+  initValueTable(table);
+}
+
+static ValueEntry* findValueEntry(ValueEntry* entries, int capacity,
+                                  Value key) {
+  uint32_t index = hashValue(key) & (capacity - 1);
+  ValueEntry* tombstone = NULL;
+
+  for (;;) {
+    ValueEntry* entry = &entries[index];
 
-      tableDelete(table, entry->key);
+    if (IS_EMPTY(entry->key)) {
+      if (IS_NIL(entry->value)) {
+        return tombstone != NULL ? tombstone : entry;
+      } else {
+        if (tombstone == NULL) tombstone = entry;
+      }
+    } else if (keysEqual(entry->key, key)) {
+      return entry;
     }
 
+    index = (index + 1) & (capacity - 1);
   }
 }
 
-void markTable(Table* table) {
+bool valueTableGet(ValueTable* table, Value key, Value* value) {
+  if (table->count == 0 || !lookupKey(&key)) return false;
+
+  ValueEntry* entry = findValueEntry(table->entries, table->capacity, key);
+  if (IS_EMPTY(entry->key)) return false;
+
+  *value = entry->value;
+  return true;
+}
+
+static void adjustValueCapacity(ValueTable* table, int capacity) {
+  ValueEntry* entries = ALLOCATE(ValueEntry, capacity);
+  for (int i = 0; i < capacity; i++) {
+    entries[i].key = EMPTY_VAL;
+    entries[i].value = NIL_VAL;
+  }
+
+  table->count = 0;
+
   for (int i = 0; i < table->capacity; i++) {
+    ValueEntry* entry = &table->entries[i];
+    if (IS_EMPTY(entry->key)) continue;
 
-    Entry* entry = &table->entries[i];
-    markObject((Obj*)entry->key);
+    ValueEntry* dest = findValueEntry(entries, capacity, entry->key);
+    dest->key = entry->key;
+    dest->value = entry->value;
+    table->count++;
+  }
+  table->used = table->count;
+
+  FREE_ARRAY(ValueEntry, table->entries, table->capacity);
+
+  table->entries = entries;
+  table->capacity = capacity;
+}
+
+bool valueTableSet(ValueTable* table, Value key, Value value) {
+  if (table->used + 1 > table->capacity * TABLE_MAX_LOAD) {
+    // Tombstones alone don't make the table any larger.
+    int capacity = table->count + 1 > table->capacity * TABLE_MAX_LOAD / 2
+        ? GROW_CAPACITY(table->capacity) : table->capacity;
+    adjustValueCapacity(table, capacity);
+  }
+
+  key = normalizeKey(key);
+  ValueEntry* entry = findValueEntry(table->entries, table->capacity, key);
+  bool isNewKey = IS_EMPTY(entry->key);
+
+  if (isNewKey) {
+    table->count++;
+    if (IS_NIL(entry->value)) table->used++;
+  }
+
+  entry->key = key;
+  entry->value = value;
+  return isNewKey;
+}
+
+bool valueTableDelete(ValueTable* table, Value key) {
+  if (table->count == 0 || !lookupKey(&key)) return false;
+
+  ValueEntry* entry = findValueEntry(table->entries, table->capacity, key);
+  if (IS_EMPTY(entry->key)) return false;
+
+  entry->key = EMPTY_VAL;
+  entry->value = BOOL_VAL(true);
+  table->count--;
+  return true;
+}
+
+void valueTableReserve(ValueTable* table, int count) {
+  int capacity = table->capacity < 8 ? 8 : table->capacity;
+  while (count > capacity * TABLE_MAX_LOAD) capacity *= 2;
+
+  if (capacity > table->capacity) adjustValueCapacity(table, capacity);
+}
+
+void markValueTable(ValueTable* table) {
+  for (int i = 0; i < table->capacity; i++) {
+    ValueEntry* entry = &table->entries[i];
+    if (IS_EMPTY(entry->key)) continue;
+
+    markValue(entry->key);
     markValue(entry->value);
   }
 }
-//< Garbage Collection mark-table
+//< value-table
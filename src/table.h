@@ -20,6 +20,22 @@ typedef struct {
   Entry* entries;
 } Table;
 
+// A Table keyed by any hashable value, see isHashable(). An entry
+// without a key holds nil when it is empty, true when it is a
+// tombstone.
+typedef struct {
+  Value key;
+  Value value;
+} ValueEntry;
+
+typedef struct {
+  int count;
+  // Entries and tombstones, what the load factor is kept on.
+  int used;
+  int capacity;
+  ValueEntry* entries;
+} ValueTable;
+
 //> init-table-h
 void initTable(Table* table);
 
@@ -36,9 +52,28 @@ void tableAddAll(Table* from, Table* to);
 ObjString* tableFindString(Table* table, const char* chars,
                            int length, uint32_t hash);
 
-void tableRemoveWhite(Table* table);
 
 void markTable(Table* table);
 
+// Strings, numbers, booleans and none.
+bool isHashable(Value value);
+
+void initValueTable(ValueTable* table);
+
+void freeValueTable(ValueTable* table);
+
+bool valueTableGet(ValueTable* table, Value key, Value* value);
+
+// The key must be hashable, and interned if it is a string.
+bool valueTableSet(ValueTable* table, Value key, Value value);
+
+bool valueTableDelete(ValueTable* table, Value key);
+
+// Makes room for 'count' entries in all, so as many sets don't grow
+// the table.
+void valueTableReserve(ValueTable* table, int count);
+
+void markValueTable(ValueTable* table);
+
 //< init-table-h
 #endif
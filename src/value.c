@@ -109,6 +109,8 @@ bool valuesEqual(Value a, Value b) {
   if (IS_OBJ(a) && IS_OBJ(b)) {
     if (AS_OBJ(a)->type != AS_OBJ(b)->type) return false;
 
+    if (IS_STRING(a)) return stringsEqual(AS_STRING(a), AS_STRING(b));
+
     if (IS_LIST(a)) {
       ObjList* listA = AS_LIST(a);
       ObjList* listB = AS_LIST(b);
@@ -142,7 +144,11 @@ bool valuesEqual(Value a, Value b) {
     case VAL_NIL:    return true;
     case VAL_NUMBER: return AS_NUMBER(a) == AS_NUMBER(b);
 
-    case VAL_OBJ:    return AS_OBJ(a) == AS_OBJ(b);
+    case VAL_OBJ:
+      if (IS_STRING(a) && IS_STRING(b)) {
+        return stringsEqual(AS_STRING(a), AS_STRING(b));
+      }
+      return AS_OBJ(a) == AS_OBJ(b);
 //< Hash Tables equal
     default:         return false; // Unreachable.
   }
@@ -29,6 +29,7 @@ typedef struct ObjString ObjString;
 #define TAG_NIL   1 // 01.
 #define TAG_FALSE 2 // 10.
 #define TAG_TRUE  3 // 11.
+#define TAG_EMPTY 4 // 100.
 //< tags
 
 typedef uint64_t Value;
@@ -39,6 +40,7 @@ typedef uint64_t Value;
 //> is-nil
 #define IS_NIL(value)       ((value) == NIL_VAL)
 //< is-nil
+#define IS_EMPTY(value)     ((value) == EMPTY_VAL)
 #define IS_NUMBER(value)    (((value) & QNAN) != QNAN)
 //< is-number
 //> is-obj
@@ -68,6 +70,8 @@ typedef uint64_t Value;
 //> nil-val
 #define NIL_VAL         ((Value)(uint64_t)(QNAN | TAG_NIL))
 //< nil-val
+// Marks an unassigned variable slot, never visible to scripts.
+#define EMPTY_VAL       ((Value)(uint64_t)(QNAN | TAG_EMPTY))
 #define NUMBER_VAL(num) numToValue(num)
 //< number-val
 //> obj-val
@@ -99,6 +103,7 @@ typedef enum {
   VAL_BOOL,
   VAL_NIL, // [user-types]
   VAL_NUMBER,
+  VAL_EMPTY,
 //> Strings val-obj
   VAL_OBJ
 //< Strings val-obj
@@ -125,6 +130,7 @@ typedef struct {
 #define IS_BOOL(value)    ((value).type == VAL_BOOL)
 #define IS_NIL(value)     ((value).type == VAL_NIL)
 #define IS_NUMBER(value)  ((value).type == VAL_NUMBER)
+#define IS_EMPTY(value)   ((value).type == VAL_EMPTY)
 //> Strings is-obj
 #define IS_OBJ(value)     ((value).type == VAL_OBJ)
 //< Strings is-obj
@@ -142,6 +148,7 @@ typedef struct {
 #define BOOL_VAL(value)   ((Value){VAL_BOOL, {.boolean = value}})
 #define NIL_VAL           ((Value){VAL_NIL, {.number = 0}})
 #define NUMBER_VAL(value) ((Value){VAL_NUMBER, {.number = value}})
+#define EMPTY_VAL         ((Value){VAL_EMPTY, {.number = 0}})
 //> Strings obj-val
 #define OBJ_VAL(object)   ((Value){VAL_OBJ, {.obj = (Obj*)object}})
 //< Strings obj-val
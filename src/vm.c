@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "common.h"
+#include "bytecode.h"
 #include "compiler.h"
 #include "debug.h"
 #include "object.h"
@@ -17,23 +18,83 @@
 
 VM vm;
 
+#define TRACE_FRAMES_MAX 32
+
 static void resetStack() {
   vm.stackTop = vm.stack;
   vm.frameCount = 0;
   vm.openUpvalues = NULL;
+  vm.nativeCallDepth = 0;
+}
+
+// Both stacks live outside the GC heap, like the gray stack, so growing
+// them in the middle of a call never starts a collection.
+static void initStacks() {
+  vm.frameCapacity = FRAMES_INITIAL;
+  vm.frames = (CallFrame*)malloc(sizeof(CallFrame) * vm.frameCapacity);
+
+  vm.stackCapacity = STACK_INITIAL;
+  vm.stack = (Value*)malloc(sizeof(Value) * vm.stackCapacity);
+
+  if (vm.frames == NULL || vm.stack == NULL) exit(1);
+}
+
+static void growFrames() {
+  vm.frameCapacity = GROW_CAPACITY(vm.frameCapacity);
+  if (vm.frameCapacity > FRAMES_MAX) vm.frameCapacity = FRAMES_MAX;
+
+  vm.frames = (CallFrame*)realloc(vm.frames, sizeof(CallFrame) * vm.frameCapacity);
+  if (vm.frames == NULL) exit(1);
+}
+
+// Makes room for 'needed' more values above stackTop. The stack moves
+// when it grows, so the frame windows, the open upvalues and stackTop
+// are rebased onto the new block before the old one is freed.
+static void ensureStack(int needed) {
+  int used = (int)(vm.stackTop - vm.stack);
+  if (used + needed <= vm.stackCapacity) return;
+
+  int capacity = vm.stackCapacity;
+  while (capacity < used + needed) capacity *= 2;
+
+  Value* stack = (Value*)malloc(sizeof(Value) * capacity);
+  if (stack == NULL) exit(1);
+  memcpy(stack, vm.stack, sizeof(Value) * used);
+
+  for (int i = 0; i < vm.frameCount; i++) {
+    vm.frames[i].slots = stack + (vm.frames[i].slots - vm.stack);
+  }
+
+  for (ObjUpvalue* upvalue = vm.openUpvalues;
+       upvalue != NULL;
+       upvalue = upvalue->next) {
+    upvalue->location = stack + (upvalue->location - vm.stack);
+  }
+
+  free(vm.stack);
+  vm.stack = stack;
+  vm.stackTop = stack + used;
+  vm.stackCapacity = capacity;
 }
 
 
 void runtimeError(const char* format, ...) {
   fputs("\n", stderr);
   for (int i = vm.frameCount - 1; i >= 0; i--) {
+    // Deep recursion would bury the message, keep both ends of the trace.
+    if (vm.frameCount > TRACE_FRAMES_MAX && i == vm.frameCount - TRACE_FRAMES_MAX / 2 - 1) {
+      fprintf(stderr, "... %d more calls\n", vm.frameCount - TRACE_FRAMES_MAX);
+      i = TRACE_FRAMES_MAX / 2 - 1;
+    }
+
     CallFrame* frame = &vm.frames[i];
     ObjFunction* function = frame->closure->function;
 
-    size_t instruction = frame->ip - function->chunk.code - 1;
+    int instruction = (int)(frame->ip - function->chunk.code - 1);
+    SourceLocation location = getSourceLocation(&function->chunk, instruction);
 
     fprintf(stderr, "%s::", function->library->name->chars);
-    fprintf(stderr, "%d in ", function->chunk.lines[instruction]);
+    fprintf(stderr, "%d:%d in ", location.line, location.column);
     if (function->name != NULL) {
       fprintf(stderr, "%s()\n", function->name->chars);
     } else {
@@ -76,12 +137,10 @@ static char* resolveUse(ObjString* raw) {
   return api_ref;
 }
 
-ObjClosure* compileModule(ObjLibrary* library, char* source) {
-  ObjFunction* function = compile(source, library);
+ObjClosure* compileModule(ObjLibrary* library, char* path) {
+  ObjFunction* function = compileFile(path, library);
   pop(); //pop module.
 
-  FREE_ARRAY(char, source, strlen(source) + 1);
-
   if (function == NULL) {
     return NULL;
   }
@@ -105,26 +164,64 @@ void defineNative(const char* name, NativeFn function, Table* table) {
   pop();
 }
 
-void defineProperty(const char* name, Value value, Table* table) {
+void defineGlobalNative(const char* name, NativeFn function) {
+  ObjNative* native = newNative(function);
+  push(OBJ_VAL(native));
+
+  ObjString* nativeName = copyString(name, strlen(name));
+  push(OBJ_VAL(nativeName));
+
+  writeValueArray(&vm.globalValues, OBJ_VAL(native));
+  tableSet(&vm.globals, nativeName, NUMBER_VAL(vm.globalValues.count - 1));
+  pop();
+  pop();
+}
+
+void defineLibraryNative(const char* name, NativeFn function, ObjLibrary* library) {
+  ObjNative* native = newNative(function);
+  push(OBJ_VAL(native));
+
+  ObjString* nativeName = copyString(name, strlen(name));
+  push(OBJ_VAL(nativeName));
+
+  librarySet(library, nativeName, OBJ_VAL(native));
+  pop();
+  pop();
+}
+
+void defineLibraryProperty(const char* name, Value value, ObjLibrary* library) {
   push(value);
 
   ObjString* propertyName = copyString(name, strlen(name));
   push(OBJ_VAL(propertyName));
 
-  tableSet(table, propertyName, value);
+  librarySet(library, propertyName, value);
   pop();
   pop();
 }
 
 void initVM() {
 
+  initStacks();
   resetStack();
 
-  vm.objects = NULL;
-  vm.markVal = true;
+  initPool(&vm.pool);
 
   vm.bytesAllocated = 0;
-  vm.nextGC = 1024 * 1024;
+  vm.nextGC = GC_INITIAL_THRESHOLD;
+  vm.nextMinorGC = GC_NURSERY_SIZE;
+
+  vm.rememberedCount = 0;
+  vm.rememberedCapacity = 0;
+  vm.remembered = NULL;
+
+  vm.gcPhase = GC_IDLE;
+  vm.gcSliceBudget = GC_SLICE_BUDGET;
+  vm.gcMarkThreads = GC_MARK_THREADS;
+  vm.gcGrowFactor = GC_HEAP_GROW_FACTOR;
+  vm.heapLimit = 0;
+  memset(&vm.gcStats, 0, sizeof(GCStats));
+  vm.nextGCSlice = 0;
 
   vm.grayCount = 0;
   vm.grayCapacity = 0;
@@ -134,6 +231,7 @@ void initVM() {
 
 
   initTable(&vm.globals);
+  initValueArray(&vm.globalValues);
   initTable(&vm.libraries);
   initTable(&vm.strings);
 
@@ -141,12 +239,20 @@ void initVM() {
 
   //
   initTable(&vm.listNativeMethods);
+  initTable(&vm.mapNativeMethods);
+  initTable(&vm.setNativeMethods);
+  initTable(&vm.arrayNativeMethods);
+  initTable(&vm.builderNativeMethods);
   initTable(&vm.numberNativeMethods);
   initTable(&vm.stringNativeMethods);
   //
 
   //
   initListMethods();
+  initMapMethods();
+  initSetMethods();
+  initArrayMethods();
+  initBuilderMethods();
   initNumberMethods();
   initStringMethods();
   //
@@ -158,20 +264,39 @@ void initVM() {
 
 void freeVM() {
   freeTable(&vm.globals);
+  freeValueArray(&vm.globalValues);
   freeTable(&vm.strings);
   freeTable(&vm.libraries);
 
   //
   freeTable(&vm.listNativeMethods);
+  freeTable(&vm.mapNativeMethods);
+  freeTable(&vm.setNativeMethods);
+  freeTable(&vm.arrayNativeMethods);
+  freeTable(&vm.builderNativeMethods);
   freeTable(&vm.numberNativeMethods);
   freeTable(&vm.stringNativeMethods);
   //
 
   vm.initString = NULL;
   freeObjects();
+
+  free(vm.frames);
+  free(vm.stack);
+}
+
+// Every call reserves what its function can use, so running out means
+// a stack depth was measured wrong. The stack can't grow here, callers
+// still hold pointers into it, so the script stops.
+static void stackOverflow() {
+  runtimeError("Ran out of value stack.");
+  exit(70);
 }
+
 //> push
 void push(Value value) {
+  if (vm.stackTop == vm.stack + vm.stackCapacity) stackOverflow();
+
   *vm.stackTop = value;
   vm.stackTop++;
 }
@@ -185,7 +310,7 @@ static Value peek(int distance) {
   return vm.stackTop[-1 - distance];
 }
 
-static bool call(ObjClosure* closure, int argCount) {
+static bool checkArity(ObjClosure* closure, int argCount) {
   if (argCount != closure->function->arity) {
     const char* args = closure->function->arity == 1 ? "argument" : "arguments";
     runtimeError("Expected %d %s but got %d from '%s' call.", closure->function->arity, args, argCount,
@@ -193,6 +318,12 @@ static bool call(ObjClosure* closure, int argCount) {
     return false;
   }
 
+  return true;
+}
+
+static bool call(ObjClosure* closure, int argCount) {
+  if (!checkArity(closure, argCount)) return false;
+
 
   if (vm.frameCount == FRAMES_MAX) {
     runtimeError("Stack overflow.");
@@ -201,25 +332,17 @@ static bool call(ObjClosure* closure, int argCount) {
   }
 
 
-  CallFrame* frame = &vm.frames[vm.frameCount++];
+  if (vm.frameCount == vm.frameCapacity) growFrames();
 
-  frame->closure = closure;
-  frame->ip = closure->function->chunk.code;
-  frame->slots = vm.stackTop - argCount - 1;
-  return true;
-}
-
-static bool keepFrame(CallFrame* frame, int argCount) {
-  ObjClosure* closure = AS_CLOSURE(peek(argCount));
+  // The window starts below stackTop, so this is a little more than
+  // the frame can use.
+  ensureStack(closure->function->maxStack + STACK_SLACK);
 
-  if (argCount != closure->function->arity) {
-    runtimeError("Expected %d arguments but got %d.", closure->function->arity, argCount);
-    return false;
-  }
+  CallFrame* frame = &vm.frames[vm.frameCount++];
 
-  frame->slots = vm.stackTop - argCount - 1;
   frame->closure = closure;
   frame->ip = closure->function->chunk.code;
+  frame->slots = vm.stackTop - argCount - 1;
   return true;
 }
 
@@ -254,12 +377,14 @@ static bool keepFrame(CallFrame* frame, int argCount) {
       case OBJ_NATIVE: {
         NativeFn native = AS_NATIVE(callee);
         Value result = native(argCount, vm.stackTop - argCount);
-        vm.stackTop -= argCount + 1;
 
-        if (IS_NIL(result)) {
+        // NOTCLEAR, the error already reset the stack, leave stackTop
+        // alone.
+        if (IS_EMPTY(result)) {
           return false;
         }
 
+        vm.stackTop -= argCount + 1;
         push(result);
         return true;
       }
@@ -290,7 +415,7 @@ static bool callMethod(Value method, int argCount) {
   NativeFn native = AS_NATIVE(method);
   Value result = native(argCount, vm.stackTop - argCount - 1);
 
-  if (IS_NIL(result)) {
+  if (IS_EMPTY(result)) {
     return false;
   }
 
@@ -299,6 +424,63 @@ static bool callMethod(Value method, int argCount) {
   return true;
 }
 
+static inline CacheEntry* findCacheEntry(InlineCache* cache, Shape* shape) {
+  for (int i = 0; i < INLINE_CACHE_WAYS; i++) {
+    if (cache->entries[i].shapeId == shape->id) {
+      return &cache->entries[i];
+    }
+  }
+
+  return NULL;
+}
+
+static void updateCache(InlineCache* cache, uint32_t shapeId, int slot, Shape* transition) {
+  CacheEntry* entry = &cache->entries[cache->next];
+  cache->next = (cache->next + 1) % INLINE_CACHE_WAYS;
+
+  entry->shapeId = shapeId;
+  entry->slot = slot;
+  entry->transition = transition;
+}
+
+static inline bool getCachedField(InlineCache* cache, ObjInstance* instance,
+                                  ObjString* name, bool isPrivate, Value* value) {
+  CacheEntry* entry = findCacheEntry(cache, instance->shape);
+  if (entry != NULL) {
+    *value = instance->fields[entry->slot];
+    return true;
+  }
+
+  int slot = shapeFindSlot(instance->shape, name, isPrivate);
+  if (slot == -1) {
+    return false;
+  }
+
+  updateCache(cache, instance->shape->id, slot, NULL);
+  *value = instance->fields[slot];
+  return true;
+}
+
+// 'value' must be on the stack, growing the fields may collect.
+static inline void setCachedField(InlineCache* cache, ObjInstance* instance,
+                                  ObjString* name, bool isPrivate, Value value) {
+  CacheEntry* entry = findCacheEntry(cache, instance->shape);
+  if (entry != NULL) {
+    if (entry->transition != NULL) {
+      reserveInstanceFields(instance, entry->transition->slotCount);
+      instance->shape = entry->transition;
+    }
+
+    instance->fields[entry->slot] = value;
+    writeBarrier((Obj*)instance, value);
+    return;
+  }
+
+  Shape* shape = instance->shape;
+  int slot = instanceSetField(instance, name, isPrivate, value);
+  updateCache(cache, shape->id, slot, instance->shape != shape ? instance->shape : NULL);
+}
+
 static bool invokePrivate(ObjString* name, int argCount) {
   Value receiver = peek(argCount);
 
@@ -347,6 +529,46 @@ static bool invoke(ObjString* name, int argCount) {
         return false;
       }
 
+      case OBJ_MAP: {
+        Value value;
+        if (tableGet(&vm.mapNativeMethods, name, &value)) {
+          return callMethod(value, argCount);
+        }
+
+        runtimeError("Undefined method '%s' from map objects.", name->chars);
+        return false;
+      }
+
+      case OBJ_SET: {
+        Value value;
+        if (tableGet(&vm.setNativeMethods, name, &value)) {
+          return callMethod(value, argCount);
+        }
+
+        runtimeError("Undefined method '%s' from set objects.", name->chars);
+        return false;
+      }
+
+      case OBJ_ARRAY: {
+        Value value;
+        if (tableGet(&vm.arrayNativeMethods, name, &value)) {
+          return callMethod(value, argCount);
+        }
+
+        runtimeError("Undefined method '%s' from array objects.", name->chars);
+        return false;
+      }
+
+      case OBJ_STRING_BUILDER: {
+        Value value;
+        if (tableGet(&vm.builderNativeMethods, name, &value)) {
+          return callMethod(value, argCount);
+        }
+
+        runtimeError("Undefined method '%s' from stringBuilder objects.", name->chars);
+        return false;
+      }
+
       case OBJ_INSTANCE: {
         ObjInstance* instance = AS_INSTANCE(receiver);
         Value value;
@@ -357,7 +579,7 @@ static bool invoke(ObjString* name, int argCount) {
           return false;
         }
 
-        if (tableGet(&instance->fields, name, &value)) {
+        if (instanceGetField(instance, name, false, &value)) {
           vm.stackTop[-argCount - 1] = value;
           return callValue(value, argCount);
         }
@@ -381,7 +603,7 @@ static bool invoke(ObjString* name, int argCount) {
         ObjLibrary* library = AS_LIBRARY(receiver);
         Value value;
 
-        if (!tableGet(&library->values, name, &value)) {
+        if (!libraryGet(library, name, &value)) {
           runtimeError("Undefined method '%s' from '%s'.", name->chars, library->name->chars);
           info("It's either undefined or private");
           return false;
@@ -464,10 +686,29 @@ static void closeUpvalues(Value* last) {
     ObjUpvalue* upvalue = vm.openUpvalues;
     upvalue->closed = *upvalue->location;
     upvalue->location = &upvalue->closed;
+    writeBarrier((Obj*)upvalue, upvalue->closed);
     vm.openUpvalues = upvalue->next;
   }
 }
 
+// Reuses the current frame for a call in tail position. The callee's
+// slot and its arguments slide down over the caller's window, so the
+// frame count and the stack stay flat however deep the recursion goes.
+static bool tailCall(CallFrame* frame, ObjClosure* closure, int argCount) {
+  if (!checkArity(closure, argCount)) return false;
+
+  closeUpvalues(frame->slots);
+
+  memmove(frame->slots, vm.stackTop - argCount - 1,
+          sizeof(Value) * (argCount + 1));
+  vm.stackTop = frame->slots + argCount + 1;
+  ensureStack(closure->function->maxStack + STACK_SLACK);
+
+  frame->closure = closure;
+  frame->ip = closure->function->chunk.code;
+  return true;
+}
+
 static void defineMethod(ObjString* name, AccessLevel level) {
   Value method = peek(0);
   ObjClass* klass = AS_CLASS(peek(1));
@@ -476,6 +717,8 @@ static void defineMethod(ObjString* name, AccessLevel level) {
   } else {
     tableSet(&klass->privateMethods, name, method);
   }
+  writeBarrier((Obj*)klass, method);
+  writeBarrier((Obj*)klass, OBJ_VAL(name));
   pop();
 }
 
@@ -490,12 +733,20 @@ static void concatenate() {
 //< Garbage Collection concatenate-peek
 
   int length = a->length + b->length;
-  char* chars = ALLOCATE(char, length + 1);
-  memcpy(chars, a->chars, a->length);
-  memcpy(chars + a->length, b->chars, b->length);
-  chars[length] = '\0';
-
-  ObjString* result = takeString(chars, length);
+  ObjString* result;
+
+  if (length <= STRING_INTERN_MAX) {
+    // A short result is often interned already, looking it up first
+    // saves making a string only to drop it.
+    char chars[STRING_INTERN_MAX];
+    memcpy(chars, a->chars, a->length);
+    memcpy(chars + a->length, b->chars, b->length);
+    result = copyString(chars, length);
+  } else {
+    result = makeString(length);
+    memcpy(result->chars, a->chars, a->length);
+    memcpy(result->chars + a->length, b->chars, b->length);
+  }
 //> Garbage Collection concatenate-pop
   pop();
   pop();
@@ -503,24 +754,74 @@ static void concatenate() {
   push(OBJ_VAL(result));
 }
 
+// Sets the key and value pairs found from 'pairs' on the stack, which
+// stay there until the map holds them.
+static bool fillMap(ObjMap* map, Value* pairs, int pairCount) {
+  for (int i = 0; i < pairCount; i++) {
+    Value key = pairs[i * 2];
 
-static InterpretResult run() {
-  
+    if (!isHashable(key)) {
+      runtimeError("Type '%s' can not be a map key.", typeValue(key));
+      return false;
+    }
 
-  CallFrame* frame = &vm.frames[vm.frameCount - 1];
+    mapSet(map, key, pairs[i * 2 + 1]);
+  }
 
+  return true;
+}
+
+static bool mapSubscript(ObjMap* map, Value key, Value* value) {
+  if (!isHashable(key)) {
+    runtimeError("Type '%s' can not be a map key.", typeValue(key));
+    return false;
+  }
+
+  if (!mapGet(map, key, value)) {
+    runtimeError("Key not found in map.");
+    return false;
+  }
 
-#define READ_BYTE() (*frame->ip++)
+  return true;
+}
+
+// Runs until the frame count drops back to 'baseFrame', a nested run
+// from vmCall() stops once the frames it pushed are gone.
+static InterpretResult run(int baseFrame) {
+  CallFrame* frame;
+
+  register uint8_t* ip;
+  register Value* slots;
+  register Value* constants;
+
+#define LOAD_FRAME() \
+    do { \
+      frame = &vm.frames[vm.frameCount - 1]; \
+      ip = frame->ip; \
+      slots = frame->slots; \
+      constants = frame->closure->function->chunk.constants.values; \
+    } while (false)
+
+// 'ip' lives in a register, write it back before anything that
+// reads the frame (calls, runtime errors).
+#define STORE_FRAME() (frame->ip = ip)
+
+#define READ_BYTE() (*ip++)
 #define READ_SHORT() \
-    (frame->ip += 2, \
-    (uint16_t)((frame->ip[-2] << 8) | frame->ip[-1]))
+    (ip += 2, \
+    (uint16_t)((ip[-2] << 8) | ip[-1]))
 
-#define READ_CONSTANT() \
-    (frame->closure->function->chunk.constants.values[READ_BYTE()])
+#define READ_LONG() \
+    (ip += 3, \
+    (uint32_t)((ip[-3] << 16) | (ip[-2] << 8) | ip[-1]))
 
-#define READ_STRING() AS_STRING(READ_CONSTANT())
+#define READ_CONSTANT() (constants[READ_BYTE()])
+
+#define READ_CACHE() \
+    (&frame->closure->function->chunk.caches[READ_SHORT()])
 
 #define BINARY_ERROR_TYPES(op) \
+  STORE_FRAME(); \
   char* first = typeValue(peek(1)); \
   char* second = typeValue(peek(0)); \
   runtimeError("Operands must be numbers."); \
@@ -539,200 +840,420 @@ static InterpretResult run() {
       vm.stackTop[-1] = valueType(a op b); \
     } while (false)
 
-  for (;;) {
-//> trace-execution
 #ifdef DEBUG_TRACE_EXECUTION
-//> trace-stack
-    printf("          ");
-    for (Value* slot = vm.stack; slot < vm.stackTop; slot++) {
-      printf("[ ");
-      printValue(*slot);
-      printf(" ]");
-    }
-    printf("\n");
-//< trace-stack
+#define TRACE_EXECUTION() \
+    do { \
+      printf("          "); \
+      for (Value* slot = vm.stack; slot < vm.stackTop; slot++) { \
+        printf("[ "); \
+        printValue(*slot); \
+        printf(" ]"); \
+      } \
+      printf("\n"); \
+      disassembleInstruction(&frame->closure->function->chunk, \
+          (int)(ip - frame->closure->function->chunk.code)); \
+    } while (false)
+#else
+#define TRACE_EXECUTION() do { } while (false)
+#endif
 
-    disassembleInstruction(&frame->closure->function->chunk,
-        (int)(frame->ip - frame->closure->function->chunk.code));
-//< Closures disassemble-instruction
+#ifdef COMPUTED_GOTO
+  static void* dispatchTable[] = {
+    [OP_CONSTANT] = &&TARGET_OP_CONSTANT,
+    [OP_NIL] = &&TARGET_OP_NIL,
+    [OP_TRUE] = &&TARGET_OP_TRUE,
+    [OP_FALSE] = &&TARGET_OP_FALSE,
+    [OP_POP] = &&TARGET_OP_POP,
+    [OP_GET_LOCAL] = &&TARGET_OP_GET_LOCAL,
+    [OP_SET_LOCAL] = &&TARGET_OP_SET_LOCAL,
+    [OP_GET_GLOBAL] = &&TARGET_OP_GET_GLOBAL,
+    [OP_GET_UPVALUE] = &&TARGET_OP_GET_UPVALUE,
+    [OP_SET_UPVALUE] = &&TARGET_OP_SET_UPVALUE,
+    [OP_GET_PROPERTY] = &&TARGET_OP_GET_PROPERTY,
+    [OP_SET_PROPERTY] = &&TARGET_OP_SET_PROPERTY,
+    [OP_PRIVATE_PROPERTY_SET] = &&TARGET_OP_PRIVATE_PROPERTY_SET,
+    [OP_PRIVATE_GET_PROPERTY_NO_POP] = &&TARGET_OP_PRIVATE_GET_PROPERTY_NO_POP,
+    [OP_PRIVATE_PROPERTY_GET] = &&TARGET_OP_PRIVATE_PROPERTY_GET,
+    [OP_GET_PROPERTY_NO_POP] = &&TARGET_OP_GET_PROPERTY_NO_POP,
+    [OP_EQUAL] = &&TARGET_OP_EQUAL,
+    [OP_GREATER] = &&TARGET_OP_GREATER,
+    [OP_LESS] = &&TARGET_OP_LESS,
+    [OP_ADD] = &&TARGET_OP_ADD,
+    [OP_SUBTRACT] = &&TARGET_OP_SUBTRACT,
+    [OP_MULTIPLY] = &&TARGET_OP_MULTIPLY,
+    [OP_DIVIDE] = &&TARGET_OP_DIVIDE,
+    [OP_MOD] = &&TARGET_OP_MOD,
+    [OP_POW] = &&TARGET_OP_POW,
+    [OP_BIT_AND] = &&TARGET_OP_BIT_AND,
+    [OP_BIT_OR] = &&TARGET_OP_BIT_OR,
+    [OP_NOT] = &&TARGET_OP_NOT,
+    [OP_BREAK] = &&TARGET_OP_BREAK,
+    [OP_NEGATE] = &&TARGET_OP_NEGATE,
+    [OP_JUMP] = &&TARGET_OP_JUMP,
+    [OP_JUMP_IF_FALSE] = &&TARGET_OP_JUMP_IF_FALSE,
+    [OP_LOOP] = &&TARGET_OP_LOOP,
+    [OP_CALL] = &&TARGET_OP_CALL,
+    [OP_TAIL_CALL] = &&TARGET_OP_TAIL_CALL,
+    [OP_INVOKE] = &&TARGET_OP_INVOKE,
+    [OP_INVOKE1] = &&TARGET_OP_INVOKE1,
+    [OP_CLOSURE] = &&TARGET_OP_CLOSURE,
+    [OP_CLOSE_UPVALUE] = &&TARGET_OP_CLOSE_UPVALUE,
+    [OP_RETURN] = &&TARGET_OP_RETURN,
+    [OP_CLASS] = &&TARGET_OP_CLASS,
+    [OP_METHOD] = &&TARGET_OP_METHOD,
+    [OP_PRIVATE_METHOD] = &&TARGET_OP_PRIVATE_METHOD,
+    [OP_BUILD_LIST] = &&TARGET_OP_BUILD_LIST,
+    [OP_EXTEND_LIST] = &&TARGET_OP_EXTEND_LIST,
+    [OP_BUILD_MAP] = &&TARGET_OP_BUILD_MAP,
+    [OP_EXTEND_MAP] = &&TARGET_OP_EXTEND_MAP,
+    [OP_INDEX_SUBSCR] = &&TARGET_OP_INDEX_SUBSCR,
+    [OP_STORE_SUBSCR] = &&TARGET_OP_STORE_SUBSCR,
+    [OP_INDEX_SUBSCR_NO_POP] = &&TARGET_OP_INDEX_SUBSCR_NO_POP,
+    [OP_USE] = &&TARGET_OP_USE,
+    [OP_RECENT_USE] = &&TARGET_OP_RECENT_USE,
+    [OP_USE_BUILTIN] = &&TARGET_OP_USE_BUILTIN,
+    [OP_USE_NAME] = &&TARGET_OP_USE_NAME,
+    [OP_INCREMENT] = &&TARGET_OP_INCREMENT,
+    [OP_DECREMENT] = &&TARGET_OP_DECREMENT,
+    [OP_BIT_LEFT] = &&TARGET_OP_BIT_LEFT,
+    [OP_BIT_RIGHT] = &&TARGET_OP_BIT_RIGHT,
+    [OP_BIT_XOR] = &&TARGET_OP_BIT_XOR,
+    [OP_ASSERT] = &&TARGET_OP_ASSERT,
+    [OP_DEFINE_LIBRARY] = &&TARGET_OP_DEFINE_LIBRARY,
+    [OP_GET_LIBRARY] = &&TARGET_OP_GET_LIBRARY,
+    [OP_SET_LIBRARY] = &&TARGET_OP_SET_LIBRARY,
+    [OP_PRIVATE_DEFINE] = &&TARGET_OP_PRIVATE_DEFINE,
+    [OP_PRIVATE_GET] = &&TARGET_OP_PRIVATE_GET,
+    [OP_PRIVATE_SET] = &&TARGET_OP_PRIVATE_SET,
+    [OP_ADD_LOCALS] = &&TARGET_OP_ADD_LOCALS,
+    [OP_SUBTRACT_LOCALS] = &&TARGET_OP_SUBTRACT_LOCALS,
+    [OP_ADD_LOCAL_CONSTANT] = &&TARGET_OP_ADD_LOCAL_CONSTANT,
+    [OP_SUBTRACT_LOCAL_CONSTANT] = &&TARGET_OP_SUBTRACT_LOCAL_CONSTANT,
+    [OP_EQUAL_JUMP] = &&TARGET_OP_EQUAL_JUMP,
+    [OP_GREATER_JUMP] = &&TARGET_OP_GREATER_JUMP,
+    [OP_LESS_JUMP] = &&TARGET_OP_LESS_JUMP,
+    [OP_LESS_LOCAL_CONSTANT_JUMP] = &&TARGET_OP_LESS_LOCAL_CONSTANT_JUMP,
+    [OP_INCREMENT_LOCAL] = &&TARGET_OP_INCREMENT_LOCAL,
+    [OP_DECREMENT_LOCAL] = &&TARGET_OP_DECREMENT_LOCAL,
+    [OP_CONSTANT_LONG] = &&TARGET_OP_CONSTANT_LONG,
+    [OP_GET_GLOBAL_LONG] = &&TARGET_OP_GET_GLOBAL_LONG,
+    [OP_DEFINE_LIBRARY_LONG] = &&TARGET_OP_DEFINE_LIBRARY_LONG,
+    [OP_GET_LIBRARY_LONG] = &&TARGET_OP_GET_LIBRARY_LONG,
+    [OP_SET_LIBRARY_LONG] = &&TARGET_OP_SET_LIBRARY_LONG,
+    [OP_PRIVATE_DEFINE_LONG] = &&TARGET_OP_PRIVATE_DEFINE_LONG,
+    [OP_PRIVATE_GET_LONG] = &&TARGET_OP_PRIVATE_GET_LONG,
+    [OP_PRIVATE_SET_LONG] = &&TARGET_OP_PRIVATE_SET_LONG,
+    [OP_GET_PROPERTY_LONG] = &&TARGET_OP_GET_PROPERTY_LONG,
+    [OP_SET_PROPERTY_LONG] = &&TARGET_OP_SET_PROPERTY_LONG,
+    [OP_GET_PROPERTY_NO_POP_LONG] = &&TARGET_OP_GET_PROPERTY_NO_POP_LONG,
+    [OP_PRIVATE_PROPERTY_GET_LONG] = &&TARGET_OP_PRIVATE_PROPERTY_GET_LONG,
+    [OP_PRIVATE_PROPERTY_SET_LONG] = &&TARGET_OP_PRIVATE_PROPERTY_SET_LONG,
+    [OP_PRIVATE_GET_PROPERTY_NO_POP_LONG] = &&TARGET_OP_PRIVATE_GET_PROPERTY_NO_POP_LONG,
+    [OP_INVOKE_LONG] = &&TARGET_OP_INVOKE_LONG,
+    [OP_INVOKE1_LONG] = &&TARGET_OP_INVOKE1_LONG,
+    [OP_CLOSURE_LONG] = &&TARGET_OP_CLOSURE_LONG,
+    [OP_CLASS_LONG] = &&TARGET_OP_CLASS_LONG,
+    [OP_METHOD_LONG] = &&TARGET_OP_METHOD_LONG,
+    [OP_PRIVATE_METHOD_LONG] = &&TARGET_OP_PRIVATE_METHOD_LONG,
+    [OP_USE_LONG] = &&TARGET_OP_USE_LONG,
+    [OP_USE_BUILTIN_LONG] = &&TARGET_OP_USE_BUILTIN_LONG,
+    [OP_ASSERT_LONG] = &&TARGET_OP_ASSERT_LONG,
+  };
+
+#define INTERPRET_LOOP DISPATCH();
+#define CASE(name) TARGET_##name
+#define DISPATCH() \
+    do { \
+      TRACE_EXECUTION(); \
+      goto *dispatchTable[instruction = READ_BYTE()]; \
+    } while (false)
+#else
+#define INTERPRET_LOOP \
+    loop: \
+      TRACE_EXECUTION(); \
+      switch (instruction = READ_BYTE())
+#define CASE(name) case name
+#define DISPATCH() goto loop
 #endif
 
-//< trace-execution
-    uint8_t instruction;
-    switch (instruction = READ_BYTE()) {
+  uint8_t instruction;
+
+  // Constant or slot index of the instructions that have a long form.
+  uint32_t operand;
+  LOAD_FRAME();
+
+  INTERPRET_LOOP {
 //> op-constant
-      case OP_CONSTANT: {
-        Value constant = READ_CONSTANT();
+      CASE(OP_CONSTANT_LONG):
+        operand = READ_LONG();
+        goto constantOp;
+
+      CASE(OP_CONSTANT):
+        operand = READ_BYTE();
+      constantOp: {
+        Value constant = constants[operand];
 
         push(constant);
 //< push-constant
-        break;
+        DISPATCH();
       }
 //< op-constant
 //> Types of Values interpret-literals
-      case OP_NIL: push(NIL_VAL); break;
-      case OP_TRUE: push(BOOL_VAL(true)); break;
-      case OP_FALSE: push(BOOL_VAL(false)); break;
+      CASE(OP_NIL): push(NIL_VAL); DISPATCH();
+      CASE(OP_TRUE): push(BOOL_VAL(true)); DISPATCH();
+      CASE(OP_FALSE): push(BOOL_VAL(false)); DISPATCH();
 
-      case OP_POP: pop(); break;
+      CASE(OP_POP): pop(); DISPATCH();
 
-      case OP_GET_LOCAL: {
+      CASE(OP_GET_LOCAL): {
         uint8_t slot = READ_BYTE();
-        push(frame->slots[slot]);
-        break;
+        push(slots[slot]);
+        DISPATCH();
       }
 
-      case OP_SET_LOCAL: {
+      CASE(OP_SET_LOCAL): {
         uint8_t slot = READ_BYTE();
-        frame->slots[slot] = peek(0);
-        break;
+        slots[slot] = peek(0);
+        DISPATCH();
       }
 
-      case OP_GET_LIBRARY: {
-        ObjString* name = READ_STRING();
-        Value value;
-        if (!tableGet(&frame->closure->function->library->values, name, &value)) {
-          runtimeError("Undefined variable '%s'.", name->chars);
+      CASE(OP_GET_LIBRARY_LONG):
+        operand = READ_LONG();
+        goto getLibraryOp;
+
+      CASE(OP_GET_LIBRARY):
+        operand = READ_BYTE();
+      getLibraryOp: {
+        uint32_t slot = operand;
+        ObjLibrary* library = frame->closure->function->library;
+        Value value = library->slots.values[slot];
+        if (IS_EMPTY(value)) {
+          STORE_FRAME();
+          runtimeError("Undefined variable '%s'.", librarySlotName(library, slot)->chars);
           return INTERPRET_RUNTIME_ERROR;
         }
         push(value);
-        break;
+        DISPATCH();
       }
 
-      case OP_PRIVATE_DEFINE: {
-        ObjString* name = READ_STRING();
-        tableSet(&frame->closure->function->library->privateValues, name, peek(0));
+      CASE(OP_PRIVATE_DEFINE_LONG):
+        operand = READ_LONG();
+        goto privateDefineOp;
+
+      CASE(OP_PRIVATE_DEFINE):
+        operand = READ_BYTE();
+      privateDefineOp: {
+        uint32_t slot = operand;
+        ObjLibrary* library = frame->closure->function->library;
+        library->slots.values[slot] = peek(0);
+        writeBarrier((Obj*)library, peek(0));
         pop();
-        break;
+        DISPATCH();
       }
 
-      case OP_PRIVATE_GET: {
-        ObjString* name = READ_STRING();
-        Value value;
-        tableGet(&frame->closure->function->library->privateValues, name, &value);
+      CASE(OP_PRIVATE_GET_LONG):
+        operand = READ_LONG();
+        goto privateGetOp;
+
+      CASE(OP_PRIVATE_GET):
+        operand = READ_BYTE();
+      privateGetOp: {
+        uint32_t slot = operand;
+        ObjLibrary* library = frame->closure->function->library;
+        Value value = library->slots.values[slot];
+        if (IS_EMPTY(value)) {
+          STORE_FRAME();
+          runtimeError("Undefined variable '%s'.", librarySlotName(library, slot)->chars);
+          return INTERPRET_RUNTIME_ERROR;
+        }
         push(value);
-        break;
+        DISPATCH();
       }
 
-      case OP_PRIVATE_SET: {
-        ObjString* name = READ_STRING();
-        tableSet(&frame->closure->function->library->privateValues, name, peek(0));
-        break;
+      CASE(OP_PRIVATE_SET_LONG):
+        operand = READ_LONG();
+        goto privateSetOp;
+
+      CASE(OP_PRIVATE_SET):
+        operand = READ_BYTE();
+      privateSetOp: {
+        uint32_t slot = operand;
+        ObjLibrary* library = frame->closure->function->library;
+        library->slots.values[slot] = peek(0);
+        writeBarrier((Obj*)library, peek(0));
+        DISPATCH();
       }
 
-      case OP_DEFINE_LIBRARY: {
-        ObjString* name = READ_STRING();
-        tableSet(&frame->closure->function->library->values, name, peek(0));
+      CASE(OP_DEFINE_LIBRARY_LONG):
+        operand = READ_LONG();
+        goto defineLibraryOp;
+
+      CASE(OP_DEFINE_LIBRARY):
+        operand = READ_BYTE();
+      defineLibraryOp: {
+        uint32_t slot = operand;
+        ObjLibrary* library = frame->closure->function->library;
+        library->slots.values[slot] = peek(0);
+        writeBarrier((Obj*)library, peek(0));
         pop();
-        break;
+        DISPATCH();
       }
 
-      case OP_GET_GLOBAL: {
-        ObjString* name = READ_STRING();
-        Value value;
-        if (!tableGet(&vm.globals, name, &value)) {
-          runtimeError("Undefined variable '%s'.", name->chars);
-          return INTERPRET_RUNTIME_ERROR;
-        }
-        push(value);
-        break;
+      CASE(OP_GET_GLOBAL_LONG):
+        operand = READ_LONG();
+        goto getGlobalOp;
+
+      CASE(OP_GET_GLOBAL):
+        operand = READ_BYTE();
+      getGlobalOp: {
+        push(vm.globalValues.values[operand]);
+        DISPATCH();
       }
 
-      case OP_SET_LIBRARY: {
-        ObjString* name = READ_STRING();
-        if (tableSet(&frame->closure->function->library->values, name, peek(0))) {
-          tableDelete(&frame->closure->function->library->values, name); // [delete]
-          runtimeError("Undefined variable '%s'.", name->chars);
+      CASE(OP_SET_LIBRARY_LONG):
+        operand = READ_LONG();
+        goto setLibraryOp;
+
+      CASE(OP_SET_LIBRARY):
+        operand = READ_BYTE();
+      setLibraryOp: {
+        uint32_t slot = operand;
+        ObjLibrary* library = frame->closure->function->library;
+        if (IS_EMPTY(library->slots.values[slot])) {
+          STORE_FRAME();
+          runtimeError("Undefined variable '%s'.", librarySlotName(library, slot)->chars);
           return INTERPRET_RUNTIME_ERROR;
         }
-        break;
+        library->slots.values[slot] = peek(0);
+        writeBarrier((Obj*)library, peek(0));
+        DISPATCH();
       }
 
-      case OP_GET_UPVALUE: {
+      CASE(OP_GET_UPVALUE): {
         uint8_t slot = READ_BYTE();
         push(*frame->closure->upvalues[slot]->location);
-        break;
+        DISPATCH();
       }
 
-      case OP_SET_UPVALUE: {
+      CASE(OP_SET_UPVALUE): {
         uint8_t slot = READ_BYTE();
-        *frame->closure->upvalues[slot]->location = peek(0);
-        break;
+        ObjUpvalue* upvalue = frame->closure->upvalues[slot];
+        *upvalue->location = peek(0);
+        writeBarrier((Obj*)upvalue, peek(0));
+        DISPATCH();
       }
 
-      case OP_GET_PROPERTY_NO_POP: {
+      CASE(OP_GET_PROPERTY_NO_POP_LONG):
+        operand = READ_LONG();
+        goto getPropertyNoPopOp;
+
+      CASE(OP_GET_PROPERTY_NO_POP):
+        operand = READ_BYTE();
+      getPropertyNoPopOp: {
+        ObjString* name = AS_STRING(constants[operand]);
+        InlineCache* cache = READ_CACHE();
+
         if (!IS_INSTANCE(peek(0))) {
+          STORE_FRAME();
           runtimeError("Only instances can have properties.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         ObjInstance* instance = AS_INSTANCE(peek(0));
-        ObjString* name = READ_STRING();
         Value val;
 
-        if (tableGet(&instance->fields, name, &val)) {
+        if (getCachedField(cache, instance, name, false, &val)) {
           push(val);
-          break;
+          DISPATCH();
         }
 
+        STORE_FRAME();
         if (!bindMethod(instance->klass, name)) {
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        break;
+        DISPATCH();
       }
 
-      case OP_PRIVATE_PROPERTY_GET: {
+      CASE(OP_PRIVATE_PROPERTY_GET_LONG):
+        operand = READ_LONG();
+        goto privatePropertyGetOp;
+
+      CASE(OP_PRIVATE_PROPERTY_GET):
+        operand = READ_BYTE();
+      privatePropertyGetOp: {
+        ObjString* name = AS_STRING(constants[operand]);
+        InlineCache* cache = READ_CACHE();
+
         if (!IS_INSTANCE(peek(0))) {
+          STORE_FRAME();
           runtimeError("Only instances can have private properties.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         ObjInstance* instance = AS_INSTANCE(peek(0));
-        ObjString* name = READ_STRING();
         Value val;
 
-        if (tableGet(&instance->privateFields, name, &val)) {
-          pop();
-          push(val);
-          break;
+        if (getCachedField(cache, instance, name, true, &val)) {
+          vm.stackTop[-1] = val;
+          DISPATCH();
         }
 
+        STORE_FRAME();
         if (!bindMethod(instance->klass, name)) {
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        break;
+        DISPATCH();
       }
 
-      case OP_PRIVATE_GET_PROPERTY_NO_POP: {
+      CASE(OP_PRIVATE_GET_PROPERTY_NO_POP_LONG):
+        operand = READ_LONG();
+        goto privateGetPropertyNoPopOp;
+
+      CASE(OP_PRIVATE_GET_PROPERTY_NO_POP):
+        operand = READ_BYTE();
+      privateGetPropertyNoPopOp: {
+        ObjString* name = AS_STRING(constants[operand]);
+        InlineCache* cache = READ_CACHE();
+
         if (!IS_INSTANCE(peek(0))) {
+          STORE_FRAME();
           runtimeError("Only instances can have private properties.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         ObjInstance* instance = AS_INSTANCE(peek(0));
-        ObjString* name = READ_STRING();
         Value val;
 
-        if (tableGet(&instance->privateFields, name, &val)) {
+        if (getCachedField(cache, instance, name, true, &val)) {
           push(val);
-          break;
+          DISPATCH();
         }
 
+        STORE_FRAME();
         if (!bindMethod(instance->klass, name)) {
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        break;
+        DISPATCH();
       }
 
-      case OP_GET_PROPERTY: {
+      CASE(OP_GET_PROPERTY_LONG):
+        operand = READ_LONG();
+        goto getPropertyOp;
+
+      CASE(OP_GET_PROPERTY):
+        operand = READ_BYTE();
+      getPropertyOp: {
         Value receiver = peek(0);
+        ObjString* name = AS_STRING(constants[operand]);
+        InlineCache* cache = READ_CACHE();
 
         if (!IS_OBJ(receiver)) {
+          STORE_FRAME();
           runtimeError("Type '%s' can not have properties", typeValue(receiver));
-          info("The property that was tried to get accessed is '%s'", READ_STRING()->chars);          
+          info("The property that was tried to get accessed is '%s'", name->chars);
           info("Only instances and libraries can have properties.");
           return INTERPRET_RUNTIME_ERROR;
         }
@@ -740,15 +1261,14 @@ static InterpretResult run() {
         switch(OBJ_TYPE(receiver)) {
           case OBJ_INSTANCE: {
             ObjInstance* instance = AS_INSTANCE(receiver);
-            ObjString* name = READ_STRING();
             
             Value value;
-            if (tableGet(&instance->fields, name, &value)) {
-              pop();
-              push(value);
+            if (getCachedField(cache, instance, name, false, &value)) {
+              vm.stackTop[-1] = value;
               break;
             }
 
+            STORE_FRAME();
             if (!bindMethod(instance->klass, name)) {
               return INTERPRET_RUNTIME_ERROR;
             }
@@ -758,47 +1278,68 @@ static InterpretResult run() {
 
           case OBJ_LIBRARY: {
             ObjLibrary* library = AS_LIBRARY(receiver);
-            ObjString* name = READ_STRING();
             
             Value value;
 
-            if (tableGet(&library->values, name, &value)) {
+            if (libraryGet(library, name, &value)) {
               pop();
               push(value);
               break;
             }
 
+            STORE_FRAME();
             runtimeError("Undefined property '%s' from '%s'", name->chars, library->name->chars);
             info("It's either undefined or private");
             return INTERPRET_RUNTIME_ERROR;
           }
 
           default:
+            STORE_FRAME();
             runtimeError("Type '%s' has no properties.", typeValue(receiver));
             return INTERPRET_RUNTIME_ERROR;
 
         }
 
-        break;
+        DISPATCH();
       }
 
 
-      case OP_PRIVATE_PROPERTY_SET: {
+      CASE(OP_PRIVATE_PROPERTY_SET_LONG):
+        operand = READ_LONG();
+        goto privatePropertySetOp;
+
+      CASE(OP_PRIVATE_PROPERTY_SET):
+        operand = READ_BYTE();
+      privatePropertySetOp: {
+        ObjString* name = AS_STRING(constants[operand]);
+        InlineCache* cache = READ_CACHE();
+
         if (IS_INSTANCE(peek(1))) {
           ObjInstance* instance = AS_INSTANCE(peek(1));
-          tableSet(&instance->privateFields, READ_STRING(), peek(0));
+          setCachedField(cache, instance, name, true, peek(0));
           Value value = pop(); //result
           pop();
           push(value);
-          break;
+          DISPATCH();
         }
 
+        STORE_FRAME();
         runtimeError("Type '%s' has no private properties.", typeValue(peek(1)));
         return INTERPRET_RUNTIME_ERROR;
       }
 
-      case OP_SET_PROPERTY: {
+      CASE(OP_SET_PROPERTY_LONG):
+        operand = READ_LONG();
+        goto setPropertyOp;
+
+      CASE(OP_SET_PROPERTY):
+        operand = READ_BYTE();
+      setPropertyOp: {
+        ObjString* name = AS_STRING(constants[operand]);
+        InlineCache* cache = READ_CACHE();
+
         if (!IS_OBJ(peek(1))) {
+          STORE_FRAME();
           runtimeError("Type '%s' can not have fields", typeValue(peek(1)));
           info("Only instances can have fields.");
           return INTERPRET_RUNTIME_ERROR;
@@ -806,31 +1347,33 @@ static InterpretResult run() {
 
         if (IS_INSTANCE(peek(1))) {
           ObjInstance* instance = AS_INSTANCE(peek(1));
-          tableSet(&instance->fields, READ_STRING(), peek(0));
+          setCachedField(cache, instance, name, false, peek(0));
           Value value = pop();
           pop();
           push(value);
-          break;
+          DISPATCH();
         }
 
+        STORE_FRAME();
         runtimeError("Type '%s' has no properties.", typeValue(peek(1)));
         return INTERPRET_RUNTIME_ERROR;
       }
 
-      case OP_BIT_LEFT:   BINARY_OP(NUMBER_VAL, <<, int); break;
-      case OP_BIT_RIGHT:  BINARY_OP(NUMBER_VAL, >>, int); break;
-      case OP_BIT_XOR:    BINARY_OP(NUMBER_VAL, ^, int); break;
+      CASE(OP_BIT_LEFT):   BINARY_OP(NUMBER_VAL, <<, int); DISPATCH();
+      CASE(OP_BIT_RIGHT):  BINARY_OP(NUMBER_VAL, >>, int); DISPATCH();
+      CASE(OP_BIT_XOR):    BINARY_OP(NUMBER_VAL, ^, int); DISPATCH();
 
-      case OP_EQUAL: {
+      CASE(OP_EQUAL): {
         Value b = pop();
         Value a = peek(0);
 
         vm.stackTop[-1] = BOOL_VAL(valuesEqual(a, b));
-        break;
+        DISPATCH();
       }
-      case OP_GREATER:  BINARY_OP(BOOL_VAL, >, double); break;
-      case OP_LESS:     BINARY_OP(BOOL_VAL, <, double); break;
-      case OP_ADD: {
+      CASE(OP_GREATER):  BINARY_OP(BOOL_VAL, >, double); DISPATCH();
+      CASE(OP_LESS):     BINARY_OP(BOOL_VAL, <, double); DISPATCH();
+      CASE(OP_ADD):
+      add: {
         if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
           concatenate();
         } else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
@@ -838,15 +1381,16 @@ static InterpretResult run() {
           double a = AS_NUMBER(peek(0));
           vm.stackTop[-1] = NUMBER_VAL(a + b);
         } else {
+          STORE_FRAME();
           runtimeError("Operands must be either two numbers or two strings.");
           return INTERPRET_RUNTIME_ERROR;
         }
-        break;
+        DISPATCH();
       }
 
-      case OP_BIT_AND: BINARY_OP(NUMBER_VAL, &, int); break;
-      case OP_BIT_OR: BINARY_OP(NUMBER_VAL, |, int); break;
-      case OP_MOD: {
+      CASE(OP_BIT_AND): BINARY_OP(NUMBER_VAL, &, int); DISPATCH();
+      CASE(OP_BIT_OR): BINARY_OP(NUMBER_VAL, |, int); DISPATCH();
+      CASE(OP_MOD): {
         if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
           BINARY_ERROR_TYPES(%);
           return INTERPRET_RUNTIME_ERROR;
@@ -856,10 +1400,10 @@ static InterpretResult run() {
         double a = AS_NUMBER(peek(0));
 
         vm.stackTop[-1] = NUMBER_VAL(fmod(a,b));
-        break;
+        DISPATCH();
       }
 
-      case OP_POW: {
+      CASE(OP_POW): {
         if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
           BINARY_ERROR_TYPES(**);
           return INTERPRET_RUNTIME_ERROR;
@@ -869,12 +1413,12 @@ static InterpretResult run() {
         double a = AS_NUMBER(peek(0));
 
         vm.stackTop[-1] = NUMBER_VAL(powf(a,b));
-        break;
+        DISPATCH();
       }
 
-      case OP_SUBTRACT: BINARY_OP(NUMBER_VAL, -, double); break;
-      case OP_MULTIPLY: BINARY_OP(NUMBER_VAL, *, double); break;
-      case OP_DIVIDE: {
+      CASE(OP_SUBTRACT): BINARY_OP(NUMBER_VAL, -, double); DISPATCH();
+      CASE(OP_MULTIPLY): BINARY_OP(NUMBER_VAL, *, double); DISPATCH();
+      CASE(OP_DIVIDE): {
         if (!IS_NUMBER(peek(0)) || !IS_NUMBER(peek(1))) {
           BINARY_ERROR_TYPES(/);
           return INTERPRET_RUNTIME_ERROR;
@@ -884,140 +1428,155 @@ static InterpretResult run() {
         double a = AS_NUMBER(peek(0));
 
         if (a == 0 || b == 0) {
+          STORE_FRAME();
           runtimeError("Can not divide by 0.");
           info("What???");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         vm.stackTop[-1] = NUMBER_VAL(a / b);
-        break;
+        DISPATCH();
       }
       
-      case OP_NOT:
+      CASE(OP_NOT):
         vm.stackTop[-1] = BOOL_VAL(isFalsey( peek(0) ));
-        break;
+        DISPATCH();
 
 
-      case OP_NEGATE: {
+      CASE(OP_NEGATE): {
         if (!IS_NUMBER(peek(0))) {
+          STORE_FRAME();
           runtimeError("Operand must be a number.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         Value negated = NUMBER_VAL( -AS_NUMBER(peek(0)) );
         vm.stackTop[-1] = negated;
-        break;
+        DISPATCH();
       }
 
-      case OP_ASSERT: {
+      CASE(OP_ASSERT_LONG):
+        operand = READ_LONG();
+        goto assertOp;
+
+      CASE(OP_ASSERT):
+        operand = READ_BYTE();
+      assertOp: {
         Value condition = pop();
-        ObjString* error = READ_STRING();
+        ObjString* error = AS_STRING(constants[operand]);
 
         if (isFalsey(condition)) {
+          STORE_FRAME();
           runtimeError("%s %s", "Assertion Failed:", error->chars);
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        break;
+        DISPATCH();
       }
 
-      case OP_JUMP: {
+      CASE(OP_JUMP): {
         uint16_t offset = READ_SHORT();
-        frame->ip += offset;
-        break;
+        ip += offset;
+        DISPATCH();
       }
 
-      case OP_JUMP_IF_FALSE: {
+      CASE(OP_JUMP_IF_FALSE): {
         uint16_t offset = READ_SHORT();
 
-        if (isFalsey(peek(0))) frame->ip += offset;
-        break;
+        if (isFalsey(peek(0))) ip += offset;
+        DISPATCH();
       }
 
-      case OP_LOOP: {
+      CASE(OP_LOOP): {
         uint16_t offset = READ_SHORT();
 
-        frame->ip -= offset;
-        break;
+        ip -= offset;
+        DISPATCH();
       }
 
-      case OP_CALL: {
+      CASE(OP_CALL): {
         int argCount = READ_BYTE();
 
+        STORE_FRAME();
         if (!callValue(peek(argCount), argCount)) {
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        frame = &vm.frames[vm.frameCount - 1];
-        break;
+        LOAD_FRAME();
+        DISPATCH();
       }
 
-      //POLISH
-      case OP_TAIL_CALL: {
+      CASE(OP_TAIL_CALL): {
         int argCount = READ_BYTE();
+        Value callee = peek(argCount);
+        STORE_FRAME();
 
-        //function B args
-        ValueArray args;
-        initValueArray(&args);
-        for (int i = 0; i < argCount; i++) {
-          writeValueArray(&args, pop());
-        }
-        //function B
-        Value function = pop();
-
-        //function A args
-        int argCount_A = frame->closure->function->arity;
-        for (int i = 0; i < argCount_A; i++) {
-          pop();
-        }
-        //function A
-        pop();
-
-        //function B took position of function A
-        push(function);
-        //re-position args
-        //push them in reverse to obtain their original order.
-        for (int i = argCount - 1; i >= 0; i--) {
-          push(args.values[i]);
-        }
-
-        //No need anymore.
-        freeValueArray(&args);
-
-        //Jump
-        if (!keepFrame(frame, argCount)) {
+        if (IS_BOUND_METHOD(callee)) {
+          ObjBoundMethod* bound = AS_BOUND_METHOD(callee);
+          vm.stackTop[-argCount - 1] = bound->receiver;
+          if (!tailCall(frame, bound->method, argCount)) {
+            return INTERPRET_RUNTIME_ERROR;
+          }
+        } else if (IS_CLOSURE(callee)) {
+          if (!tailCall(frame, AS_CLOSURE(callee), argCount)) {
+            return INTERPRET_RUNTIME_ERROR;
+          }
+        } else if (!callValue(callee, argCount)) {
+          // Natives and classes get an ordinary call, the OP_RETURN
+          // after this instruction hands their result back.
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        break;
+        LOAD_FRAME();
+        DISPATCH();
       }
 
-      case OP_INVOKE1: {
+      CASE(OP_INVOKE1_LONG):
+        operand = READ_LONG();
+        goto invoke1Op;
+
+      CASE(OP_INVOKE1):
+        operand = READ_BYTE();
+      invoke1Op: {
+        ObjString* method = AS_STRING(constants[operand]);
         int argCount = READ_BYTE();
-        ObjString* method = READ_STRING();
 
+        STORE_FRAME();
         if (!invokePrivate(method, argCount)) {
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        frame = &vm.frames[vm.frameCount - 1];
-        break;
+        LOAD_FRAME();
+        DISPATCH();
       }
 
-      case OP_INVOKE: {
+      CASE(OP_INVOKE_LONG):
+        operand = READ_LONG();
+        goto invokeOp;
+
+      CASE(OP_INVOKE):
+        operand = READ_BYTE();
+      invokeOp: {
+        ObjString* method = AS_STRING(constants[operand]);
         int argCount = READ_BYTE();
-        ObjString* method = READ_STRING();
 
+        STORE_FRAME();
         if (!invoke(method, argCount)) {
           return INTERPRET_RUNTIME_ERROR;
         }
 
-        frame = &vm.frames[vm.frameCount - 1];
-        break;
+        LOAD_FRAME();
+        DISPATCH();
       }
 
-      case OP_CLOSURE: {
-        ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+      CASE(OP_CLOSURE_LONG):
+        operand = READ_LONG();
+        goto closureOp;
+
+      CASE(OP_CLOSURE):
+        operand = READ_BYTE();
+      closureOp: {
+        ObjFunction* function = AS_FUNCTION(constants[operand]);
         ObjClosure* closure = newClosure(function);
         push(OBJ_VAL(closure));
         for (int i = 0; i < closure->upvalueCount; i++) {
@@ -1025,78 +1584,161 @@ static InterpretResult run() {
           uint8_t index = READ_BYTE();
           if (isLocal) {
             closure->upvalues[i] =
-                captureUpvalue(frame->slots + index);
+                captureUpvalue(slots + index);
           } else {
             closure->upvalues[i] = frame->closure->upvalues[index];
           }
+          writeBarrier((Obj*)closure, OBJ_VAL(closure->upvalues[i]));
         }
-        break;
+        DISPATCH();
       }
 
-      case OP_CLOSE_UPVALUE:
+      CASE(OP_CLOSE_UPVALUE):
         closeUpvalues(vm.stackTop - 1);
         pop();
-        break;
+        DISPATCH();
 
 
-      case OP_RETURN: {
+      CASE(OP_RETURN): {
         Value result = pop();
-        closeUpvalues(frame->slots);
+        closeUpvalues(slots);
 
-        if (--vm.frameCount == 0) {
-          pop();
+        vm.stackTop = slots;
+        push(result);
+
+        if (--vm.frameCount == baseFrame) {
           return INTERPRET_OK;
         }
 
-        vm.stackTop = frame->slots;
-
-        push(result);
-        frame = &vm.frames[vm.frameCount - 1];
-        break;
+        LOAD_FRAME();
+        DISPATCH();
       }
 
-      case OP_CLASS:
-        push(OBJ_VAL(newClass(READ_STRING())));
-        break;
+      CASE(OP_CLASS_LONG):
+        operand = READ_LONG();
+        goto classOp;
 
-      case OP_METHOD:
-        defineMethod(READ_STRING(), PUBLIC_METHOD);
-        break;
+      CASE(OP_CLASS):
+        operand = READ_BYTE();
+      classOp:
+        push(OBJ_VAL(newClass(AS_STRING(constants[operand]))));
+        DISPATCH();
 
-      case OP_PRIVATE_METHOD:
-        defineMethod(READ_STRING(), PRIVATE_METHOD);
-        break;
+      CASE(OP_METHOD_LONG):
+        operand = READ_LONG();
+        goto methodOp;
 
-      case OP_BREAK:
-        break;
+      CASE(OP_METHOD):
+        operand = READ_BYTE();
+      methodOp:
+        defineMethod(AS_STRING(constants[operand]), PUBLIC_METHOD);
+        DISPATCH();
+
+      CASE(OP_PRIVATE_METHOD_LONG):
+        operand = READ_LONG();
+        goto privateMethodOp;
+
+      CASE(OP_PRIVATE_METHOD):
+        operand = READ_BYTE();
+      privateMethodOp:
+        defineMethod(AS_STRING(constants[operand]), PRIVATE_METHOD);
+        DISPATCH();
+
+      CASE(OP_BREAK):
+        DISPATCH();
 
-      case OP_BUILD_LIST: {
-        ObjList* list = newList();
+      CASE(OP_BUILD_LIST): {
         uint8_t itemCount = READ_BYTE();
+        ObjList* list = newListWithCapacity(itemCount);
 
+        // The items stay on the stack, rooted, until they are copied.
+        appendValuesToList(list, vm.stackTop - itemCount, itemCount);
+
+        vm.stackTop -= itemCount;
         push(OBJ_VAL(list));
+        DISPATCH();
+      }
+
+      CASE(OP_EXTEND_LIST): {
+        uint8_t itemCount = READ_BYTE();
+        ObjList* list = AS_LIST(peek(itemCount));
+
+        appendValuesToList(list, vm.stackTop - itemCount, itemCount);
+        vm.stackTop -= itemCount;
+        DISPATCH();
+      }
 
-        for (int i = itemCount; i > 0; i--) {
-          appendToList(list, peek(i));
+      CASE(OP_BUILD_MAP): {
+        ObjMap* map = newMap();
+        uint8_t pairCount = READ_BYTE();
+
+        push(OBJ_VAL(map));
+        STORE_FRAME();
+        if (!fillMap(map, vm.stackTop - 1 - pairCount * 2, pairCount)) {
+          return INTERPRET_RUNTIME_ERROR;
         }
-        
-        vm.stackTop -= itemCount + 1; 
-        push(OBJ_VAL(list));
-        break;
+
+        vm.stackTop -= pairCount * 2 + 1;
+        push(OBJ_VAL(map));
+        DISPATCH();
       }
 
-      case OP_INDEX_SUBSCR_NO_POP: {
+      CASE(OP_EXTEND_MAP): {
+        uint8_t pairCount = READ_BYTE();
+        ObjMap* map = AS_MAP(peek(pairCount * 2));
+
+        STORE_FRAME();
+        if (!fillMap(map, vm.stackTop - pairCount * 2, pairCount)) {
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        vm.stackTop -= pairCount * 2;
+        DISPATCH();
+      }
+
+      CASE(OP_INDEX_SUBSCR_NO_POP): {
         Value val;
         Value indexVal = peek(0);
         Value subscrVal = peek(1);
 
+        if (IS_MAP(subscrVal)) {
+          STORE_FRAME();
+          if (!mapSubscript(AS_MAP(subscrVal), indexVal, &val)) {
+            return INTERPRET_RUNTIME_ERROR;
+          }
+
+          push(val);
+          DISPATCH();
+        }
+
+        if (IS_ARRAY(subscrVal)) {
+          ObjArray* array = AS_ARRAY(subscrVal);
+
+          if (!IS_NUMBER(indexVal)) {
+            STORE_FRAME();
+            runtimeError("Index must be a number.");
+            return INTERPRET_RUNTIME_ERROR;
+          }
+
+          if (!isValidArrayIndex(array, AS_NUMBER(indexVal))) {
+            STORE_FRAME();
+            runtimeError("Array index out of range.");
+            return INTERPRET_RUNTIME_ERROR;
+          }
+
+          push(indexFromArray(array, AS_NUMBER(indexVal)));
+          DISPATCH();
+        }
+
         if (!IS_LIST(subscrVal)) {
+          STORE_FRAME();
           runtimeError("Type '%s' does not allow for subscripting.", typeValue(subscrVal));
           return INTERPRET_RUNTIME_ERROR;
         }
 
         if (!IS_NUMBER(indexVal)) {
           printValue(indexVal);
+          STORE_FRAME();
           runtimeError("Index must be a number.");
           return INTERPRET_RUNTIME_ERROR;
         }
@@ -1105,27 +1747,40 @@ static InterpretResult run() {
         ObjList* list = AS_LIST(subscrVal);
 
         if (!isValidListIndex(list, index)) {
+          STORE_FRAME();
           runtimeError("List index out of range.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         val = indexFromList(list, index);
         push(val);
-        break;
+        DISPATCH();
       }
 
-      case OP_INDEX_SUBSCR: {
+      CASE(OP_INDEX_SUBSCR): {
         Value indexVal = pop();
         Value objVal = pop();
         Value result;
 
         if (!IS_OBJ(objVal)) {
+          STORE_FRAME();
           runtimeError("Type '%s' does not allow for subscripting.", typeValue(objVal));
-          info("Only lists and strings allow it.");
+          info("Only lists, maps, arrays and strings allow it.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
+        if (IS_MAP(objVal)) {
+          STORE_FRAME();
+          if (!mapSubscript(AS_MAP(objVal), indexVal, &result)) {
+            return INTERPRET_RUNTIME_ERROR;
+          }
+
+          push(result);
+          DISPATCH();
+        }
+
         if (!IS_NUMBER(indexVal)) {
+          STORE_FRAME();
           runtimeError("Index must be a number.");
           return INTERPRET_RUNTIME_ERROR;
         }
@@ -1137,6 +1792,7 @@ static InterpretResult run() {
             ObjList* list = AS_LIST(objVal);
 
             if (!isValidListIndex(list, index)) {
+              STORE_FRAME();
               runtimeError("List index out of range.");
               return INTERPRET_RUNTIME_ERROR;
             }
@@ -1150,6 +1806,7 @@ static InterpretResult run() {
             ObjString* string = AS_STRING(objVal);
 
             if (!isValidStringIndex(string, index)) {
+              STORE_FRAME();
               runtimeError("String index out of range.");
               return INTERPRET_RUNTIME_ERROR;
             }
@@ -1159,24 +1816,81 @@ static InterpretResult run() {
             break;
           }
 
+          case OBJ_ARRAY: {
+            ObjArray* array = AS_ARRAY(objVal);
+
+            if (!isValidArrayIndex(array, index)) {
+              STORE_FRAME();
+              runtimeError("Array index out of range.");
+              return INTERPRET_RUNTIME_ERROR;
+            }
+
+            push(indexFromArray(array, index));
+            break;
+          }
+
           default:
+            STORE_FRAME();
             runtimeError("Type '%s' not subscriptable.", typeValue(objVal));
             return INTERPRET_RUNTIME_ERROR;
         }
 
-        break;
+        DISPATCH();
       }
 
-      case OP_STORE_SUBSCR: {
+      CASE(OP_STORE_SUBSCR): {
+        // Storing may grow the map, everything stays on the stack until
+        // it is done.
+        if (IS_MAP(peek(2))) {
+          if (!isHashable(peek(1))) {
+            STORE_FRAME();
+            runtimeError("Type '%s' can not be a map key.", typeValue(peek(1)));
+            return INTERPRET_RUNTIME_ERROR;
+          }
+
+          mapSet(AS_MAP(peek(2)), peek(1), peek(0));
+          Value item = pop();
+          vm.stackTop -= 2;
+          push(item);
+          DISPATCH();
+        }
+
         Value item = pop();
         Value indexVal = pop();
         Value listVal = pop();
 
+        if (IS_ARRAY(listVal)) {
+          ObjArray* array = AS_ARRAY(listVal);
+
+          if (!IS_NUMBER(indexVal)) {
+            STORE_FRAME();
+            runtimeError("Array index must be a number.");
+            return INTERPRET_RUNTIME_ERROR;
+          }
+          if (!IS_NUMBER(item)) {
+            STORE_FRAME();
+            runtimeError("Can not store type '%s' in a %s array.",
+                         typeValue(item), arrayKindName(array->kind));
+            return INTERPRET_RUNTIME_ERROR;
+          }
+          if (!isValidArrayIndex(array, AS_NUMBER(indexVal))) {
+            STORE_FRAME();
+            runtimeError("Index out of range");
+            return INTERPRET_RUNTIME_ERROR;
+          }
+
+          storeToArray(array, AS_NUMBER(indexVal), AS_NUMBER(item));
+          push(item);
+          DISPATCH();
+        }
+
         if (!IS_LIST(listVal)) {
+          STORE_FRAME();
           runtimeError("Can not store value in a non-list.");
           return INTERPRET_RUNTIME_ERROR;
         }
         if (!IS_NUMBER(indexVal)) {
+          STORE_FRAME();
           runtimeError("List index must be a number.");
           return INTERPRET_RUNTIME_ERROR;
         }
@@ -1185,115 +1899,301 @@ static InterpretResult run() {
         int index = AS_NUMBER(indexVal);
 
         if (!isValidListIndex(list, index)) {
+          STORE_FRAME();
           runtimeError("Index out of range");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         storeToList(list, index, item);
         push(item);
-        break;
+        DISPATCH();
       }
 
-      case OP_USE_NAME: {
+      CASE(OP_USE_NAME): {
         push(OBJ_VAL(vm.recentLibrary));
-        break;
+        DISPATCH();
       }
 
-      case OP_USE_BUILTIN: {
+      CASE(OP_USE_BUILTIN_LONG):
+        operand = READ_LONG();
+        goto useBuiltinOp;
+
+      CASE(OP_USE_BUILTIN):
+        operand = READ_BYTE();
+      useBuiltinOp: {
+        ObjString* name = AS_STRING(constants[operand]);
         int index = READ_BYTE();
-        ObjString* name = READ_STRING();
         Value libVal;
 
         if (tableGet(&vm.libraries, name, &libVal)) {
           push(libVal);
-          break;
+          DISPATCH();
         }
 
         ObjLibrary* library = importLibrary(index);
 
         push(OBJ_VAL(library));
-        break;
+        DISPATCH();
       }
 
-      case OP_INCREMENT: {
+      CASE(OP_INCREMENT): {
         if (!IS_NUMBER(peek(0))) {
+          STORE_FRAME();
           runtimeError("Operand must be number.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         push(NUMBER_VAL(AS_NUMBER(pop()) + 1));
-        break;
+        DISPATCH();
       }
 
-      case OP_DECREMENT: {
+      CASE(OP_DECREMENT): {
         if (!IS_NUMBER(peek(0))) {
+          STORE_FRAME();
           runtimeError("Operand must be number.");
           return INTERPRET_RUNTIME_ERROR;
         }
 
         push(NUMBER_VAL(AS_NUMBER(pop()) - 1));
-        break;
+        DISPATCH();
+      }
+
+      // Superinstructions, the non-number cases take the generic path.
+      CASE(OP_ADD_LOCALS): {
+        Value a = slots[READ_BYTE()];
+        Value b = slots[READ_BYTE()];
+
+        if (IS_NUMBER(a) && IS_NUMBER(b)) {
+          push(NUMBER_VAL(AS_NUMBER(a) + AS_NUMBER(b)));
+          DISPATCH();
+        }
+
+        push(a);
+        push(b);
+        goto add;
+      }
+
+      CASE(OP_SUBTRACT_LOCALS): {
+        push(slots[READ_BYTE()]);
+        push(slots[READ_BYTE()]);
+        BINARY_OP(NUMBER_VAL, -, double);
+        DISPATCH();
+      }
+
+      CASE(OP_ADD_LOCAL_CONSTANT): {
+        Value a = slots[READ_BYTE()];
+        Value b = READ_CONSTANT();
+
+        if (IS_NUMBER(a) && IS_NUMBER(b)) {
+          push(NUMBER_VAL(AS_NUMBER(a) + AS_NUMBER(b)));
+          DISPATCH();
+        }
+
+        push(a);
+        push(b);
+        goto add;
+      }
+
+      CASE(OP_SUBTRACT_LOCAL_CONSTANT): {
+        push(slots[READ_BYTE()]);
+        push(READ_CONSTANT());
+        BINARY_OP(NUMBER_VAL, -, double);
+        DISPATCH();
+      }
+
+      // Compare, then jump if false. The condition is only left on the
+      // stack when jumping, the target pops it.
+      CASE(OP_EQUAL_JUMP): {
+        uint16_t offset = READ_SHORT();
+        Value b = pop();
+        Value a = pop();
+
+        if (!valuesEqual(a, b)) {
+          push(BOOL_VAL(false));
+          ip += offset;
+        }
+        DISPATCH();
+      }
+
+      CASE(OP_GREATER_JUMP): {
+        uint16_t offset = READ_SHORT();
+        BINARY_OP(BOOL_VAL, >, double);
+
+        if (isFalsey(peek(0))) {
+          ip += offset;
+        } else {
+          pop();
+        }
+        DISPATCH();
+      }
+
+      CASE(OP_LESS_JUMP): {
+        uint16_t offset = READ_SHORT();
+        BINARY_OP(BOOL_VAL, <, double);
+
+        if (isFalsey(peek(0))) {
+          ip += offset;
+        } else {
+          pop();
+        }
+        DISPATCH();
+      }
+
+      CASE(OP_LESS_LOCAL_CONSTANT_JUMP): {
+        Value a = slots[READ_BYTE()];
+        Value b = READ_CONSTANT();
+        uint16_t offset = READ_SHORT();
+
+        if (!IS_NUMBER(a) || !IS_NUMBER(b)) {
+          push(a);
+          push(b);
+          BINARY_ERROR_TYPES(<);
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        if (!(AS_NUMBER(a) < AS_NUMBER(b))) {
+          push(BOOL_VAL(false));
+          ip += offset;
+        }
+        DISPATCH();
       }
 
-      case OP_USE: {
-        ObjString* name = READ_STRING();
+      CASE(OP_INCREMENT_LOCAL): {
+        Value* slot = &slots[READ_BYTE()];
+        if (!IS_NUMBER(*slot)) {
+          STORE_FRAME();
+          runtimeError("Operand must be number.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        *slot = NUMBER_VAL(AS_NUMBER(*slot) + 1);
+        DISPATCH();
+      }
+
+      CASE(OP_DECREMENT_LOCAL): {
+        Value* slot = &slots[READ_BYTE()];
+        if (!IS_NUMBER(*slot)) {
+          STORE_FRAME();
+          runtimeError("Operand must be number.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        *slot = NUMBER_VAL(AS_NUMBER(*slot) - 1);
+        DISPATCH();
+      }
+
+      CASE(OP_USE_LONG):
+        operand = READ_LONG();
+        goto useOp;
+
+      CASE(OP_USE):
+        operand = READ_BYTE();
+      useOp: {
+        ObjString* name = AS_STRING(constants[operand]);
         Value libValue;
 
         if (tableGet(&vm.libraries, name, &libValue)) {
           vm.recentLibrary = AS_LIBRARY(libValue);
           push(NIL_VAL);
-          break;
+          DISPATCH();
         }
         
         char* api_ref = resolveUse(name);
-        if (!api_ref) {
-          FREE_ARRAY(char, api_ref, strlen(api_ref) + 1);
-          return INTERPRET_RUNTIME_ERROR;
-        }
-
-        char* source = readFile(api_ref);
+        if (!api_ref) return INTERPRET_RUNTIME_ERROR;
 
         push(OBJ_VAL(name));
         ObjLibrary* library = newLibrary(name);
         vm.recentLibrary = library;
         pop();
         
-        FREE_ARRAY(char, api_ref, strlen(api_ref) + 1);
         push(OBJ_VAL(library));
         
-        //compileModule() will pop 'library' and free 'source'
-        ObjClosure* closure = compileModule(library, source);
+        //compileModule() will pop 'library'
+        ObjClosure* closure = compileModule(library, api_ref);
+        FREE_ARRAY(char, api_ref, strlen(api_ref) + 1);
         if (!closure) return INTERPRET_COMPILE_ERROR;
 
         push(OBJ_VAL(closure));
+        STORE_FRAME();
         call(closure, 0);
 
-        frame = &vm.frames[vm.frameCount - 1];
-        break;
+        LOAD_FRAME();
+        DISPATCH();
       }
 
-      case OP_RECENT_USE: {
+      CASE(OP_RECENT_USE): {
         vm.recentLibrary = frame->closure->function->library;
-        break;
+        DISPATCH();
       }
-    }
   }
 
+#undef LOAD_FRAME
+#undef STORE_FRAME
 #undef READ_BYTE
 #undef READ_SHORT
+#undef READ_LONG
 #undef READ_CONSTANT
-#undef READ_STRING
+#undef READ_CACHE
+#undef BINARY_ERROR_TYPES
 #undef BINARY_OP
+#undef TRACE_EXECUTION
+#undef INTERPRET_LOOP
+#undef CASE
+#undef DISPATCH
 
 }
 
-InterpretResult interpret(const char* source, char* libName) {
+bool isCallable(Value value) {
+  return IS_CLOSURE(value) || IS_BOUND_METHOD(value) ||
+         IS_NATIVE(value) || IS_CLASS(value);
+}
+
+bool vmCall(Value callee, int argCount, Value* args, Value* result) {
+  if (vm.nativeCallDepth == NATIVE_CALL_DEPTH_MAX) {
+    runtimeError("Too many nested calls from natives.");
+    info("Max depth is %d", NATIVE_CALL_DEPTH_MAX);
+    return false;
+  }
+
+  // 'args' may be a window of the stack, which moves when it grows.
+  bool onStack = args >= vm.stack && args < vm.stackTop;
+  ptrdiff_t offset = args - vm.stack;
+  ensureStack(argCount + 1 + STACK_SLACK);
+  if (onStack) args = vm.stack + offset;
+
+  push(callee);
+  for (int i = 0; i < argCount; i++) {
+    push(args[i]);
+  }
+
+  int baseFrame = vm.frameCount;
+  if (!callValue(callee, argCount)) return false;
+
+  // Natives, and classes without an initializer, are done already.
+  if (vm.frameCount > baseFrame) {
+    // An error resets the depth along with the stack, put it back as
+    // each level unwinds.
+    int depth = vm.nativeCallDepth++;
+    InterpretResult status = run(baseFrame);
+    vm.nativeCallDepth = depth;
+
+    if (status != INTERPRET_OK) return false;
+  }
+
+  *result = pop();
+  return true;
+}
+
+static ObjLibrary* scriptLibrary(char* libName) {
   ObjString* name = copyString(libName, strlen(libName));
   push(OBJ_VAL(name));
   ObjLibrary* library = newLibrary(name);
   pop();
 
-  ObjFunction* function = compile(source, library);
+  return library;
+}
+
+static InterpretResult runScript(ObjFunction* function) {
   if (function == NULL) return INTERPRET_COMPILE_ERROR;
 
   push(OBJ_VAL(function));
@@ -1301,5 +2201,18 @@ InterpretResult interpret(const char* source, char* libName) {
   pop();
   push(OBJ_VAL(closure));
   callValue(OBJ_VAL(closure), 0);
-  return run();
-}
\ No newline at end of file
+
+  InterpretResult result = run(0);
+  if (result == INTERPRET_OK) pop();
+  return result;
+}
+
+InterpretResult interpret(const char* source, char* libName) {
+  ObjLibrary* library = scriptLibrary(libName);
+  return runScript(compile(source, library));
+}
+
+InterpretResult interpretFile(char* path) {
+  ObjLibrary* library = scriptLibrary(path);
+  return runScript(compileFile(path, library));
+}
@@ -4,12 +4,27 @@
 
 #include "object.h"
 
+#include "pool.h"
+
 #include "table.h"
 
 #include "value.h"
 
-#define FRAMES_MAX 64
-#define STACK_MAX (FRAMES_MAX * UINT8_COUNT)
+// Deepest call nesting allowed, override with -DFRAMES_MAX=n. The frame
+// and value stacks start small and grow on demand up to that depth.
+#ifndef FRAMES_MAX
+#define FRAMES_MAX 65536
+#endif
+
+#define FRAMES_INITIAL 64
+
+// Each call from a native into Pa code nests a run() on the C stack.
+#define NATIVE_CALL_DEPTH_MAX 512
+#define STACK_INITIAL (UINT8_COUNT * 4)
+
+// Room kept above a frame's own values for what natives and the runtime
+// push while they work, on top of the depth the compiler measured.
+#define STACK_SLACK 32
 
 typedef struct {
 
@@ -19,26 +34,55 @@ typedef struct {
   Value* slots;
 } CallFrame;
 
+typedef enum {
+  GC_IDLE,
+  GC_MARKING,
+  GC_SWEEPING,
+} GCPhase;
+
+// Pauses of 0.1ms or less, 1ms or less, ... and the ones over 1s.
+#define GC_PAUSE_BUCKETS 6
+
+// What the collector has done so far, see the Gc library.
+typedef struct {
+  int collections;
+  int minorCollections;
+  int slices;
+  // In seconds, a pause is any one collection or slice.
+  double totalPause;
+  double maxPause;
+  int pauses[GC_PAUSE_BUCKETS];
+} GCStats;
+
 typedef struct {
 
-  CallFrame frames[FRAMES_MAX];
+  CallFrame* frames;
   int frameCount;
-  bool markVal;
-  
+  int frameCapacity;
+  // Nested run()s started by vmCall().
+  int nativeCallDepth;
 
-  Value stack[STACK_MAX];
+  Value* stack;
   Value* stackTop;
+  int stackCapacity;
 
   Table libraries;
   ObjLibrary* recentLibrary;
 
   //
   Table listNativeMethods;
+  Table mapNativeMethods;
+  Table setNativeMethods;
+  Table arrayNativeMethods;
+  Table builderNativeMethods;
   Table numberNativeMethods;
   Table stringNativeMethods;
   //
 
+  // Name -> index into 'globalValues'.
   Table globals;
+  ValueArray globalValues;
+
   Table strings;
   ObjString* initString;
 
@@ -46,8 +90,32 @@ typedef struct {
 
   size_t bytesAllocated;
   size_t nextGC;
-
-  Obj* objects;
+  size_t nextMinorGC;
+
+  // Every object, old and young.
+  Pool pool;
+
+  // Old objects that were given a reference to a young one since the
+  // last collection, roots for a minor collection.
+  int rememberedCount;
+  int rememberedCapacity;
+  Obj** remembered;
+
+  GCPhase gcPhase;
+  // Work done by a slice of a major collection, 0 runs every major
+  // collection in one go.
+  int gcSliceBudget;
+  // Threads tracing a major collection, see GC_MARK_THREADS.
+  int gcMarkThreads;
+  size_t nextGCSlice;
+
+  // The heap is let grow to this many times what a major collection
+  // leaves before the next one.
+  double gcGrowFactor;
+  // 0 for no limit, a program that still needs more than this after a
+  // full collection fails with a runtime error.
+  size_t heapLimit;
+  GCStats gcStats;
 
   int grayCount;
   int grayCapacity;
@@ -70,8 +138,11 @@ void freeVM();
 
 
 InterpretResult interpret(const char* source, char* libName);
+InterpretResult interpretFile(char* path);
 void defineNative(const char* name, NativeFn function, Table* table);
-void defineProperty(const char* name, Value value, Table* table);
+void defineGlobalNative(const char* name, NativeFn function);
+void defineLibraryNative(const char* name, NativeFn function, ObjLibrary* library);
+void defineLibraryProperty(const char* name, Value value, ObjLibrary* library);
 void runtimeError(const char* format, ...);
 void info(const char* extra, ...);
 void push(Value value);
@@ -80,4 +151,11 @@ Value pop();
 bool isFalsey(Value value);
 
 bool callValue(Value callee, int argCount);
+
+bool isCallable(Value value);
+// Calls 'callee' with 'args' from a native, running it to completion.
+// The stack can move meanwhile, so a native reads what it needs from
+// its own 'args' first. On false the error is reported and the stack
+// reset already, the native returns NOTCLEAR without touching it.
+bool vmCall(Value callee, int argCount, Value* args, Value* result);
 #endif